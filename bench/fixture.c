@@ -0,0 +1,400 @@
+/**
+ * fixture.c
+ * Generates fake sysfs, /dev and mount table trees and synthetic device
+ * containers to run against.
+ *
+ * The generated tree mimics the parts of the live system that we read: a
+ * sysfs with the block device and partition attributes under devices/, the
+ * block, class/block and dev/block symlinks pointing at them, with the
+ * partitions inside their devices' directories, empty files standing in for
+ * the device nodes, and
+ * mountinfo and mtab files with the requested number of mounts spread evenly
+ * over the partitions. Harnesses that don't need to go through the file system
+ * can skip straight to a container of made up devices instead.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#define _XOPEN_SOURCE 700
+#include "fixture.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Private methods.
+bool fixture_mkdirs(const char *root, const char *rel);
+bool fixture_write(const char *dir, const char *name, const char *fmt, ...)
+	__attribute__((format(printf, 3, 4)));
+bool fixture_node(const char *root, const char *sysrel, const char *name,
+				  uint32_t minor);
+bool fixture_mounts(const char *root, const fixture_spec_t *spec);
+int fixture_unlink(const char *path, const struct stat *st, int flag,
+				   struct FTW *ftw);
+
+/**
+ * Creates a fixture tree.
+ *
+ * @param  root Directory where the fixture will be created.
+ * @param  spec Number of devices, partitions per device and mounts.
+ * @return      TRUE if the whole tree was created.
+ */
+bool fixture_create(const char *root, const fixture_spec_t *spec) {
+	char devdir[PATH_MAX];
+	char partdir[PATH_MAX];
+	char name[PARTITION_NAME_MAX_LEN];
+	char part[PARTITION_NAME_MAX_LEN];
+	char rel[PATH_MAX];
+	char target[PATH_MAX];
+	char path[PATH_MAX];
+
+	// Create the base directories.
+	if (!fixture_mkdirs(root, FIXTURE_SYSFS_DIR "/" FIXTURE_DEVICES_DIR) ||
+			!fixture_mkdirs(root, FIXTURE_SYSFS_DIR "/block") ||
+			!fixture_mkdirs(root, FIXTURE_SYSFS_DIR "/class/block") ||
+			!fixture_mkdirs(root, FIXTURE_SYSFS_DIR "/dev/block") ||
+			!fixture_mkdirs(root, FIXTURE_DEV_DIR) ||
+			!fixture_mkdirs(root, "/proc/self") ||
+			!fixture_mkdirs(root, "/etc")) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < spec->ndevs; i++) {
+		uint32_t minor = i * (spec->nparts + 1);
+
+		// Device directory and attributes.
+		snprintf(name, PARTITION_NAME_MAX_LEN, "fx%u", i);
+		snprintf(rel, PATH_MAX, FIXTURE_DEVICES_DIR "/%s", name);
+		if (snprintf(devdir, PATH_MAX, "%s%s/%s", root, FIXTURE_SYSFS_DIR,
+					 rel) >= PATH_MAX) {
+			return false;
+		}
+		if ((mkdir(devdir, 0755) != 0) || !fixture_mkdirs(devdir, "/queue") ||
+				!fixture_write(devdir, "size", "%llu\n",
+							   (unsigned long long)FIXTURE_PART_SECTORS *
+							   (spec->nparts + 1)) ||
+				!fixture_write(devdir, "ro", "0\n") ||
+				!fixture_write(devdir, "stat", FIXTURE_STAT) ||
+				!fixture_write(devdir, "queue/hw_sector_size", "%u\n",
+							   FIXTURE_SECTOR_SIZE) ||
+				!fixture_write(devdir, "dev", "%u:%u\n", FIXTURE_MAJOR,
+							   minor) ||
+				!fixture_node(root, rel, name, minor)) {
+			return false;
+		}
+
+		// Only whole devices show up in the block folder.
+		if ((snprintf(target, PATH_MAX, "../%s", rel) >= PATH_MAX) ||
+				(snprintf(path, PATH_MAX, "%s%s/block/%s", root,
+						  FIXTURE_SYSFS_DIR, name) >= PATH_MAX) ||
+				(symlink(target, path) != 0)) {
+			return false;
+		}
+
+		// Partitions.
+		for (uint32_t j = 1; j <= spec->nparts; j++) {
+			if ((snprintf(part, PARTITION_NAME_MAX_LEN, "%sp%u", name, j) >=
+					PARTITION_NAME_MAX_LEN) ||
+					(snprintf(partdir, PATH_MAX, "%s/%s", devdir, part) >=
+					 PATH_MAX)) {
+				return false;
+			}
+			snprintf(rel, PATH_MAX, FIXTURE_DEVICES_DIR "/%s/%s", name, part);
+			if ((mkdir(partdir, 0755) != 0) ||
+					!fixture_write(partdir, "size", "%u\n",
+								   FIXTURE_PART_SECTORS) ||
+					!fixture_write(partdir, "ro", "0\n") ||
+					!fixture_write(partdir, "stat", FIXTURE_STAT) ||
+					!fixture_write(partdir, "dev", "%u:%u\n", FIXTURE_MAJOR,
+								   minor + j) ||
+					!fixture_write(partdir, "start", "%llu\n",
+								   (unsigned long long)FIXTURE_PART_SECTORS *
+								   j) ||
+					!fixture_write(partdir, "partition", "%u\n", j) ||
+					!fixture_node(root, rel, part, minor + j)) {
+				return false;
+			}
+		}
+	}
+
+	return fixture_mounts(root, spec);
+}
+
+/**
+ * Builds the paths of a fixture and points the population roots at them.
+ *
+ * @param root  Directory where the fixture lives.
+ * @param roots Fixture paths to be populated.
+ */
+void fixture_roots(const char *root, fixture_roots_t *roots) {
+	snprintf(roots->sysfs, PATH_MAX, "%s%s", root, FIXTURE_SYSFS_DIR);
+	snprintf(roots->dev, PATH_MAX, "%s%s", root, FIXTURE_DEV_DIR);
+	snprintf(roots->mountinfo, PATH_MAX, "%s%s", root, FIXTURE_MOUNTINFO_FILE);
+	snprintf(roots->mtab, PATH_MAX, "%s%s", root, FIXTURE_MTAB_FILE);
+
+	roots->roots.sysfs = roots->sysfs;
+	roots->roots.dev = roots->dev;
+	roots->roots.mountinfo = roots->mountinfo;
+	roots->roots.mtab = roots->mtab;
+}
+
+/**
+ * Removes a whole fixture tree.
+ *
+ * @param  root Directory where the fixture lives.
+ * @return      TRUE if everything was removed.
+ */
+bool fixture_remove(const char *root) {
+	return nftw(root, fixture_unlink, 64, FTW_DEPTH | FTW_PHYS) == 0;
+}
+
+/**
+ * Builds a container of made up devices named sdN, with partitions named sdNpM
+ * mounted at /mnt/TAG/N/M/K. Every seventh device is read-only, and with
+ * probed information every other partition has a label and every fourth one
+ * lacks a UUID.
+ *
+ * @param container Storage device container to be initialized and populated.
+ * @param shape     Shape of the container.
+ */
+void fixture_container(stdev_container *container,
+					   const fixture_shape_t *shape) {
+	char name[PARTITION_NAME_MAX_LEN];
+	uint64_t seed = 42;
+
+	device_container_init(container);
+	for (uint32_t i = 0; i < shape->ndevs; i++) {
+		stdev_t sd;
+
+		memset(&sd, 0, sizeof(stdev_t));
+		snprintf(name, PARTITION_NAME_MAX_LEN, "sd%u", i);
+		sd.name = strpool_intern(&container->strings, name);
+		sd.sector_size = FIXTURE_SECTOR_SIZE;
+		sd.sectors = shape->sectors;
+		if (sd.sectors == 0) {
+			seed = (seed * 6364136223846793005ULL) + 1442695040888963407ULL;
+			sd.sectors = (seed >> 24) >> (i % 32);
+		}
+		sd.size = sd.sectors * sd.sector_size;
+		sd.major = 8;
+		sd.minor = i;
+		sd.ro = (i % 7) == 0;
+
+		for (uint32_t j = 0; j < shape->nparts; j++) {
+			partition_t *part;
+
+			snprintf(name, PARTITION_NAME_MAX_LEN, "sd%up%u", i, j + 1);
+			part = device_partition_push(container, &sd.partitions, name);
+			part->sectors = sd.sectors / (j + 2);
+			part->size = part->sectors * sd.sector_size;
+
+			// Probed information.
+			if (shape->probed) {
+				part->type = strpool_intern(&container->strings, "ext4");
+				if (j % 2)
+					part->label = strpool_intern(&container->strings, "data");
+				if ((j % 4) != 3)
+					part->uuid = strpool_intern(&container->strings,
+												FIXTURE_UUID);
+			}
+
+			// Mount points.
+			for (uint32_t k = 0; k < shape->nmounts; k++) {
+				snprintf(name, PARTITION_NAME_MAX_LEN, "/mnt/%" PRIu64
+						 "/%u/%u/%u", shape->tag, i, j, k);
+				device_partition_mount_push(container, part, name);
+			}
+		}
+
+		device_list_push(container, &sd);
+	}
+}
+
+/**
+ * Gets the current monotonic time.
+ *
+ * @return Time in nanoseconds.
+ */
+double fixture_now_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * 1000000000.0) + ts.tv_nsec;
+}
+
+/**
+ * Creates a directory and all of its parents.
+ *
+ * @param  root Directory the path is relative to, which must exist.
+ * @param  rel  Path relative to the root. (starting with a slash)
+ * @return      TRUE if the directory exists now.
+ */
+bool fixture_mkdirs(const char *root, const char *rel) {
+	char path[PATH_MAX];
+	size_t len;
+
+	len = snprintf(path, PATH_MAX, "%s%s", root, rel);
+	if (len >= PATH_MAX)
+		return false;
+
+	// Create every component after the root.
+	for (size_t i = strlen(root) + 1; i <= len; i++) {
+		if ((path[i] != '/') && (path[i] != '\0'))
+			continue;
+
+		path[i] = '\0';
+		if ((mkdir(path, 0755) != 0) && (errno != EEXIST)) {
+			fprintf(stderr, "Couldn't create %s.\n", path);
+			return false;
+		}
+		if (i < len)
+			path[i] = '/';
+	}
+
+	return true;
+}
+
+/**
+ * Writes a small attribute file.
+ *
+ * @param  dir  Directory where the file will be created.
+ * @param  name Name of the file relative to the directory.
+ * @param  fmt  Format of the contents.
+ * @return      TRUE if the file was written.
+ */
+bool fixture_write(const char *dir, const char *name, const char *fmt, ...) {
+	char path[PATH_MAX];
+	char buf[128];
+	va_list ap;
+	int len;
+	int fd;
+
+	// Render the contents.
+	va_start(ap, fmt);
+	len = vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+
+	// Write them out.
+	snprintf(path, PATH_MAX, "%s/%s", dir, name);
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd == -1) {
+		fprintf(stderr, "Couldn't create %s.\n", path);
+		return false;
+	}
+	if (write(fd, buf, len) != len) {
+		close(fd);
+		return false;
+	}
+
+	return close(fd) == 0;
+}
+
+/**
+ * Creates the sysfs symlinks and the device file of a device or partition.
+ *
+ * @param  root   Directory where the fixture lives.
+ * @param  sysrel Path of the device directory relative to sysfs.
+ * @param  name   Name of the device or partition.
+ * @param  minor  Minor number of the device or partition.
+ * @return        TRUE if everything was created.
+ */
+bool fixture_node(const char *root, const char *sysrel, const char *name,
+				  uint32_t minor) {
+	char path[PATH_MAX];
+	char target[PATH_MAX];
+	int fd;
+
+	// Both symlink directories are two levels deep.
+	snprintf(target, PATH_MAX, "../../%s", sysrel);
+
+	snprintf(path, PATH_MAX, "%s%s/class/block/%s", root, FIXTURE_SYSFS_DIR,
+			 name);
+	if (symlink(target, path) != 0)
+		return false;
+
+	snprintf(path, PATH_MAX, "%s%s/dev/block/%u:%u", root, FIXTURE_SYSFS_DIR,
+			 FIXTURE_MAJOR, minor);
+	if (symlink(target, path) != 0)
+		return false;
+
+	// Device file.
+	snprintf(path, PATH_MAX, "%s%s/%s", root, FIXTURE_DEV_DIR, name);
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd == -1)
+		return false;
+
+	return close(fd) == 0;
+}
+
+/**
+ * Writes the mount tables of the fixture, spreading the mounts evenly over
+ * all the partitions.
+ *
+ * @param  root Directory where the fixture lives.
+ * @param  spec Number of devices, partitions per device and mounts.
+ * @return      TRUE if both mount tables were written.
+ */
+bool fixture_mounts(const char *root, const fixture_spec_t *spec) {
+	char path[PATH_MAX];
+	FILE *mountinfo;
+	FILE *mtab;
+	uint32_t nparts = spec->ndevs * spec->nparts;
+	bool success;
+
+	// Open the mount tables.
+	snprintf(path, PATH_MAX, "%s%s", root, FIXTURE_MOUNTINFO_FILE);
+	mountinfo = fopen(path, "w");
+	snprintf(path, PATH_MAX, "%s%s", root, FIXTURE_MTAB_FILE);
+	mtab = fopen(path, "w");
+	if ((mountinfo == NULL) || (mtab == NULL)) {
+		if (mountinfo != NULL)
+			fclose(mountinfo);
+		if (mtab != NULL)
+			fclose(mtab);
+		return false;
+	}
+
+	// The root filesystem isn't on any of our devices.
+	fprintf(mountinfo, "1 0 0:1 / / rw,relatime shared:1 - tmpfs none rw\n");
+	fprintf(mtab, "none / tmpfs rw,relatime 0 0\n");
+
+	// Mount the partitions.
+	for (uint32_t k = 0; (nparts > 0) && (k < spec->nmounts); k++) {
+		uint32_t dev = (k % nparts) / spec->nparts;
+		uint32_t part = ((k % nparts) % spec->nparts) + 1;
+		uint32_t minor = (dev * (spec->nparts + 1)) + part;
+
+		fprintf(mountinfo, "%u 1 %u:%u / /mnt/fx%u/p%u/%u rw,relatime "
+				"shared:%u - ext4 /dev/fx%up%u rw\n", k + 2, FIXTURE_MAJOR,
+				minor, dev, part, k / nparts, k + 2, dev, part);
+		fprintf(mtab, "/dev/fx%up%u /mnt/fx%u/p%u/%u ext4 rw,relatime 0 0\n",
+				dev, part, dev, part, k / nparts);
+	}
+
+	// Clean up.
+	success = ferror(mountinfo) == 0;
+	success = (fclose(mountinfo) == 0) && success;
+	success = (ferror(mtab) == 0) && success;
+	success = (fclose(mtab) == 0) && success;
+	return success;
+}
+
+/**
+ * Removes a single file or directory while walking the fixture tree.
+ *
+ * @param  path Path to the entry.
+ * @param  st   Information about the entry.
+ * @param  flag Type of the entry.
+ * @param  ftw  Position in the tree.
+ * @return      Zero if the entry was removed.
+ */
+int fixture_unlink(const char *path, const struct stat *st, int flag,
+				   struct FTW *ftw) {
+	return remove(path);
+}
@@ -0,0 +1,68 @@
+/**
+ * fixture.h
+ * Generates fake sysfs, /dev and mount table trees and synthetic device
+ * containers to run against.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _FIXTURE_H
+#define _FIXTURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "device.h"
+
+// Constants. (relative to the fixture root)
+#define FIXTURE_SYSFS_DIR      "/sys"
+#define FIXTURE_DEV_DIR        "/dev"
+#define FIXTURE_MOUNTINFO_FILE "/proc/self/mountinfo"
+#define FIXTURE_MTAB_FILE      "/etc/mtab"
+#define FIXTURE_DEVICES_DIR    "devices/virtual/block"
+#define FIXTURE_MAJOR          240
+#define FIXTURE_SECTOR_SIZE    512
+#define FIXTURE_PART_SECTORS   2097152
+#define FIXTURE_STAT           "0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0 0\n"
+#define FIXTURE_UUID           "952a311c-1cf6-4444-a07b-5d683d9afa01"
+
+// Shape of a fixture.
+typedef struct {
+	uint32_t ndevs;
+	uint32_t nparts;
+	uint32_t nmounts;
+} fixture_spec_t;
+
+// Shape of a synthetic container.
+typedef struct {
+	uint32_t ndevs;
+	uint32_t nparts;   // Partitions of each device.
+	uint32_t nmounts;  // Mount points of each partition.
+	uint64_t sectors;  // Sectors of each device or 0 for all sorts of sizes.
+	uint64_t tag;      // Number that's part of every mount point.
+	bool     probed;   // Give the partitions a type, label and UUID.
+} fixture_shape_t;
+
+// Paths of a fixture in the format of the population options.
+typedef struct {
+	char sysfs[PATH_MAX];
+	char dev[PATH_MAX];
+	char mountinfo[PATH_MAX];
+	char mtab[PATH_MAX];
+	device_roots_t roots;
+} fixture_roots_t;
+
+// Generation.
+bool fixture_create(const char *root, const fixture_spec_t *spec);
+void fixture_roots(const char *root, fixture_roots_t *roots);
+void fixture_container(stdev_container *container,
+					   const fixture_shape_t *shape);
+
+// Timing.
+double fixture_now_ns(void);
+
+// Clean up.
+bool fixture_remove(const char *root);
+
+#endif  //_FIXTURE_H
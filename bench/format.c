@@ -0,0 +1,306 @@
+/**
+ * format.c
+ * Benchmark of the device output formatter. Renders a container full of
+ * devices with the buffer based formatter and with the old one that issued a
+ * printf for every field, making sure both produce the exact same text.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "device.h"
+#include "fixture.h"
+
+// Benchmark parameters.
+#define FORMAT_DEVICES    10000
+#define FORMAT_PARTITIONS 4
+#define FORMAT_MOUNTS     2
+#define FORMAT_RUNS       5
+
+// Old output formatting.
+#define LEGACY_MAX_BYTE_UNIT_SIZE 1000000000000
+#define LEGACY_SIZE_PRINTF        "%.2f%c"
+
+// Private methods.
+double bench_buffer(const stdev_container *container, bool pretty, int fd);
+double bench_legacy(const stdev_container *container, bool pretty, FILE *fh);
+bool check_identical(const stdev_container *container, bool pretty);
+void legacy_pretty_bytes(const size_t size, float *num, char *unit);
+void legacy_print_info(FILE *fh, const stdev_container *container,
+					   const stdev_t *sd, const bool pretty);
+
+/**
+ * Benchmark entry point.
+ *
+ * @return Exit code.
+ */
+int main(void) {
+	fixture_shape_t shape = {
+		FORMAT_DEVICES, FORMAT_PARTITIONS, FORMAT_MOUNTS, 0, 0, true
+	};
+	stdev_container container;
+	FILE *devnull;
+	int fd;
+
+	// Set everything up.
+	fixture_container(&container, &shape);
+	devnull = fopen("/dev/null", "w");
+	fd = open("/dev/null", O_WRONLY);
+	if ((devnull == NULL) || (fd == -1)) {
+		perror("Couldn't open /dev/null");
+		return EXIT_FAILURE;
+	}
+
+	// Compare the formatters in both layouts.
+	printf("%8s %16s %16s %10s\n", "layout", "printf (ns/dev)",
+		   "buffer (ns/dev)", "identical");
+	for (int i = 0; i < 2; i++) {
+		bool pretty = (i == 0);
+		double legacy = -1;
+		double buffer = -1;
+
+		// Keep the best run to filter out some of the noise.
+		for (int run = 0; run < FORMAT_RUNS; run++) {
+			double elapsed;
+
+			elapsed = bench_legacy(&container, pretty, devnull);
+			if ((legacy < 0) || (elapsed < legacy))
+				legacy = elapsed;
+
+			elapsed = bench_buffer(&container, pretty, fd);
+			if ((buffer < 0) || (elapsed < buffer))
+				buffer = elapsed;
+		}
+
+		printf("%8s %16.1f %16.1f %10s\n", pretty ? "tree" : "ugly",
+			   legacy / container.count, buffer / container.count,
+			   check_identical(&container, pretty) ? "yes" : "NO");
+	}
+
+	// Clean up.
+	fclose(devnull);
+	close(fd);
+	device_container_free(&container);
+
+	return EXIT_SUCCESS;
+}
+
+/**
+ * Renders every device into a single buffer and writes it out in one go.
+ *
+ * @param  container Storage device container.
+ * @param  pretty    Tree layout?
+ * @param  fd        File descriptor to write to.
+ * @return           Time it took in nanoseconds.
+ */
+double bench_buffer(const stdev_container *container, bool pretty, int fd) {
+	buffer_t buf;
+	double start;
+
+	start = fixture_now_ns();
+	buffer_init(&buf);
+	for (uint32_t i = 0; i < container->count; i++)
+		device_format_info(container, &container->list[i], pretty, &buf);
+	buffer_write(&buf, fd);
+	buffer_free(&buf);
+
+	return fixture_now_ns() - start;
+}
+
+/**
+ * Prints every device with the old printf based formatter.
+ *
+ * @param  container Storage device container.
+ * @param  pretty    Tree layout?
+ * @param  fh        File to print to.
+ * @return           Time it took in nanoseconds.
+ */
+double bench_legacy(const stdev_container *container, bool pretty, FILE *fh) {
+	double start;
+
+	start = fixture_now_ns();
+	for (uint32_t i = 0; i < container->count; i++)
+		legacy_print_info(fh, container, &container->list[i], pretty);
+	fflush(fh);
+
+	return fixture_now_ns() - start;
+}
+
+/**
+ * Checks if both formatters produce the exact same text.
+ *
+ * @param  container Storage device container.
+ * @param  pretty    Tree layout?
+ * @return           TRUE if the outputs are byte-identical.
+ */
+bool check_identical(const stdev_container *container, bool pretty) {
+	buffer_t buf;
+	char *legacy;
+	size_t len;
+	FILE *fh;
+	bool same;
+
+	// Render with both.
+	buffer_init(&buf);
+	fh = open_memstream(&legacy, &len);
+	for (uint32_t i = 0; i < container->count; i++) {
+		device_format_info(container, &container->list[i], pretty, &buf);
+		legacy_print_info(fh, container, &container->list[i], pretty);
+	}
+	fclose(fh);
+
+	// Compare them.
+	same = (len == buf.len) && (memcmp(legacy, buf.data, len) == 0);
+
+	free(legacy);
+	buffer_free(&buf);
+	return same;
+}
+
+/**
+ * Old float based size simplification.
+ *
+ * @param size Size in bytes.
+ * @param num  Smaller number as a float.
+ * @param unit Unit character.
+ */
+void legacy_pretty_bytes(const size_t size, float *num, char *unit) {
+	const char units[] = "BKMGT";
+	float simp = 0.0f;
+	int u = 0;
+
+	*num = 0.0f;
+	*unit = 'B';
+
+	for (size_t i = 1; i <= LEGACY_MAX_BYTE_UNIT_SIZE; i *= 1000, u++) {
+		simp = (float)size / (float)i;
+
+		// Found the appropriate magnitude.
+		if ((simp < 1000.0f) || (i == LEGACY_MAX_BYTE_UNIT_SIZE)) {
+			*num = simp;
+			*unit = units[u];
+			break;
+		}
+	}
+}
+
+/**
+ * Old printf based device formatter.
+ *
+ * @param fh        File to print to.
+ * @param container Storage device container.
+ * @param sd        Storage device.
+ * @param pretty    FALSE will print everything we have on the device.
+ */
+void legacy_print_info(FILE *fh, const stdev_container *container,
+					   const stdev_t *sd, const bool pretty) {
+	float size;
+	char sunit;
+
+	// Print device information.
+	legacy_pretty_bytes(sd->size, &size, &sunit);
+	if (pretty) {
+		fprintf(fh, "%s (%s) " LEGACY_SIZE_PRINTF "\n",
+				device_str(container, sd->name), sd->ro ? "R" : "R/W", size,
+				sunit);
+	} else {
+		fprintf(fh, "Device:\t\t%s\n", device_str(container, sd->name));
+		fprintf(fh, "Sectors:\t%" PRIu64 "\n", sd->sectors);
+		fprintf(fh, "Sector Size:\t%" PRIu64 " bytes/sector\n",
+				sd->sector_size);
+		fprintf(fh, "Size:\t\t" LEGACY_SIZE_PRINTF "\n", size, sunit);
+		fprintf(fh, "Permission:\t%s\n",
+				sd->ro ? "Read Only" : "Read and Write");
+	}
+
+	// Print partition header.
+	if (sd->partitions.count > 0) {
+		if (!pretty)
+			fprintf(fh, "Partitions (%u):\n", sd->partitions.count);
+	} else {
+		fprintf(fh, "\tNo partitions available!\n");
+	}
+
+	// Loop through the partitions and print their information.
+	for (uint32_t i = 0; i < sd->partitions.count; i++) {
+		const partition_t *part = &sd->partitions.list[i];
+
+		legacy_pretty_bytes(part->size, &size, &sunit);
+		if (pretty) {
+			// Print "tree" thingy.
+			if (i == (sd->partitions.count - 1)) {
+				fprintf(fh, "\t\u2514 ");
+			} else {
+				fprintf(fh, "\t\u251C ");
+			}
+
+			// Print information.
+			fprintf(fh, "%s (%s) [%s] " LEGACY_SIZE_PRINTF "\n",
+					device_str(container, part->name), part->ro ? "R" : "R/W",
+					device_str(container, part->type), size, sunit);
+
+			// Print label.
+			if (part->label != STRREF_EMPTY) {
+				fprintf(fh, "\t");
+				if (i < (sd->partitions.count - 1))
+					fprintf(fh, "\u2502");
+				if (part->mntcount > 0) {
+					fprintf(fh, "\t\u251C ");
+				} else {
+					fprintf(fh, "\t\u2514 ");
+				}
+				fprintf(fh, "Label: %s\n", device_str(container, part->label));
+			}
+
+			// Print mount points.
+			for (uint32_t j = 0; j < part->mntcount; j++) {
+				fprintf(fh, "\t");
+				if (i < (sd->partitions.count - 1))
+					fprintf(fh, "\u2502");
+				if ((j < (part->mntcount - 1)) ||
+						(part->uuid != STRREF_EMPTY)) {
+					fprintf(fh, "\t\u251C ");
+				} else {
+					fprintf(fh, "\t\u2514 ");
+				}
+				fprintf(fh, "Mount Point: %s\n",
+						device_str(container, part->mntpoints[j]));
+			}
+
+			// Print UUID.
+			if (part->uuid != STRREF_EMPTY) {
+				fprintf(fh, "\t");
+				if (i < (sd->partitions.count - 1))
+					fprintf(fh, "\u2502");
+				fprintf(fh, "\t\u2514 ");
+				fprintf(fh, "UUID: %s\n", device_str(container, part->uuid));
+			}
+		} else {
+			fprintf(fh, "\t%u: %s\n", i, device_str(container, part->name));
+			fprintf(fh, "\t\tUUID:        %s\n",
+					device_str(container, part->uuid));
+			fprintf(fh, "\t\tType:        %s\n",
+					device_str(container, part->type));
+			fprintf(fh, "\t\tLabel:       %s\n",
+					device_str(container, part->label));
+			fprintf(fh, "\t\tSectors:     %" PRIu64 "\n", part->sectors);
+			fprintf(fh, "\t\tSize:        " LEGACY_SIZE_PRINTF "\n", size,
+					sunit);
+			fprintf(fh, "\t\tPermission:  %s\n",
+					part->ro ? "Read Only" : "Read and Write");
+			if (part->mntcount == 0)
+				fprintf(fh, "\t\tMount Point: \n");
+			for (uint32_t j = 0; j < part->mntcount; j++) {
+				fprintf(fh, "\t\tMount Point: %s\n",
+						device_str(container, part->mntpoints[j]));
+			}
+		}
+	}
+
+	fprintf(fh, "\n");
+}
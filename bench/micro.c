@@ -0,0 +1,512 @@
+/**
+ * micro.c
+ * Micro-benchmarks of the helpers that run once per device or partition.
+ * Each one is timed in batches after a warmup, the median and 99th percentile
+ * per operation are reported, and they're compared against a stored baseline
+ * to catch regressions. The baseline is kept next to this file, out of the
+ * way of make clean and of git, since timings only mean something on the
+ * machine that took them, and is created with make microbench-baseline.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "device.h"
+#include "mounts.h"
+#include "utils.h"
+#include "fixture.h"
+
+// Benchmark parameters.
+#define MICRO_WARMUP        20
+#define MICRO_SAMPLES       200
+#define MICRO_DEF_THRESHOLD 10.0
+#define MICRO_DEVICES       1000
+#define MICRO_PARTITIONS    4
+#define MICRO_MOUNTS        10000
+#define MICRO_NAME_MAX_LEN  32
+#define MICRO_TMPL          "/tmp/lssd-micro-XXXXXX"
+
+// State shared by the benchmarks.
+typedef struct {
+	char            numfile[sizeof(MICRO_TMPL)];
+	char            mountinfo[sizeof(MICRO_TMPL)];
+	stdev_container container;
+	mount_index_t   mounts;
+	int             stdout_fd;
+	uint32_t        cursor;
+	volatile size_t sink;
+} micro_ctx_t;
+
+// Single benchmark.
+typedef struct {
+	const char *name;
+	uint32_t    batch;
+	void      (*run)(micro_ctx_t *ctx, uint32_t n);
+} micro_case_t;
+
+// Result of a single benchmark in nanoseconds per operation.
+typedef struct {
+	char   name[MICRO_NAME_MAX_LEN];
+	double median;
+	double p99;
+} micro_result_t;
+
+// Private methods.
+bool micro_setup(micro_ctx_t *ctx);
+bool micro_mountinfo(micro_ctx_t *ctx);
+void micro_teardown(micro_ctx_t *ctx);
+void micro_measure(const micro_case_t *bench, micro_ctx_t *ctx,
+				   micro_result_t *result);
+void micro_freadnum(micro_ctx_t *ctx, uint32_t n);
+void micro_pretty_bytes(micro_ctx_t *ctx, uint32_t n);
+void micro_partition_push(micro_ctx_t *ctx, uint32_t n);
+void micro_mount_lookup(micro_ctx_t *ctx, uint32_t n);
+void micro_print_info(micro_ctx_t *ctx, uint32_t n);
+bool baseline_find(const char *fpath, const char *name, double *median);
+bool baseline_save(const char *fpath, const micro_result_t *results,
+				   size_t count);
+int compare_doubles(const void *a, const void *b);
+void usage(const char *name);
+
+// Benchmarks to run.
+static const micro_case_t cases[] = {
+	{ "freadnum",              20,   micro_freadnum },
+	{ "pretty_bytes",          1000, micro_pretty_bytes },
+	{ "device_partition_push", 1000, micro_partition_push },
+	{ "mount_index_lookup",    1000, micro_mount_lookup },
+	{ "device_print_info",     100,  micro_print_info }
+};
+#define MICRO_CASES (sizeof(cases) / sizeof(cases[0]))
+
+/**
+ * Benchmark entry point.
+ *
+ * @param  argc Number of command-line arguments passed.
+ * @param  argv Array of command-line arguments passed.
+ * @return      Exit code.
+ */
+int main(int argc, char **argv) {
+	micro_result_t results[MICRO_CASES];
+	const char *baseline = NULL;
+	const char *save = NULL;
+	double threshold = MICRO_DEF_THRESHOLD;
+	micro_ctx_t ctx;
+	bool regressed = false;
+	size_t compared = 0;
+	int opt;
+
+	// Parse the command-line arguments.
+	while ((opt = getopt(argc, argv, "b:s:t:h")) != -1) {
+		switch (opt) {
+			case 'b':
+				baseline = optarg;
+				break;
+			case 's':
+				save = optarg;
+				break;
+			case 't':
+				threshold = atof(optarg);
+				if (threshold <= 0) {
+					fprintf(stderr, "Invalid threshold: %s\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'h':
+				usage(argv[0]);
+				return EXIT_SUCCESS;
+			default:
+				usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	// A baseline that can't be read would silently compare against nothing.
+	if ((baseline != NULL) && (access(baseline, R_OK) != 0)) {
+		fprintf(stderr, "Couldn't read the baseline %s: %s\n", baseline,
+				strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	// Set everything up.
+	if (!micro_setup(&ctx)) {
+		micro_teardown(&ctx);
+		return EXIT_FAILURE;
+	}
+
+	printf("%-24s %14s %14s %14s %9s\n", "function", "median (ns)",
+		   "p99 (ns)", "baseline (ns)", "change");
+	for (size_t i = 0; i < MICRO_CASES; i++) {
+		double base;
+
+		micro_measure(&cases[i], &ctx, &results[i]);
+		printf("%-24s %14.1f %14.1f", results[i].name, results[i].median,
+			   results[i].p99);
+
+		// Compare against the baseline.
+		if ((baseline != NULL) &&
+				baseline_find(baseline, results[i].name, &base)) {
+			double change = ((results[i].median - base) / base) * 100.0;
+
+			printf(" %14.1f %+8.1f%%", base, change);
+			compared++;
+			if (change > threshold) {
+				printf("  REGRESSED");
+				regressed = true;
+			}
+		} else {
+			printf(" %14s %9s", "-", "-");
+		}
+		printf("\n");
+	}
+
+	// Clean up.
+	micro_teardown(&ctx);
+
+	// Store the results as the new baseline.
+	if (save != NULL) {
+		if (!baseline_save(save, results, MICRO_CASES)) {
+			fprintf(stderr, "Couldn't save the baseline to %s: %s\n", save,
+					strerror(errno));
+			return EXIT_FAILURE;
+		}
+
+		printf("Baseline saved to %s\n", save);
+	}
+
+	if (regressed) {
+		fprintf(stderr, "Median regressed by more than %.1f%%.\n", threshold);
+		return EXIT_FAILURE;
+	}
+	if ((baseline != NULL) && (compared == 0)) {
+		fprintf(stderr, "None of the benchmarks are in %s.\n", baseline);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/**
+ * Sets up everything the benchmarks work on.
+ *
+ * @param  ctx Benchmark state to be populated.
+ * @return     TRUE if everything went fine.
+ */
+bool micro_setup(micro_ctx_t *ctx) {
+	fixture_shape_t shape = {
+		MICRO_DEVICES, MICRO_PARTITIONS, 1, 0, 0, true
+	};
+	int fd;
+
+	memset(ctx, 0, sizeof(micro_ctx_t));
+	ctx->stdout_fd = -1;
+
+	// Devices to be rendered.
+	fixture_container(&ctx->container, &shape);
+
+	// Single number file, just like the ones in sysfs.
+	strcpy(ctx->numfile, MICRO_TMPL);
+	fd = mkstemp(ctx->numfile);
+	if (fd == -1) {
+		perror("Couldn't create a temporary file");
+		ctx->numfile[0] = '\0';
+		return false;
+	}
+	if (write(fd, "1953525168\n", 11) != 11) {
+		perror("Couldn't write to the temporary file");
+		close(fd);
+		return false;
+	}
+	close(fd);
+
+	// Mount table of a busy host.
+	if (!micro_mountinfo(ctx))
+		return false;
+
+	// Keep the rendered devices out of the terminal.
+	fflush(stdout);
+	ctx->stdout_fd = dup(STDOUT_FILENO);
+	if (ctx->stdout_fd == -1) {
+		perror("Couldn't duplicate the standard output");
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Frees up everything the benchmarks worked on.
+ *
+ * @param ctx Benchmark state.
+ */
+void micro_teardown(micro_ctx_t *ctx) {
+	if (ctx->numfile[0] != '\0')
+		unlink(ctx->numfile);
+	if (ctx->mountinfo[0] != '\0') {
+		unlink(ctx->mountinfo);
+		mount_index_free(&ctx->mounts);
+	}
+	if (ctx->stdout_fd != -1)
+		close(ctx->stdout_fd);
+	device_container_free(&ctx->container);
+}
+
+/**
+ * Generates the mountinfo file of a host with lots of mounts and loads it into
+ * the mount index.
+ *
+ * @param  ctx Benchmark state.
+ * @return     TRUE if everything went fine.
+ */
+bool micro_mountinfo(micro_ctx_t *ctx) {
+	FILE *fh;
+	int fd;
+
+	strcpy(ctx->mountinfo, MICRO_TMPL);
+	fd = mkstemp(ctx->mountinfo);
+	if (fd == -1) {
+		perror("Couldn't create a temporary file");
+		ctx->mountinfo[0] = '\0';
+		return false;
+	}
+
+	fh = fdopen(fd, "w");
+	if (fh == NULL) {
+		perror("Couldn't open the temporary file");
+		close(fd);
+		return false;
+	}
+	for (uint32_t i = 0; i < MICRO_MOUNTS; i++) {
+		fprintf(fh, "%u 1 %u:%u / /mnt/%u rw,relatime shared:1 - ext4 "
+				"/dev/sd%u rw\n", i + 2, 8 + (i / 256), i % 256, i, i);
+	}
+	if (fclose(fh) != 0) {
+		perror("Couldn't write to the temporary file");
+		return false;
+	}
+
+	if (!mount_index_load(&ctx->mounts, ctx->mountinfo, ctx->mountinfo)) {
+		fprintf(stderr, "Couldn't load the generated mount table.\n");
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Runs a benchmark, discarding the warmup samples, and works out the median
+ * and 99th percentile time per operation.
+ *
+ * @param bench  Benchmark to run.
+ * @param ctx    Benchmark state.
+ * @param result Results of the benchmark.
+ */
+void micro_measure(const micro_case_t *bench, micro_ctx_t *ctx,
+				   micro_result_t *result) {
+	double samples[MICRO_SAMPLES];
+
+	// Warm the caches and branch predictors up.
+	for (int i = 0; i < MICRO_WARMUP; i++)
+		bench->run(ctx, bench->batch);
+
+	// Time each batch on its own.
+	for (int i = 0; i < MICRO_SAMPLES; i++) {
+		double start = fixture_now_ns();
+		bench->run(ctx, bench->batch);
+		samples[i] = (fixture_now_ns() - start) / bench->batch;
+	}
+
+	// Order the samples to pick the percentiles.
+	qsort(samples, MICRO_SAMPLES, sizeof(double), compare_doubles);
+	snprintf(result->name, MICRO_NAME_MAX_LEN, "%s", bench->name);
+	result->median = samples[MICRO_SAMPLES / 2];
+	result->p99 = samples[((MICRO_SAMPLES * 99) / 100) - 1];
+}
+
+/**
+ * Reads a number from a sysfs-like file.
+ *
+ * @param ctx Benchmark state.
+ * @param n   Number of operations to perform.
+ */
+void micro_freadnum(micro_ctx_t *ctx, uint32_t n) {
+	size_t num;
+
+	for (uint32_t i = 0; i < n; i++) {
+		if (freadnum(ctx->numfile, &num))
+			ctx->sink += num;
+	}
+}
+
+/**
+ * Converts sizes of all magnitudes into human-readable ones.
+ *
+ * @param ctx Benchmark state.
+ * @param n   Number of operations to perform.
+ */
+void micro_pretty_bytes(micro_ctx_t *ctx, uint32_t n) {
+	uint64_t hundredths;
+	char unit;
+
+	for (uint32_t i = 0; i < n; i++) {
+		pretty_bytes(1953525168ULL << (i % 24), &hundredths, &unit);
+		ctx->sink += hundredths + unit;
+	}
+}
+
+/**
+ * Pushes partitions into a fresh container.
+ *
+ * @param ctx Benchmark state.
+ * @param n   Number of operations to perform.
+ */
+void micro_partition_push(micro_ctx_t *ctx, uint32_t n) {
+	stdev_container container;
+	partition_container parts;
+	char name[PARTITION_NAME_MAX_LEN];
+
+	device_container_init(&container);
+	memset(&parts, 0, sizeof(partition_container));
+	for (uint32_t i = 0; i < n; i++) {
+		snprintf(name, PARTITION_NAME_MAX_LEN, "nvme0n1p%u", i);
+		device_partition_push(&container, &parts, name);
+	}
+
+	ctx->sink += parts.count;
+	device_container_free(&container);
+}
+
+/**
+ * Matches partitions against the mount table, missing every once in a while
+ * like unmounted partitions do.
+ *
+ * @param ctx Benchmark state.
+ * @param n   Number of operations to perform.
+ */
+void micro_mount_lookup(micro_ctx_t *ctx, uint32_t n) {
+	for (uint32_t i = 0; i < n; i++) {
+		uint32_t key = (ctx->cursor++ * 2654435761U) % (MICRO_MOUNTS + 1000);
+		const mount_dev_t *dev;
+
+		dev = mount_index_lookup(&ctx->mounts, 8 + (key / 256), key % 256);
+		if (dev != NULL)
+			ctx->sink += dev->count;
+	}
+}
+
+/**
+ * Renders devices to the standard output, which is sent to /dev/null for the
+ * duration of the benchmark.
+ *
+ * @param ctx Benchmark state.
+ * @param n   Number of operations to perform.
+ */
+void micro_print_info(micro_ctx_t *ctx, uint32_t n) {
+	int fd;
+
+	fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+	if (fd == -1)
+		return;
+	fflush(stdout);
+	dup2(fd, STDOUT_FILENO);
+	close(fd);
+
+	for (uint32_t i = 0; i < n; i++) {
+		const stdev_t *sd;
+
+		sd = &ctx->container.list[ctx->cursor++ % ctx->container.count];
+		device_print_info(&ctx->container, sd, true);
+	}
+
+	fflush(stdout);
+	dup2(ctx->stdout_fd, STDOUT_FILENO);
+}
+
+/**
+ * Looks up the median of a benchmark in a baseline file.
+ *
+ * @param  fpath  Baseline file path.
+ * @param  name   Benchmark name.
+ * @param  median Pointer to the stored median in nanoseconds per operation.
+ * @return        TRUE if the benchmark was found in the baseline.
+ */
+bool baseline_find(const char *fpath, const char *name, double *median) {
+	char line[128];
+	bool found = false;
+	FILE *fh;
+
+	fh = fopen(fpath, "r");
+	if (fh == NULL)
+		return false;
+
+	// Each line has a benchmark name, its median and its 99th percentile.
+	while (!found && (fgets(line, sizeof(line), fh) != NULL)) {
+		char bname[MICRO_NAME_MAX_LEN];
+		double p99;
+
+		if ((line[0] == '#') || (sscanf(line, "%31s %lf %lf", bname, median,
+										&p99) != 3)) {
+			continue;
+		}
+
+		found = (strcmp(bname, name) == 0) && (*median > 0);
+	}
+
+	fclose(fh);
+	return found;
+}
+
+/**
+ * Stores results as a baseline file.
+ *
+ * @param  fpath   Baseline file path.
+ * @param  results Results of every benchmark.
+ * @param  count   Number of results.
+ * @return         TRUE if the file was written successfully.
+ */
+bool baseline_save(const char *fpath, const micro_result_t *results,
+				   size_t count) {
+	FILE *fh;
+
+	fh = fopen(fpath, "w");
+	if (fh == NULL)
+		return false;
+
+	fprintf(fh, "# function median_ns p99_ns\n");
+	for (size_t i = 0; i < count; i++) {
+		fprintf(fh, "%s %.1f %.1f\n", results[i].name, results[i].median,
+				results[i].p99);
+	}
+
+	return fclose(fh) == 0;
+}
+
+/**
+ * Comparison function for sorting doubles in ascending order.
+ *
+ * @param  a First number.
+ * @param  b Second number.
+ * @return   Negative, zero or positive as in strcmp.
+ */
+int compare_doubles(const void *a, const void *b) {
+	double da = *(const double *)a;
+	double db = *(const double *)b;
+
+	return (da > db) - (da < db);
+}
+
+/**
+ * Prints the usage of the benchmark.
+ *
+ * @param name Name of the executable.
+ */
+void usage(const char *name) {
+	printf("usage: %s [-b baseline] [-s save] [-t threshold]\n\n", name);
+	printf("    -b  Baseline file to compare against.\n");
+	printf("    -s  Save the results as a baseline file.\n");
+	printf("    -t  Allowed median regression in percent (default %.0f).\n",
+		   MICRO_DEF_THRESHOLD);
+}
@@ -0,0 +1,79 @@
+/**
+ * mkfixture.c
+ * Generates a fake sysfs, /dev and mount table tree that lssd can be pointed
+ * at with its root flags.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "fixture.h"
+
+// Private methods.
+bool parse_count(const char *str, uint32_t *num);
+
+/**
+ * Generator entry point.
+ *
+ * @param  argc Number of command-line arguments passed.
+ * @param  argv Array of command-line arguments passed.
+ * @return      Exit code.
+ */
+int main(int argc, char **argv) {
+	fixture_spec_t spec = { 0, 4, 0 };
+	fixture_roots_t paths;
+
+	// Parse the arguments.
+	if ((argc < 3) || (argc > 5) || !parse_count(argv[2], &spec.ndevs) ||
+			((argc > 3) && !parse_count(argv[3], &spec.nparts))) {
+		fprintf(stderr, "Usage: mkfixture dir devices [partitions] [mounts]\n");
+		return EXIT_FAILURE;
+	}
+	spec.nmounts = spec.ndevs;
+	if ((argc > 4) && !parse_count(argv[4], &spec.nmounts)) {
+		fprintf(stderr, "Invalid number of mounts: %s\n", argv[4]);
+		return EXIT_FAILURE;
+	}
+
+	// Create the fixture in an empty directory.
+	if ((mkdir(argv[1], 0755) != 0) && (errno != EEXIST)) {
+		fprintf(stderr, "Couldn't create %s.\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	if (!fixture_create(argv[1], &spec)) {
+		fprintf(stderr, "Failed to create the fixture in %s.\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	// Tell how to use it.
+	fixture_roots(argv[1], &paths);
+	printf("--sysfs-root %s --dev-root %s --mountinfo %s --mtab %s\n",
+		   paths.sysfs, paths.dev, paths.mountinfo, paths.mtab);
+
+	return EXIT_SUCCESS;
+}
+
+/**
+ * Parses a count argument.
+ *
+ * @param  str String to be parsed.
+ * @param  num Parsed number.
+ * @return     TRUE if the string was a valid number.
+ */
+bool parse_count(const char *str, uint32_t *num) {
+	char *endptr;
+	unsigned long val;
+
+	errno = 0;
+	val = strtoul(str, &endptr, 10);
+	if ((errno != 0) || (*endptr != '\0') || (str[0] == '-') ||
+			(val > UINT32_MAX)) {
+		return false;
+	}
+
+	*num = val;
+	return true;
+}
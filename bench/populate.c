@@ -0,0 +1,224 @@
+/**
+ * populate.c
+ * End-to-end benchmark that populates and outputs the devices of generated
+ * fixtures with an increasing number of devices. Shows how the time per
+ * device behaves and writes the results as JSON lines for tracking.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "linux.h"
+#include "output.h"
+#include "fixture.h"
+
+// Benchmark parameters.
+#define BENCH_PARTITIONS 4
+#define BENCH_RUNS       5
+#define BENCH_TMPL       "/tmp/lssd-bench-XXXXXX"
+
+// Results of a single fixture size.
+typedef struct {
+	double populate;
+	double uring;
+	double tree;
+	double json;
+} bench_result_t;
+
+// Private methods.
+bool bench_fixture(const fixture_spec_t *spec, bench_result_t *result);
+double bench_output(const stdev_container *container, output_format_t format,
+					int fd);
+double bench_populate(stdev_container *container, const populate_opts_t *opts,
+					  uint32_t ndevs);
+
+/**
+ * Benchmark entry point.
+ *
+ * @param  argc Number of command-line arguments passed.
+ * @param  argv Array of command-line arguments passed.
+ * @return      Exit code.
+ */
+int main(int argc, char **argv) {
+	const uint32_t sizes[] = { 10, 100, 1000, 10000 };
+	FILE *results = NULL;
+
+	// Open the results file.
+	if (argc > 1) {
+		results = fopen(argv[1], "w");
+		if (results == NULL) {
+			fprintf(stderr, "Couldn't open %s for writing.\n", argv[1]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	printf("%10s %14s %16s %14s %14s %14s\n", "devices", "populate (ms)",
+		   "per device (ns)", "uring (ms)", "tree (ms)", "json (ms)");
+	for (size_t i = 0; i < (sizeof(sizes) / sizeof(sizes[0])); i++) {
+		fixture_spec_t spec = { sizes[i], BENCH_PARTITIONS, sizes[i] };
+		bench_result_t result;
+
+		if (!bench_fixture(&spec, &result)) {
+			if (results != NULL)
+				fclose(results);
+			return EXIT_FAILURE;
+		}
+
+		printf("%10u %14.3f %16.1f %14.3f %14.3f %14.3f\n", spec.ndevs,
+			   result.populate / 1000000.0, result.populate / spec.ndevs,
+			   result.uring / 1000000.0, result.tree / 1000000.0,
+			   result.json / 1000000.0);
+		if (results != NULL) {
+			fprintf(results, "{\"bench\":\"populate\",\"devices\":%u,"
+					"\"partitions\":%u,\"mounts\":%u,\"populate_ns\":%.0f,"
+					"\"uring_ns\":%.0f,\"tree_ns\":%.0f,\"json_ns\":%.0f}\n",
+					spec.ndevs, spec.ndevs * spec.nparts, spec.nmounts,
+					result.populate, result.uring, result.tree, result.json);
+		}
+	}
+
+	// Clean up.
+	if ((results != NULL) && (fclose(results) != 0))
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
+
+/**
+ * Generates a fixture and times populating and outputting its devices, keeping
+ * the best of a few runs to filter out some of the noise.
+ *
+ * @param  spec   Shape of the fixture.
+ * @param  result Best times of each step in nanoseconds.
+ * @return        TRUE if everything went fine.
+ */
+bool bench_fixture(const fixture_spec_t *spec, bench_result_t *result) {
+	char root[] = BENCH_TMPL;
+	fixture_roots_t paths;
+	stdev_container container;
+	populate_opts_t opts;
+	bool success = true;
+	int fd;
+
+	// Generate the fixture.
+	if (mkdtemp(root) == NULL) {
+		fprintf(stderr, "Couldn't create a directory for the fixture.\n");
+		return false;
+	}
+	if (!fixture_create(root, spec)) {
+		fprintf(stderr, "Failed to create the fixture in %s.\n", root);
+		fixture_remove(root);
+		return false;
+	}
+	fixture_roots(root, &paths);
+
+	// Point everything at the fixture. There's nothing to probe in it.
+	memset(&opts, 0, sizeof(populate_opts_t));
+	opts.useblkid = false;
+	opts.jobs = 1;
+	opts.fields = DEVICE_FIELD_ALL;
+	opts.roots = paths.roots;
+
+	fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+	result->populate = -1;
+	result->uring = -1;
+	result->tree = -1;
+	result->json = -1;
+	for (int run = 0; success && (run < BENCH_RUNS); run++) {
+		double elapsed;
+
+		// Populate reading the attributes through io_uring.
+		opts.uring = true;
+		elapsed = bench_populate(&container, &opts, spec->ndevs);
+		if (elapsed < 0) {
+			success = false;
+			break;
+		}
+		if ((result->uring < 0) || (elapsed < result->uring))
+			result->uring = elapsed;
+		device_container_free(&container);
+
+		// Populate the usual way.
+		opts.uring = false;
+		elapsed = bench_populate(&container, &opts, spec->ndevs);
+		if (elapsed < 0) {
+			success = false;
+			break;
+		}
+		if ((result->populate < 0) || (elapsed < result->populate))
+			result->populate = elapsed;
+
+		// Output.
+		elapsed = bench_output(&container, OUTPUT_TREE, fd);
+		if ((result->tree < 0) || (elapsed < result->tree))
+			result->tree = elapsed;
+		elapsed = bench_output(&container, OUTPUT_JSON, fd);
+		if ((result->json < 0) || (elapsed < result->json))
+			result->json = elapsed;
+
+		device_container_free(&container);
+	}
+
+	// Clean up.
+	close(fd);
+	if (!fixture_remove(root))
+		fprintf(stderr, "Failed to remove the fixture in %s.\n", root);
+	return success;
+}
+
+/**
+ * Times populating a container and makes sure every device was found.
+ *
+ * @param  container Storage device container to be populated.
+ * @param  opts      Population options.
+ * @param  ndevs     Number of devices that should be found.
+ * @return           Time it took in nanoseconds or a negative number if the
+ *                   population failed.
+ */
+double bench_populate(stdev_container *container, const populate_opts_t *opts,
+					  uint32_t ndevs) {
+	double start;
+	double elapsed;
+
+	start = fixture_now_ns();
+	if (!populate_devices(container, opts))
+		return -1;
+	elapsed = fixture_now_ns() - start;
+
+	// Make sure everything was found.
+	if (container->count != ndevs) {
+		fprintf(stderr, "Expected %u devices, got %u.\n", ndevs,
+				container->count);
+		device_container_free(container);
+		return -1;
+	}
+
+	return elapsed;
+}
+
+/**
+ * Times outputting every device of a container.
+ *
+ * @param  container Storage device container.
+ * @param  format    Output format.
+ * @param  fd        File descriptor to write to.
+ * @return           Time it took in nanoseconds.
+ */
+double bench_output(const stdev_container *container, output_format_t format,
+					int fd) {
+	columns_t columns;
+	output_t out;
+	double start;
+
+	columns_all(&columns);
+	start = fixture_now_ns();
+	output_init(&out, format, &columns, fd);
+	for (uint32_t i = 0; i < container->count; i++)
+		output_device(container, &container->list[i], &out);
+	output_finish(&out);
+
+	return fixture_now_ns() - start;
+}
@@ -0,0 +1,242 @@
+/**
+ * shmtorn.c
+ * Torn read harness for the shared memory snapshots. A publisher thread keeps
+ * publishing snapshots that change in every way it can, including growing
+ * past the size of the slots, while a couple of reader threads decode them as
+ * fast as they can and check that every single one is internally consistent
+ * and never older than the one they read before.
+ *
+ * Every device and partition of a snapshot carries the number of the
+ * snapshot in its sector count and in its mount points, and the number of
+ * devices and partitions is derived from it, so a read that mixes two
+ * snapshots can't go unnoticed. Device sectors are one more than the number,
+ * since a count of zero would get made up sizes.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "device.h"
+#include "shm.h"
+#include "fixture.h"
+
+// Harness parameters.
+#define SHMTORN_SNAPSHOTS   5000
+#define SHMTORN_READERS     4
+#define SHMTORN_MAX_DEVICES 300
+#define SHMTORN_MAX_PARTS   4
+
+// State of a reader thread.
+typedef struct {
+	pthread_t thread;
+	char     *path;
+	uint64_t  reads;
+	uint64_t  errors;
+} reader_t;
+
+// Private methods.
+void *publisher_run(void *arg);
+void *reader_run(void *arg);
+void build_snapshot(stdev_container *container, uint64_t num);
+bool check_snapshot(const stdev_container *container, uint64_t *num);
+
+// Set once the publisher is done.
+static _Atomic bool done = false;
+
+/**
+ * Harness entry point.
+ *
+ * @param  argc Number of command line arguments.
+ * @param  argv Command line arguments. Optionally the path of the file.
+ * @return      Exit code.
+ */
+int main(int argc, char **argv) {
+	reader_t readers[SHMTORN_READERS];
+	shm_publisher_t pub;
+	stdev_container container;
+	pthread_t publisher;
+	char path[PATH_MAX];
+	uint64_t reads = 0;
+	uint64_t errors = 0;
+
+	// Start publishing before any of the readers show up.
+	if (argc > 1) {
+		snprintf(path, PATH_MAX, "%s", argv[1]);
+	} else {
+		snprintf(path, PATH_MAX, "/tmp/lssd-shmtorn.%d", (int)getpid());
+	}
+	if (!shm_publisher_open(&pub, path))
+		return EXIT_FAILURE;
+	build_snapshot(&container, 0);
+	if (!shm_publish(&pub, &container)) {
+		fprintf(stderr, "Couldn't publish the first snapshot.\n");
+		return EXIT_FAILURE;
+	}
+	device_container_free(&container);
+
+	// Get everyone going.
+	for (int i = 0; i < SHMTORN_READERS; i++) {
+		readers[i].path = path;
+		readers[i].reads = 0;
+		readers[i].errors = 0;
+		pthread_create(&readers[i].thread, NULL, reader_run, &readers[i]);
+	}
+	pthread_create(&publisher, NULL, publisher_run, &pub);
+
+	// Wait for everything to settle down.
+	pthread_join(publisher, NULL);
+	for (int i = 0; i < SHMTORN_READERS; i++) {
+		pthread_join(readers[i].thread, NULL);
+		reads += readers[i].reads;
+		errors += readers[i].errors;
+	}
+	shm_publisher_close(&pub);
+	unlink(path);
+
+	printf("%u snapshots published, %" PRIu64 " read by %u readers, %" PRIu64
+		   " torn\n", SHMTORN_SNAPSHOTS, reads, SHMTORN_READERS, errors);
+
+	return (errors == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Publishes every one of the snapshots.
+ *
+ * @param  arg Publisher.
+ * @return     Always NULL.
+ */
+void *publisher_run(void *arg) {
+	shm_publisher_t *pub = arg;
+	stdev_container container;
+
+	for (uint64_t num = 1; num < SHMTORN_SNAPSHOTS; num++) {
+		build_snapshot(&container, num);
+		if (!shm_publish(pub, &container))
+			fprintf(stderr, "Couldn't publish snapshot %" PRIu64 ".\n", num);
+		device_container_free(&container);
+	}
+
+	atomic_store(&done, true);
+	return NULL;
+}
+
+/**
+ * Reads and checks snapshots until the publisher is done.
+ *
+ * @param  arg Reader state.
+ * @return     Always NULL.
+ */
+void *reader_run(void *arg) {
+	reader_t *state = arg;
+	shm_reader_t reader;
+	stdev_container container;
+	uint64_t last = 0;
+	uint64_t num;
+	bool finished;
+
+	if (!shm_reader_open(&reader, state->path)) {
+		state->errors++;
+		return NULL;
+	}
+
+	do {
+		finished = atomic_load(&done);
+
+		// Read and decode whatever is there right now.
+		device_container_init(&container);
+		if (!shm_read(&reader, &container)) {
+			fprintf(stderr, "Couldn't read a snapshot.\n");
+			state->errors++;
+		} else if (!check_snapshot(&container, &num)) {
+			state->errors++;
+		} else if (num < last) {
+			fprintf(stderr, "Snapshot %" PRIu64 " read after %" PRIu64 ".\n",
+					num, last);
+			state->errors++;
+		} else {
+			last = num;
+		}
+		device_container_free(&container);
+
+		state->reads++;
+	} while (!finished);
+
+	shm_reader_close(&reader);
+	return NULL;
+}
+
+/**
+ * Builds a snapshot that can be told apart from every other one.
+ *
+ * @param container Container to be initialized and populated.
+ * @param num       Number of the snapshot.
+ */
+void build_snapshot(stdev_container *container, uint64_t num) {
+	fixture_shape_t shape = {
+		1 + (num % SHMTORN_MAX_DEVICES), num % (SHMTORN_MAX_PARTS + 1), 1,
+		num + 1, num, false
+	};
+
+	fixture_container(container, &shape);
+}
+
+/**
+ * Checks that a snapshot is exactly as it was built.
+ *
+ * @param  container Decoded snapshot.
+ * @param  num       Pointer that will hold the number of the snapshot.
+ * @return           TRUE if the snapshot is consistent.
+ */
+bool check_snapshot(const stdev_container *container, uint64_t *num) {
+	char name[PARTITION_NAME_MAX_LEN];
+	uint32_t nparts;
+
+	// Figure out which one it is supposed to be.
+	if (container->count == 0) {
+		fprintf(stderr, "Snapshot without any devices.\n");
+		return false;
+	}
+	*num = container->list[0].sectors - 1;
+	nparts = *num % (SHMTORN_MAX_PARTS + 1);
+	if (container->count != (1 + (*num % SHMTORN_MAX_DEVICES))) {
+		fprintf(stderr, "Snapshot %" PRIu64 " has %u devices.\n", *num,
+				container->count);
+		return false;
+	}
+
+	// Check every device and partition against it.
+	for (uint32_t i = 0; i < container->count; i++) {
+		const stdev_t *sd = &container->list[i];
+
+		snprintf(name, PARTITION_NAME_MAX_LEN, "sd%u", i);
+		if ((sd->sectors != (*num + 1)) || (sd->minor != i) ||
+				(strcmp(device_str(container, sd->name), name) != 0) ||
+				(sd->partitions.count != nparts)) {
+			fprintf(stderr, "Device %u of snapshot %" PRIu64 " is torn.\n", i,
+					*num);
+			return false;
+		}
+
+		for (uint32_t j = 0; j < nparts; j++) {
+			const partition_t *part = &sd->partitions.list[j];
+
+			snprintf(name, PARTITION_NAME_MAX_LEN, "/mnt/%" PRIu64 "/%u/%u/0",
+					 *num, i, j);
+			if ((part->sectors != (sd->sectors / (j + 2))) ||
+					(part->mntcount != 1) ||
+					(strcmp(device_str(container, part->mntpoints[0]),
+							name) != 0)) {
+				fprintf(stderr, "Partition %u of device %u of snapshot %"
+						PRIu64 " is torn.\n", j, i, *num);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,176 @@
+/**
+ * stress.c
+ * Stress benchmark for enumerating the storage devices. Populates generated
+ * fixtures with an increasing number of devices, and separately builds
+ * containers of up to a lot more devices than would fit in a fixture, showing
+ * how the time per device behaves in both, which should stay flat if
+ * everything scales linearly.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "linux.h"
+#include "fixture.h"
+
+// Benchmark parameters.
+#define STRESS_PARTITIONS 4
+#define STRESS_MOUNTS     2
+#define STRESS_RUNS       5
+#define STRESS_TMPL       "/tmp/lssd-stress-XXXXXX"
+
+// Private methods.
+double populate_fixture(uint32_t ndevs);
+double build_container(uint32_t ndevs);
+
+/**
+ * Benchmark entry point.
+ *
+ * @return Exit code.
+ */
+int main(void) {
+	const uint32_t fixture_sizes[] = { 10, 100, 1000, 10000 };
+	const uint32_t container_sizes[] = { 10, 100, 1000, 10000, 100000 };
+
+	// Whole enumeration, reading everything from a fixture.
+	printf("populate\n%10s %14s %16s\n", "devices", "total (ms)",
+		   "per device (ns)");
+	for (size_t i = 0; i < (sizeof(fixture_sizes) / sizeof(uint32_t)); i++) {
+		double best = populate_fixture(fixture_sizes[i]);
+		if (best < 0)
+			return EXIT_FAILURE;
+
+		printf("%10u %14.3f %16.1f\n", fixture_sizes[i], best / 1000000.0,
+			   best / fixture_sizes[i]);
+	}
+
+	// Containers alone.
+	printf("\ncontainer\n%10s %14s %16s\n", "devices", "total (ms)",
+		   "per device (ns)");
+	for (size_t i = 0; i < (sizeof(container_sizes) / sizeof(uint32_t)); i++) {
+		double best = -1;
+
+		// Keep the best run to filter out some of the noise.
+		for (int run = 0; run < STRESS_RUNS; run++) {
+			double elapsed = build_container(container_sizes[i]);
+			if (elapsed < 0)
+				return EXIT_FAILURE;
+			if ((best < 0) || (elapsed < best))
+				best = elapsed;
+		}
+
+		printf("%10u %14.3f %16.1f\n", container_sizes[i], best / 1000000.0,
+			   best / container_sizes[i]);
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/**
+ * Generates a fixture and times populating its devices, keeping the best of a
+ * few runs to filter out some of the noise.
+ *
+ * @param  ndevs Number of devices in the fixture.
+ * @return       Best time in nanoseconds or a negative number if something
+ *               went wrong or not every device was found.
+ */
+double populate_fixture(uint32_t ndevs) {
+	fixture_spec_t spec = { ndevs, STRESS_PARTITIONS, ndevs * STRESS_MOUNTS };
+	char root[] = STRESS_TMPL;
+	fixture_roots_t paths;
+	stdev_container container;
+	populate_opts_t opts;
+	double best = -1;
+
+	// Generate the fixture.
+	if (mkdtemp(root) == NULL) {
+		fprintf(stderr, "Couldn't create a directory for the fixture.\n");
+		return -1;
+	}
+	if (!fixture_create(root, &spec)) {
+		fprintf(stderr, "Failed to create the fixture in %s.\n", root);
+		fixture_remove(root);
+		return -1;
+	}
+	fixture_roots(root, &paths);
+
+	// Point everything at the fixture. There's nothing to probe in it.
+	memset(&opts, 0, sizeof(populate_opts_t));
+	opts.useblkid = false;
+	opts.jobs = 1;
+	opts.fields = DEVICE_FIELD_ALL;
+	opts.roots = paths.roots;
+
+	for (int run = 0; run < STRESS_RUNS; run++) {
+		double start;
+		double elapsed;
+		bool found;
+
+		start = fixture_now_ns();
+		if (!populate_devices(&container, &opts)) {
+			device_container_free(&container);
+			best = -1;
+			break;
+		}
+		elapsed = fixture_now_ns() - start;
+
+		// Make sure everything was found.
+		found = container.count == ndevs;
+		if (!found) {
+			fprintf(stderr, "Expected %u devices, got %u.\n", ndevs,
+					container.count);
+		}
+		device_container_free(&container);
+		if (!found) {
+			best = -1;
+			break;
+		}
+
+		if ((best < 0) || (elapsed < best))
+			best = elapsed;
+	}
+
+	// Clean up.
+	if (!fixture_remove(root))
+		fprintf(stderr, "Failed to remove the fixture in %s.\n", root);
+	return best;
+}
+
+/**
+ * Builds, walks and frees a container with a given number of devices.
+ *
+ * @param  ndevs Number of devices to push into the container.
+ * @return       Time it took in nanoseconds or a negative number if the
+ *               container ended up with the wrong number of entries.
+ */
+double build_container(uint32_t ndevs) {
+	fixture_shape_t shape = {
+		ndevs, STRESS_PARTITIONS, STRESS_MOUNTS, 1000000, 0, false
+	};
+	stdev_container container;
+	size_t total = 0;
+	double start;
+	double end;
+
+	start = fixture_now_ns();
+	fixture_container(&container, &shape);
+
+	// Walk everything to make sure nothing got lost along the way.
+	for (uint32_t i = 0; i < container.count; i++) {
+		for (uint32_t j = 0; j < container.list[i].partitions.count; j++)
+			total += container.list[i].partitions.list[j].mntcount;
+	}
+
+	device_container_free(&container);
+	end = fixture_now_ns();
+
+	// Check the counts.
+	if (total != ((size_t)ndevs * STRESS_PARTITIONS * STRESS_MOUNTS)) {
+		fprintf(stderr, "Expected %zu mount points with %u devices, got %zu.\n",
+				(size_t)ndevs * STRESS_PARTITIONS * STRESS_MOUNTS, ndevs, total);
+		return -1;
+	}
+
+	return end - start;
+}
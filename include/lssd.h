@@ -0,0 +1,117 @@
+/**
+ * lssd.h
+ * Embeddable interface for listing storage devices.
+ *
+ * Everything about a listing is described by a context and every result is
+ * owned by the caller, so any number of threads can list devices at the same
+ * time, even sharing the same context.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _LSSD_H
+#define _LSSD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Everything else in the library is kept to itself.
+#if defined(LSSD_LIBRARY) && defined(__GNUC__)
+#define LSSD_API __attribute__((visibility("default")))
+#else
+#define LSSD_API
+#endif
+
+// Information that can be gathered about devices besides their names and
+// sizes, which are always there.
+#define LSSD_FIELD_RO         (1 << 0)  // Device and partition permissions.
+#define LSSD_FIELD_PARTITIONS (1 << 1)  // Partition names.
+#define LSSD_FIELD_PARTSIZE   (1 << 2)  // Partition sizes.
+#define LSSD_FIELD_DEVNUM     (1 << 3)  // Partition device numbers.
+#define LSSD_FIELD_START      (1 << 4)  // Partition starting sectors.
+#define LSSD_FIELD_MOUNTS     (1 << 5)  // Mount points and mounted types.
+#define LSSD_FIELD_PROBE      (1 << 6)  // Probed type, label and UUID.
+#define LSSD_FIELD_DISKNUM    (1 << 7)  // Device numbers of whole devices.
+#define LSSD_FIELD_ALL        0xFF
+
+// How the devices are gathered.
+#define LSSD_FLAG_REFRESH (1 << 0)  // Ignore the probe cache.
+#define LSSD_FLAG_URING   (1 << 1)  // Read sysfs attributes with io_uring.
+
+// Default paths.
+#define LSSD_DEF_CACHE_PATH "/run/lssd.cache"
+#define LSSD_DEF_UDEV_PATH  "/run/udev/data"
+
+// Options of a listing. Only read while listing, so it can be shared.
+typedef struct {
+	uint32_t     fields;      // What to gather. (LSSD_FIELD_*)
+	uint32_t     flags;       // How to gather it. (LSSD_FLAG_*)
+	unsigned int jobs;        // Probing threads. (0 for one per device)
+	const char  *cache_path;  // Probe cache file. (NULL to disable)
+	const char  *udev_path;   // udev database. (NULL to always probe)
+	const char  *include;     // Only list devices with matching names.
+	const char  *exclude;     // Don't list devices with matching names.
+	const char  *filter;      // Predicate expression. (e.g. "size>1T && !ro")
+
+	// Where the system exposes its devices and mount table.
+	const char  *sysfs_root;
+	const char  *dev_root;
+	const char  *mountinfo;
+	const char  *mtab;
+} lssd_context_t;
+
+// Partition of a device. Strings that aren't known are empty.
+typedef struct {
+	const char         *name;
+	const char         *uuid;
+	const char         *label;
+	const char         *type;
+	uint64_t            sectors;
+	uint64_t            size;
+	uint64_t            start;
+	uint32_t            major;
+	uint32_t            minor;
+	bool                ro;
+	uint32_t            mntcount;
+	const char *const  *mntpoints;
+} lssd_partition_t;
+
+// Storage device.
+typedef struct {
+	const char             *name;
+	uint64_t                sectors;
+	uint64_t                sector_size;
+	uint64_t                size;
+	uint32_t                major;
+	uint32_t                minor;
+	bool                    ro;
+	uint32_t                nparts;
+	const lssd_partition_t *parts;
+} lssd_device_t;
+
+// Devices of a listing. Everything in it lives until it's freed.
+typedef struct {
+	uint32_t             count;
+	const lssd_device_t *list;
+	void                *priv;
+} lssd_devices_t;
+
+// Context.
+LSSD_API void lssd_context_init(lssd_context_t *ctx);
+
+// Listing.
+LSSD_API bool lssd_populate(const lssd_context_t *ctx, lssd_devices_t *devs);
+
+// Clean up.
+LSSD_API void lssd_devices_free(lssd_devices_t *devs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //_LSSD_H
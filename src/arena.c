@@ -0,0 +1,128 @@
+/**
+ * arena.c
+ * Simple arena allocator that frees everything in one go.
+ *
+ * Memory is handed out sequentially from large blocks and is never freed
+ * individually. This makes allocating lots of tiny objects (partitions, mount
+ * points, etc.) cheap and lets the whole thing be released at once.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "arena.h"
+#include <string.h>
+#include <stddef.h>
+
+// Alignment of every allocation.
+#define ARENA_ALIGN        _Alignof(max_align_t)
+#define ARENA_ALIGN_UP(n)  (((n) + (ARENA_ALIGN - 1)) & ~(ARENA_ALIGN - 1))
+#define ARENA_HEADER_SIZE  ARENA_ALIGN_UP(sizeof(arena_block_t))
+
+/**
+ * Initializes an empty arena.
+ *
+ * @param arena Arena to be initialized.
+ */
+void arena_init(arena_t *arena) {
+	arena->head = NULL;
+}
+
+/**
+ * Allocates a chunk of memory from the arena.
+ *
+ * @param  arena Arena allocator.
+ * @param  size  Number of bytes to allocate.
+ * @return       Pointer to the allocated memory.
+ */
+void *arena_alloc(arena_t *arena, size_t size) {
+	arena_block_t *block = arena->head;
+	void *ptr;
+
+	size = ARENA_ALIGN_UP(size);
+
+	// Grab a new block if the current one is full.
+	if ((block == NULL) || ((block->size - block->used) < size)) {
+		size_t bsize = (size > ARENA_BLOCK_SIZE) ? size : ARENA_BLOCK_SIZE;
+
+		block = malloc(ARENA_HEADER_SIZE + bsize);
+		if (block == NULL)
+			return NULL;
+		block->used = 0;
+		block->size = bsize;
+
+		// Oversized blocks go behind the current one so we can keep using it.
+		if ((size > ARENA_BLOCK_SIZE) && (arena->head != NULL)) {
+			block->next = arena->head->next;
+			arena->head->next = block;
+		} else {
+			block->next = arena->head;
+			arena->head = block;
+		}
+	}
+
+	// Hand out the memory.
+	ptr = (uint8_t *)block + ARENA_HEADER_SIZE + block->used;
+	block->used += size;
+
+	return ptr;
+}
+
+/**
+ * Grows a chunk of memory that was allocated from the arena. The old chunk is
+ * only reclaimed when the whole arena is freed, so callers should grow their
+ * arrays geometrically to keep the waste bounded.
+ *
+ * @param  arena   Arena allocator.
+ * @param  ptr     Previously allocated chunk. (can be NULL)
+ * @param  oldsize Size of the previously allocated chunk.
+ * @param  size    New size of the chunk.
+ * @return         Pointer to the new chunk with the old contents copied over.
+ */
+void *arena_realloc(arena_t *arena, void *ptr, size_t oldsize, size_t size) {
+	void *newptr;
+
+	// Nothing to do.
+	if ((ptr != NULL) && (size <= oldsize))
+		return ptr;
+
+	newptr = arena_alloc(arena, size);
+	if ((newptr != NULL) && (ptr != NULL))
+		memcpy(newptr, ptr, oldsize);
+
+	return newptr;
+}
+
+/**
+ * Duplicates a string into the arena.
+ *
+ * @param  arena Arena allocator.
+ * @param  str   String to be duplicated.
+ * @return       Copy of the string.
+ */
+char *arena_strdup(arena_t *arena, const char *str) {
+	size_t len = strlen(str) + 1;
+	char *copy;
+
+	copy = arena_alloc(arena, len);
+	if (copy != NULL)
+		memcpy(copy, str, len);
+
+	return copy;
+}
+
+/**
+ * Frees every block owned by the arena.
+ *
+ * @param arena Arena to be freed.
+ */
+void arena_free(arena_t *arena) {
+	arena_block_t *block = arena->head;
+
+	while (block != NULL) {
+		arena_block_t *next = block->next;
+		free(block);
+		block = next;
+	}
+
+	arena->head = NULL;
+}
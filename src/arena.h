@@ -0,0 +1,41 @@
+/**
+ * arena.h
+ * Simple arena allocator that frees everything in one go.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Constants.
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+// Block of memory owned by an arena.
+typedef struct arena_block_s {
+	struct arena_block_s *next;
+	size_t used;
+	size_t size;
+} arena_block_t;
+
+// Arena allocator.
+typedef struct {
+	arena_block_t *head;
+} arena_t;
+
+// Initialization.
+void arena_init(arena_t *arena);
+
+// Allocation.
+void *arena_alloc(arena_t *arena, size_t size);
+void *arena_realloc(arena_t *arena, void *ptr, size_t oldsize, size_t size);
+char *arena_strdup(arena_t *arena, const char *str);
+
+// Clean up.
+void arena_free(arena_t *arena);
+
+#endif  //_ARENA_H
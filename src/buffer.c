@@ -0,0 +1,147 @@
+/**
+ * buffer.c
+ * Growable byte buffer.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "buffer.h"
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+// Constants.
+#define BUFFER_INIT_CAP 4096
+
+/**
+ * Initializes an empty buffer.
+ *
+ * @param buf Buffer to be initialized.
+ */
+void buffer_init(buffer_t *buf) {
+	buf->data = NULL;
+	buf->len = 0;
+	buf->cap = 0;
+}
+
+/**
+ * Reserves space at the end of the buffer and marks it as used.
+ *
+ * @param  buf Buffer.
+ * @param  len Number of bytes to reserve.
+ * @return     Pointer to the reserved space.
+ */
+void *buffer_reserve(buffer_t *buf, size_t len) {
+	void *ptr;
+
+	// Grow the buffer geometrically.
+	if ((buf->len + len) > buf->cap) {
+		size_t cap = (buf->cap == 0) ? BUFFER_INIT_CAP : buf->cap;
+		while ((buf->len + len) > cap)
+			cap *= 2;
+
+		buf->data = realloc(buf->data, cap);
+		buf->cap = cap;
+	}
+
+	ptr = buf->data + buf->len;
+	buf->len += len;
+
+	return ptr;
+}
+
+/**
+ * Appends data to the end of the buffer.
+ *
+ * @param buf  Buffer.
+ * @param data Data to be appended.
+ * @param len  Length of the data.
+ */
+void buffer_append(buffer_t *buf, const void *data, size_t len) {
+	memcpy(buffer_reserve(buf, len), data, len);
+}
+
+/**
+ * Appends a string to the end of the buffer, without its NUL terminator.
+ *
+ * @param buf Buffer.
+ * @param str String to be appended.
+ */
+void buffer_append_str(buffer_t *buf, const char *str) {
+	buffer_append(buf, str, strlen(str));
+}
+
+/**
+ * Appends a single character to the end of the buffer.
+ *
+ * @param buf Buffer.
+ * @param c   Character to be appended.
+ */
+void buffer_append_char(buffer_t *buf, char c) {
+	*(char *)buffer_reserve(buf, 1) = c;
+}
+
+/**
+ * Appends the decimal representation of an unsigned number to the end of the
+ * buffer.
+ *
+ * @param buf Buffer.
+ * @param num Number to be appended.
+ */
+void buffer_append_uint(buffer_t *buf, uint64_t num) {
+	char digits[20];
+	size_t len = 0;
+
+	// Build the number backwards.
+	do {
+		digits[sizeof(digits) - ++len] = '0' + (num % 10);
+		num /= 10;
+	} while (num > 0);
+
+	buffer_append(buf, digits + sizeof(digits) - len, len);
+}
+
+/**
+ * Writes the whole contents of the buffer to a file descriptor.
+ *
+ * @param  buf Buffer.
+ * @param  fd  File descriptor to write to.
+ * @return     TRUE if everything was written.
+ */
+bool buffer_write(const buffer_t *buf, int fd) {
+	size_t written = 0;
+	ssize_t len;
+
+	while (written < buf->len) {
+		len = write(fd, buf->data + written, buf->len - written);
+		if (len == -1) {
+			if (errno == EINTR)
+				continue;
+
+			return false;
+		}
+
+		written += len;
+	}
+
+	return true;
+}
+
+/**
+ * Empties the buffer without releasing its memory.
+ *
+ * @param buf Buffer to be emptied.
+ */
+void buffer_clear(buffer_t *buf) {
+	buf->len = 0;
+}
+
+/**
+ * Frees the buffer.
+ *
+ * @param buf Buffer to be freed.
+ */
+void buffer_free(buffer_t *buf) {
+	free(buf->data);
+	buffer_init(buf);
+}
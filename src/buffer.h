@@ -0,0 +1,39 @@
+/**
+ * buffer.h
+ * Growable byte buffer.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _BUFFER_H
+#define _BUFFER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Growable byte buffer.
+typedef struct {
+	uint8_t *data;
+	size_t   len;
+	size_t   cap;
+} buffer_t;
+
+// Initialization.
+void buffer_init(buffer_t *buf);
+
+// Appending.
+void *buffer_reserve(buffer_t *buf, size_t len);
+void buffer_append(buffer_t *buf, const void *data, size_t len);
+void buffer_append_str(buffer_t *buf, const char *str);
+void buffer_append_char(buffer_t *buf, char c);
+void buffer_append_uint(buffer_t *buf, uint64_t num);
+
+// Output.
+bool buffer_write(const buffer_t *buf, int fd);
+
+// Clean up.
+void buffer_clear(buffer_t *buf);
+void buffer_free(buffer_t *buf);
+
+#endif  //_BUFFER_H
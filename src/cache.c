@@ -0,0 +1,423 @@
+/**
+ * cache.c
+ * Persistent cache of the information gathered by probing partitions.
+ *
+ * The cache is a compact binary file made out of a small header followed by
+ * one variable length record per partition. Records are kept sorted by their
+ * major:minor numbers. A record is only considered valid if its partition
+ * start, size and the boot it was created on still match. Records of devices
+ * that are gone are dropped whenever the cache gets written, so it never
+ * holds more than the partitions that exist.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "cache.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// File format constants.
+#define CACHE_MAGIC     "LSSDPC"
+#define CACHE_VERSION   1
+#define CACHE_FILE_MODE 0644
+
+// Where sysfs keeps its major:minor links. (relative to the sysfs root)
+#define CACHE_DEV_BLOCK_DIR "/dev/block/"
+
+// On-disk file header.
+typedef struct {
+	char     magic[6];
+	uint16_t version;
+	char     boot_id[CACHE_BOOTID_LEN];
+	uint32_t count;
+} cache_header_t;
+
+// On-disk record header. Followed by the UUID, label and type strings.
+typedef struct {
+	uint32_t major;
+	uint32_t minor;
+	uint64_t start;
+	uint64_t sectors;
+	uint8_t  uuid_len;
+	uint8_t  label_len;
+	uint8_t  type_len;
+} __attribute__((packed)) cache_record_t;
+
+// Private methods.
+bool cache_read_boot_id(char *boot_id);
+bool cache_read_string(const uint8_t **cur, const uint8_t *end, char *str,
+					   uint8_t len, size_t maxlen);
+size_t cache_find(const probe_cache_t *cache, uint32_t major, uint32_t minor,
+				  bool *found);
+
+/**
+ * Loads the probe cache from a file. A missing, corrupt or outdated cache
+ * file isn't an error, we just start with an empty cache.
+ *
+ * @param  cache   Probe cache to be populated.
+ * @param  path    Path to the cache file.
+ * @param  refresh Ignore whatever is in the cache file?
+ * @return         TRUE if the cached entries were loaded.
+ */
+bool cache_load(probe_cache_t *cache, const char *path, const bool refresh) {
+	FILE *fh;
+	cache_header_t header;
+	uint8_t *data = NULL;
+	const uint8_t *cur;
+	const uint8_t *end;
+	size_t maxcount;
+	long fsize;
+
+	// Initialize the cache.
+	cache->path = path;
+	cache->count = 0;
+	cache->entries = NULL;
+	cache->dirty = false;
+	if (!cache_read_boot_id(cache->boot_id))
+		cache->boot_id[0] = '\0';
+
+	// Should we even bother?
+	if (refresh)
+		return false;
+
+	// Open the cache file.
+	fh = fopen(path, "rb");
+	if (fh == NULL)
+		return false;
+
+	// Check the header.
+	if ((fread(&header, sizeof(cache_header_t), 1, fh) != 1) ||
+			(memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0) ||
+			(header.version != CACHE_VERSION) ||
+			(cache->boot_id[0] == '\0') ||
+			(memcmp(header.boot_id, cache->boot_id, CACHE_BOOTID_LEN) != 0)) {
+		fclose(fh);
+		return false;
+	}
+
+	// Slurp the records.
+	fseek(fh, 0, SEEK_END);
+	fsize = ftell(fh) - (long)sizeof(cache_header_t);
+	fseek(fh, sizeof(cache_header_t), SEEK_SET);
+	if (fsize > 0) {
+		data = malloc(fsize);
+		if (fread(data, 1, fsize, fh) != (size_t)fsize) {
+			free(data);
+			fclose(fh);
+			return false;
+		}
+	}
+	fclose(fh);
+
+	// Parse the records. The count comes from the file, so never trust it
+	// beyond how many records could actually fit in it.
+	if (fsize < 0)
+		fsize = 0;
+	maxcount = (size_t)fsize / sizeof(cache_record_t);
+	if (header.count < maxcount)
+		maxcount = header.count;
+	cache->entries = malloc(sizeof(cache_entry_t) * (maxcount + 1));
+	cur = data;
+	end = data + fsize;
+	for (size_t i = 0; i < maxcount; i++) {
+		cache_entry_t *entry = &cache->entries[cache->count];
+		cache_record_t rec;
+
+		// Read the record header.
+		if ((size_t)(end - cur) < sizeof(cache_record_t))
+			break;
+		memcpy(&rec, cur, sizeof(cache_record_t));
+		cur += sizeof(cache_record_t);
+
+		// Lookups binary search the records, so they must be in order.
+		if ((cache->count > 0) &&
+				((rec.major < entry[-1].major) ||
+				 ((rec.major == entry[-1].major) &&
+				  (rec.minor <= entry[-1].minor)))) {
+			break;
+		}
+
+		// Populate the entry.
+		entry->major = rec.major;
+		entry->minor = rec.minor;
+		entry->start = rec.start;
+		entry->sectors = rec.sectors;
+		entry->used = false;
+		if (!cache_read_string(&cur, end, entry->info.uuid, rec.uuid_len,
+							   PARTITION_NAME_MAX_LEN) ||
+				!cache_read_string(&cur, end, entry->info.label, rec.label_len,
+								   PARTITION_NAME_MAX_LEN) ||
+				!cache_read_string(&cur, end, entry->info.type, rec.type_len,
+								   PARTITION_TYPE_MAX_LEN)) {
+			break;
+		}
+
+		cache->count++;
+	}
+
+	// Clean up.
+	free(data);
+	return true;
+}
+
+/**
+ * Saves the probe cache to its file if anything has changed. The file is
+ * replaced atomically so concurrent runs never see a half written cache.
+ *
+ * @param  cache Probe cache to be saved.
+ * @return       TRUE if the cache was written or there was nothing to write.
+ */
+bool cache_save(probe_cache_t *cache) {
+	char tmppath[PATH_MAX];
+	cache_header_t header;
+	FILE *fh;
+	int fd;
+	bool success = true;
+
+	// Nothing changed or we don't know which boot we are in.
+	if (!cache->dirty || (cache->boot_id[0] == '\0'))
+		return true;
+
+	// Open a temporary file right next to the cache. Its name has to be unique
+	// even between threads, since the library can save from several at once.
+	if (snprintf(tmppath, PATH_MAX, "%s.XXXXXX", cache->path) >= PATH_MAX)
+		return false;
+	fd = mkstemp(tmppath);
+	if (fd == -1)
+		return false;
+	fchmod(fd, CACHE_FILE_MODE);
+	fh = fdopen(fd, "wb");
+	if (fh == NULL) {
+		close(fd);
+		unlink(tmppath);
+		return false;
+	}
+
+	// Write the header.
+	memset(&header, 0, sizeof(cache_header_t));
+	memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+	header.version = CACHE_VERSION;
+	memcpy(header.boot_id, cache->boot_id, CACHE_BOOTID_LEN);
+	header.count = cache->count;
+	success = fwrite(&header, sizeof(cache_header_t), 1, fh) == 1;
+
+	// Write the records.
+	for (size_t i = 0; success && (i < cache->count); i++) {
+		const cache_entry_t *entry = &cache->entries[i];
+		cache_record_t rec;
+
+		rec.major = entry->major;
+		rec.minor = entry->minor;
+		rec.start = entry->start;
+		rec.sectors = entry->sectors;
+		rec.uuid_len = strnlen(entry->info.uuid, sizeof(entry->info.uuid) - 1);
+		rec.label_len = strnlen(entry->info.label, sizeof(entry->info.label) - 1);
+		rec.type_len = strnlen(entry->info.type, sizeof(entry->info.type) - 1);
+
+		success = (fwrite(&rec, sizeof(cache_record_t), 1, fh) == 1) &&
+			(fwrite(entry->info.uuid, 1, rec.uuid_len, fh) == rec.uuid_len) &&
+			(fwrite(entry->info.label, 1, rec.label_len, fh) == rec.label_len) &&
+			(fwrite(entry->info.type, 1, rec.type_len, fh) == rec.type_len);
+	}
+
+	// Replace the old cache.
+	if (fclose(fh) != 0)
+		success = false;
+	if (success)
+		success = rename(tmppath, cache->path) == 0;
+	if (!success) {
+		unlink(tmppath);
+		return false;
+	}
+
+	cache->dirty = false;
+	return true;
+}
+
+/**
+ * Looks up a partition in the cache.
+ *
+ * @param  cache Probe cache.
+ * @param  part  Partition to look for.
+ * @return       Cached information or NULL if there wasn't a valid entry.
+ */
+const probe_info_t *cache_lookup(probe_cache_t *cache,
+								 const partition_t *part) {
+	cache_entry_t *entry;
+	bool found;
+	size_t idx;
+
+	// Find the entry.
+	idx = cache_find(cache, part->major, part->minor, &found);
+	if (!found)
+		return NULL;
+
+	// Check if the partition is still the same.
+	entry = &cache->entries[idx];
+	if ((entry->start != part->start) || (entry->sectors != part->sectors))
+		return NULL;
+
+	entry->used = true;
+	return &entry->info;
+}
+
+/**
+ * Stores the probed information of a partition in the cache.
+ *
+ * @param cache Probe cache.
+ * @param part  Partition that was just probed.
+ * @param info  Probed information of the partition.
+ */
+void cache_store(probe_cache_t *cache, const partition_t *part,
+				 const probe_info_t *info) {
+	cache_entry_t *entry;
+	bool found;
+	size_t idx;
+
+	// Find where the entry should go.
+	idx = cache_find(cache, part->major, part->minor, &found);
+	if (!found) {
+		cache->entries = realloc(cache->entries,
+								 sizeof(cache_entry_t) * (cache->count + 1));
+		memmove(&cache->entries[idx + 1], &cache->entries[idx],
+				sizeof(cache_entry_t) * (cache->count - idx));
+		cache->count++;
+	}
+
+	// Populate the entry.
+	entry = &cache->entries[idx];
+	entry->major = part->major;
+	entry->minor = part->minor;
+	entry->start = part->start;
+	entry->sectors = part->sectors;
+	entry->info = *info;
+	entry->used = true;
+
+	cache->dirty = true;
+}
+
+/**
+ * Drops the entries of partitions that no longer exist. Only entries that
+ * weren't used in this run are checked, since those may just belong to
+ * devices that were left out of the listing. Nothing is done unless the
+ * cache is about to be written anyway.
+ *
+ * @param cache Probe cache.
+ * @param sysfs Root of the sysfs mount.
+ */
+void cache_prune(probe_cache_t *cache, const char *sysfs) {
+	char path[PATH_MAX];
+	size_t count = 0;
+
+	// Stale entries are only a problem once they're written back.
+	if (!cache->dirty)
+		return;
+
+	// Keep only the entries that are still around.
+	for (size_t i = 0; i < cache->count; i++) {
+		const cache_entry_t *entry = &cache->entries[i];
+
+		if (!entry->used) {
+			snprintf(path, PATH_MAX, "%s%s%u:%u", sysfs, CACHE_DEV_BLOCK_DIR,
+					 entry->major, entry->minor);
+			if (access(path, F_OK) != 0)
+				continue;
+		}
+
+		if (count != i)
+			cache->entries[count] = *entry;
+		count++;
+	}
+
+	cache->count = count;
+}
+
+/**
+ * Frees the probe cache entries.
+ *
+ * @param cache Probe cache to be freed.
+ */
+void cache_free(probe_cache_t *cache) {
+	free(cache->entries);
+	cache->entries = NULL;
+	cache->count = 0;
+}
+
+/**
+ * Binary searches the cache for an entry.
+ *
+ * @param  cache Probe cache.
+ * @param  major Major number of the partition.
+ * @param  minor Minor number of the partition.
+ * @param  found Set to TRUE if the entry was found.
+ * @return       Index of the entry or where it should be inserted.
+ */
+size_t cache_find(const probe_cache_t *cache, uint32_t major, uint32_t minor,
+				  bool *found) {
+	uint64_t key = ((uint64_t)major << 32) | minor;
+	size_t lo = 0;
+	size_t hi = cache->count;
+
+	*found = false;
+	while (lo < hi) {
+		size_t mid = lo + ((hi - lo) / 2);
+		uint64_t cur = ((uint64_t)cache->entries[mid].major << 32) |
+			cache->entries[mid].minor;
+
+		if (cur == key) {
+			*found = true;
+			return mid;
+		} else if (cur < key) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+/**
+ * Reads the ID of the current boot.
+ *
+ * @param  boot_id Buffer with at least CACHE_BOOTID_LEN + 1 bytes.
+ * @return         TRUE if the boot ID was read.
+ */
+bool cache_read_boot_id(char *boot_id) {
+	FILE *fh;
+	bool success;
+
+	fh = fopen(CACHE_BOOTID_PATH, "r");
+	if (fh == NULL)
+		return false;
+
+	success = fread(boot_id, 1, CACHE_BOOTID_LEN, fh) == CACHE_BOOTID_LEN;
+	boot_id[CACHE_BOOTID_LEN] = '\0';
+
+	fclose(fh);
+	return success;
+}
+
+/**
+ * Reads a length-prefixed string out of a cache record.
+ *
+ * @param  cur    Pointer to the current position in the buffer.
+ * @param  end    End of the buffer.
+ * @param  str    Destination string.
+ * @param  len    Length of the string in the record.
+ * @param  maxlen Size of the destination string.
+ * @return        TRUE if the string fit.
+ */
+bool cache_read_string(const uint8_t **cur, const uint8_t *end, char *str,
+					   uint8_t len, size_t maxlen) {
+	if (((size_t)(end - *cur) < len) || (len >= maxlen))
+		return false;
+
+	memcpy(str, *cur, len);
+	str[len] = '\0';
+	*cur += len;
+
+	return true;
+}
@@ -0,0 +1,54 @@
+/**
+ * cache.h
+ * Persistent cache of the information gathered by probing partitions.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _CACHE_H
+#define _CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "device.h"
+
+// Constants.
+#define CACHE_DEF_PATH    "/run/lssd.cache"
+#define CACHE_BOOTID_PATH "/proc/sys/kernel/random/boot_id"
+#define CACHE_BOOTID_LEN  36
+
+// Cached probe results of a single partition.
+typedef struct {
+	uint32_t major;
+	uint32_t minor;
+	uint64_t start;
+	uint64_t sectors;
+	probe_info_t info;
+	bool used;
+} cache_entry_t;
+
+// Probe cache.
+typedef struct {
+	const char    *path;
+	char           boot_id[CACHE_BOOTID_LEN + 1];
+	size_t         count;
+	cache_entry_t *entries;
+	bool           dirty;
+} probe_cache_t;
+
+// Persistence.
+bool cache_load(probe_cache_t *cache, const char *path, const bool refresh);
+bool cache_save(probe_cache_t *cache);
+
+// Entry operations.
+const probe_info_t *cache_lookup(probe_cache_t *cache,
+								 const partition_t *part);
+void cache_store(probe_cache_t *cache, const partition_t *part,
+				 const probe_info_t *info);
+void cache_prune(probe_cache_t *cache, const char *sysfs);
+
+// Clean up.
+void cache_free(probe_cache_t *cache);
+
+#endif  //_CACHE_H
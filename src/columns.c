@@ -0,0 +1,237 @@
+/**
+ * columns.c
+ * Selectable columns of the table output.
+ *
+ * Each column knows which device fields it needs, so that selecting only a
+ * few of them lets us skip every sysfs read, mount table scan and blkid probe
+ * that wouldn't end up being shown.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "columns.h"
+#include <stdio.h>
+#include <string.h>
+
+// Column description.
+typedef struct {
+	const char *name;
+	const char *header;
+	uint32_t    needs;
+} column_desc_t;
+
+// Columns available, in the same order as column_t.
+static const column_desc_t columns[] = {
+	{ "name",    "NAME",       0 },
+	{ "size",    "SIZE",       DEVICE_FIELD_PARTSIZE },
+	{ "sectors", "SECTORS",    DEVICE_FIELD_PARTSIZE },
+	{ "start",   "START",      DEVICE_FIELD_START },
+	{ "majmin",  "MAJ:MIN",    DEVICE_FIELD_DEVNUM },
+	{ "ro",      "RO",         DEVICE_FIELD_RO },
+	{ "type",    "TYPE",       DEVICE_FIELD_MOUNTS | DEVICE_FIELD_PROBE },
+	{ "label",   "LABEL",      DEVICE_FIELD_PROBE },
+	{ "uuid",    "UUID",       DEVICE_FIELD_PROBE },
+	{ "mnt",     "MOUNTPOINT", DEVICE_FIELD_MOUNTS }
+};
+
+// Private methods.
+void columns_add(columns_t *cols, column_t col);
+void columns_format_strref(const stdev_container *container, strref_t ref,
+						   buffer_t *buf);
+
+/**
+ * Selects every column available.
+ *
+ * @param cols Column selection to be populated.
+ */
+void columns_all(columns_t *cols) {
+	cols->count = 0;
+	cols->mask = 0;
+
+	for (uint32_t i = 0; i < COLUMN_COUNT; i++)
+		columns_add(cols, (column_t)i);
+}
+
+/**
+ * Parses a comma-separated list of column names.
+ *
+ * @param  cols Column selection to be populated.
+ * @param  spec List of column names. (e.g. "name,size,mnt")
+ * @return      TRUE if every column name was valid.
+ */
+bool columns_parse(columns_t *cols, const char *spec) {
+	const char *cur = spec;
+
+	cols->count = 0;
+	cols->mask = 0;
+
+	while (*cur != '\0') {
+		size_t len = strcspn(cur, ",");
+		uint32_t i;
+
+		// Find the column.
+		for (i = 0; i < COLUMN_COUNT; i++) {
+			if ((strlen(columns[i].name) == len) &&
+					(strncmp(columns[i].name, cur, len) == 0)) {
+				break;
+			}
+		}
+		if ((i == COLUMN_COUNT) || (cols->count == COLUMNS_MAX)) {
+			fprintf(stderr, "Invalid column: %.*s\n", (int)len, cur);
+			return false;
+		}
+		columns_add(cols, (column_t)i);
+
+		// Go to the next one.
+		cur += len;
+		if (*cur == ',')
+			cur++;
+	}
+
+	if (cols->count == 0) {
+		fprintf(stderr, "No columns were selected.\n");
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Checks if a column was selected.
+ *
+ * @param  cols Column selection.
+ * @param  col  Column to look for.
+ * @return      TRUE if the column is part of the selection.
+ */
+bool columns_has(const columns_t *cols, column_t col) {
+	return (cols->mask & (1 << col)) != 0;
+}
+
+/**
+ * Gets the device fields that have to be gathered to show the selected
+ * columns. Every row after the device one is a partition, so their names are
+ * always needed.
+ *
+ * @param  cols Column selection.
+ * @return      Device fields used by the columns. (DEVICE_FIELD_*)
+ */
+uint32_t columns_fields(const columns_t *cols) {
+	uint32_t needs = DEVICE_FIELD_PARTITIONS;
+
+	for (uint32_t i = 0; i < cols->count; i++)
+		needs |= columns[cols->list[i]].needs;
+
+	return needs;
+}
+
+/**
+ * Gets the header of a column.
+ *
+ * @param  col Column.
+ * @return     Text to be shown at the top of the column.
+ */
+const char *columns_header(column_t col) {
+	return columns[col].header;
+}
+
+/**
+ * Renders the value of a column for a device or one of its partitions. Values
+ * that don't apply or are unknown are rendered as a dash.
+ *
+ * @param container Storage device container.
+ * @param sd        Storage device.
+ * @param part      Partition or NULL for the device itself.
+ * @param col       Column to be rendered.
+ * @param buf       Buffer where the value will be appended.
+ */
+void columns_format_cell(const stdev_container *container, const stdev_t *sd,
+						 const partition_t *part, column_t col,
+						 buffer_t *buf) {
+	switch (col) {
+	case COLUMN_NAME:
+		buffer_append_str(buf, device_str(container,
+										  (part != NULL) ? part->name :
+										  sd->name));
+		return;
+	case COLUMN_SIZE:
+		device_format_size(buf, (part != NULL) ? part->size : sd->size);
+		return;
+	case COLUMN_SECTORS:
+		buffer_append_uint(buf, (part != NULL) ? part->sectors : sd->sectors);
+		return;
+	case COLUMN_RO:
+		buffer_append_char(buf, ((part != NULL) ? part->ro : sd->ro) ?
+						   '1' : '0');
+		return;
+	default:
+		break;
+	}
+
+	// Everything else only applies to partitions.
+	if (part == NULL) {
+		buffer_append_char(buf, '-');
+		return;
+	}
+
+	switch (col) {
+	case COLUMN_START:
+		buffer_append_uint(buf, part->start);
+		break;
+	case COLUMN_MAJMIN:
+		buffer_append_uint(buf, part->major);
+		buffer_append_char(buf, ':');
+		buffer_append_uint(buf, part->minor);
+		break;
+	case COLUMN_TYPE:
+		columns_format_strref(container, part->type, buf);
+		break;
+	case COLUMN_LABEL:
+		columns_format_strref(container, part->label, buf);
+		break;
+	case COLUMN_UUID:
+		columns_format_strref(container, part->uuid, buf);
+		break;
+	case COLUMN_MNT:
+		if (part->mntcount == 0) {
+			buffer_append_char(buf, '-');
+			break;
+		}
+
+		for (uint32_t i = 0; i < part->mntcount; i++) {
+			if (i > 0)
+				buffer_append_char(buf, ',');
+			buffer_append_str(buf, device_str(container, part->mntpoints[i]));
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * Adds a column to the selection.
+ *
+ * @param cols Column selection.
+ * @param col  Column to be added.
+ */
+void columns_add(columns_t *cols, column_t col) {
+	cols->list[cols->count++] = col;
+	cols->mask |= 1 << col;
+}
+
+/**
+ * Renders an interned string, or a dash if it's empty.
+ *
+ * @param container Storage device container that owns the string.
+ * @param ref       Reference to the string.
+ * @param buf       Buffer where the string will be appended.
+ */
+void columns_format_strref(const stdev_container *container, strref_t ref,
+						   buffer_t *buf) {
+	if (ref == STRREF_EMPTY) {
+		buffer_append_char(buf, '-');
+		return;
+	}
+
+	buffer_append_str(buf, device_str(container, ref));
+}
@@ -0,0 +1,54 @@
+/**
+ * columns.h
+ * Selectable columns of the table output.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _COLUMNS_H
+#define _COLUMNS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "device.h"
+#include "buffer.h"
+
+// Constants.
+#define COLUMNS_MAX 32
+
+// Columns available.
+typedef enum {
+	COLUMN_NAME,
+	COLUMN_SIZE,
+	COLUMN_SECTORS,
+	COLUMN_START,
+	COLUMN_MAJMIN,
+	COLUMN_RO,
+	COLUMN_TYPE,
+	COLUMN_LABEL,
+	COLUMN_UUID,
+	COLUMN_MNT,
+	COLUMN_COUNT
+} column_t;
+
+// Selected columns in the order they should be shown.
+typedef struct {
+	column_t list[COLUMNS_MAX];
+	uint32_t count;
+	uint32_t mask;
+} columns_t;
+
+// Selection.
+void columns_all(columns_t *cols);
+bool columns_parse(columns_t *cols, const char *spec);
+bool columns_has(const columns_t *cols, column_t col);
+uint32_t columns_fields(const columns_t *cols);
+
+// Rendering.
+const char *columns_header(column_t col);
+void columns_format_cell(const stdev_container *container, const stdev_t *sd,
+						 const partition_t *part, column_t col,
+						 buffer_t *buf);
+
+#endif  //_COLUMNS_H
@@ -0,0 +1,601 @@
+/**
+ * daemon.c
+ * Resident daemon that serves device snapshots over a Unix domain socket.
+ *
+ * The daemon keeps the device container in memory, applies device events to
+ * it as they come in and rescans everything every once in a while. After any
+ * change the container gets encoded into an immutable snapshot, and every
+ * client that connects is simply sent the snapshot that was current when it
+ * got accepted. Snapshots are reference counted and clients are written to
+ * without blocking, so a slow reader only holds on to an old snapshot and
+ * never gets in the way of a refresh.
+ *
+ * Full rescans take as long as probing every device does, so they run on a
+ * thread of their own that fills a separate container. The main loop keeps
+ * serving the previous snapshot in the meantime and only swaps the container
+ * in once the rescan tells it that it's done through a pipe.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "daemon.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "buffer.h"
+#include "linux.h"
+#include "shm.h"
+#include "snapshot.h"
+#include "uevent.h"
+#include "watch.h"
+
+// Constants.
+#define DAEMON_MAX_CLIENTS      64
+#define DAEMON_LISTEN_BACKLOG   32
+#define DAEMON_COMPACT_THRESHOLD 64
+#define DAEMON_FIXED_FDS        3
+
+// Reference counted snapshot.
+typedef struct {
+	buffer_t     buf;
+	unsigned int refs;
+} daemon_snapshot_t;
+
+// Client that is still being sent a snapshot.
+typedef struct {
+	int                fd;
+	daemon_snapshot_t *snap;
+	size_t             sent;
+} daemon_client_t;
+
+// Full rescan running in the background.
+typedef struct {
+	pthread_t       thread;
+	int             pipefd[2];
+	bool            running;
+	bool            stale;
+	bool            success;
+	stdev_container fresh;
+} daemon_rescan_t;
+
+// Daemon state.
+typedef struct {
+	stdev_container         *container;
+	const populate_opts_t   *opts;
+	daemon_snapshot_t       *current;
+	shm_publisher_t         *shm;
+	daemon_client_t          clients[DAEMON_MAX_CLIENTS];
+	unsigned int             nclients;
+	unsigned int             garbage;
+	daemon_rescan_t          rescan;
+} daemon_t;
+
+// Set by the signal handler to stop the main loop.
+static volatile sig_atomic_t daemon_stop = 0;
+
+// Private methods.
+int daemon_listen(const char *path);
+bool daemon_sockaddr(struct sockaddr_un *addr, const char *path);
+void daemon_signal(int signum);
+void daemon_publish(daemon_t *d);
+bool daemon_refresh_start(daemon_t *d);
+void *daemon_refresh_run(void *arg);
+void daemon_refresh_finish(daemon_t *d);
+void daemon_accept(daemon_t *d, int lfd);
+bool daemon_client_send(daemon_client_t *client);
+void daemon_client_drop(daemon_t *d, unsigned int idx);
+daemon_snapshot_t *daemon_snapshot_ref(daemon_snapshot_t *snap);
+void daemon_snapshot_unref(daemon_snapshot_t *snap);
+time_t daemon_now(void);
+
+/**
+ * Runs the daemon until it gets interrupted.
+ *
+ * @param  container Storage device container that was already populated.
+ * @param  opts      Population options used for refreshes.
+ * @param  dopts     Daemon options.
+ * @return           TRUE if the daemon exited cleanly.
+ */
+bool daemon_run(stdev_container *container, const populate_opts_t *opts,
+				const daemon_opts_t *dopts) {
+	struct pollfd pfds[DAEMON_MAX_CLIENTS + DAEMON_FIXED_FDS];
+	char name[PARTITION_NAME_MAX_LEN];
+	struct sigaction sa;
+	shm_publisher_t shm;
+	uevent_source_t src;
+	time_t next_refresh;
+	daemon_t d;
+	int lfd;
+
+	// Set up the state.
+	memset(&d, 0, sizeof(daemon_t));
+	d.container = container;
+	d.opts = opts;
+	if (dopts->publish_path != NULL) {
+		if (!shm_publisher_open(&shm, dopts->publish_path))
+			return false;
+		d.shm = &shm;
+	}
+	daemon_publish(&d);
+
+	// Open the sockets and the pipe the rescans report back through.
+	lfd = daemon_listen(dopts->socket_path);
+	if ((lfd != -1) && (pipe(d.rescan.pipefd) == -1)) {
+		perror("Couldn't create the rescan pipe");
+		close(lfd);
+		unlink(dopts->socket_path);
+		lfd = -1;
+	}
+	if (lfd == -1) {
+		daemon_snapshot_unref(d.current);
+		if (d.shm != NULL)
+			shm_publisher_close(d.shm);
+		return false;
+	}
+	fcntl(d.rescan.pipefd[0], F_SETFD, FD_CLOEXEC);
+	fcntl(d.rescan.pipefd[1], F_SETFD, FD_CLOEXEC);
+	if (!uevent_open_netlink(&src))
+		fprintf(stderr, "Device events won't be watched, only refreshing.\n");
+
+	// Stop cleanly on signals and don't die because of a client going away.
+	memset(&sa, 0, sizeof(struct sigaction));
+	sa.sa_handler = daemon_signal;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	// Main loop.
+	next_refresh = daemon_now() + dopts->interval;
+	while (!daemon_stop) {
+		unsigned int nfds = 0;
+		int timeout;
+		int ret;
+
+		// Build the list of things to wait on.
+		pfds[nfds].fd = (d.nclients < DAEMON_MAX_CLIENTS) ? lfd : -1;
+		pfds[nfds++].events = POLLIN;
+		pfds[nfds].fd = src.fd;
+		pfds[nfds++].events = POLLIN;
+		pfds[nfds].fd = (d.rescan.running) ? d.rescan.pipefd[0] : -1;
+		pfds[nfds++].events = POLLIN;
+		for (unsigned int i = 0; i < d.nclients; i++) {
+			pfds[nfds].fd = d.clients[i].fd;
+			pfds[nfds++].events = POLLOUT;
+		}
+
+		// Wait until something happens or it's time for a refresh.
+		timeout = -1;
+		if (dopts->interval > 0) {
+			time_t now = daemon_now();
+			timeout = (now >= next_refresh) ? 0 :
+				(int)(next_refresh - now) * 1000;
+		}
+		ret = poll(pfds, nfds, timeout);
+		if (ret == -1) {
+			if (errno == EINTR)
+				continue;
+
+			perror("Failed to wait for the daemon's sockets");
+			break;
+		}
+
+		// Periodic full refresh.
+		if ((dopts->interval > 0) && (daemon_now() >= next_refresh)) {
+			daemon_refresh_start(&d);
+			next_refresh = daemon_now() + dopts->interval;
+		}
+
+		// Swap in the devices of a rescan that just finished.
+		if (pfds[2].revents & POLLIN)
+			daemon_refresh_finish(&d);
+
+		// Device events.
+		if ((src.fd != -1) && (pfds[1].revents & POLLIN)) {
+			watch_change_t change;
+			uevent_t ev;
+
+			if (uevent_next(&src, &ev, 0) == 1) {
+				change = watch_apply(d.container, d.opts, &ev, name);
+				if (change != WATCH_NONE) {
+					d.rescan.stale = d.rescan.running;
+					if (change != WATCH_ADDED)
+						d.garbage++;
+					if (d.garbage >= DAEMON_COMPACT_THRESHOLD) {
+						device_container_compact(d.container);
+						d.garbage = 0;
+					}
+
+					daemon_publish(&d);
+				}
+			}
+		}
+
+		// Keep sending the snapshots to the clients. Going backwards since
+		// finished clients get swapped with the last one.
+		for (unsigned int i = d.nclients; i-- > 0; ) {
+			if (pfds[i + DAEMON_FIXED_FDS].revents == 0)
+				continue;
+
+			if (!daemon_client_send(&d.clients[i]) ||
+					(d.clients[i].sent == d.clients[i].snap->buf.len)) {
+				daemon_client_drop(&d, i);
+			}
+		}
+
+		// New clients.
+		if (pfds[0].revents & POLLIN)
+			daemon_accept(&d, lfd);
+	}
+
+	// Clean up.
+	if (d.rescan.running) {
+		pthread_join(d.rescan.thread, NULL);
+		device_container_free(&d.rescan.fresh);
+	}
+	close(d.rescan.pipefd[0]);
+	close(d.rescan.pipefd[1]);
+	while (d.nclients > 0)
+		daemon_client_drop(&d, d.nclients - 1);
+	daemon_snapshot_unref(d.current);
+	if (d.shm != NULL)
+		shm_publisher_close(d.shm);
+	if (src.fd != -1)
+		uevent_close(&src);
+	close(lfd);
+	unlink(dopts->socket_path);
+
+	return true;
+}
+
+/**
+ * Asks a running daemon for its current snapshot.
+ *
+ * @param  container   Storage device container to be populated.
+ * @param  socket_path Path to the daemon's socket.
+ * @return             TRUE if the snapshot was received and is valid.
+ */
+bool daemon_query(stdev_container *container, const char *socket_path) {
+	struct sockaddr_un addr;
+	buffer_t buf;
+	ssize_t len;
+	bool success;
+	int fd;
+
+	// Connect to the daemon.
+	if (!daemon_sockaddr(&addr, socket_path))
+		return false;
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd == -1) {
+		perror("Couldn't create the client socket");
+		return false;
+	}
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+		fprintf(stderr, "Couldn't connect to the daemon at %s: %s\n",
+				socket_path, strerror(errno));
+		close(fd);
+		return false;
+	}
+
+	// Read the snapshot until the daemon closes the connection.
+	buffer_init(&buf);
+	do {
+		buffer_reserve(&buf, BUFSIZ);
+		buf.len -= BUFSIZ;
+
+		len = read(fd, buf.data + buf.len, BUFSIZ);
+		if (len > 0)
+			buf.len += len;
+	} while ((len > 0) || ((len == -1) && (errno == EINTR)));
+	close(fd);
+
+	// Decode it.
+	success = (len == 0) && snapshot_decode(container, buf.data, buf.len);
+	if (!success)
+		fprintf(stderr, "Invalid snapshot received from the daemon.\n");
+
+	buffer_free(&buf);
+	return success;
+}
+
+/**
+ * Creates the listening socket, replacing a stale one if needed.
+ *
+ * @param  path Path to the socket.
+ * @return      Listening socket or -1 if something went wrong.
+ */
+int daemon_listen(const char *path) {
+	struct sockaddr_un addr;
+	int fd;
+
+	if (!daemon_sockaddr(&addr, path))
+		return -1;
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd == -1) {
+		perror("Couldn't create the daemon socket");
+		return -1;
+	}
+
+	// Replace the socket if it was left behind by a daemon that is long gone.
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+		int probe;
+
+		if (errno != EADDRINUSE)
+			goto fail;
+
+		probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if ((probe != -1) &&
+				(connect(probe, (struct sockaddr *)&addr, sizeof(addr)) == 0)) {
+			fprintf(stderr, "Another daemon is already listening on %s.\n",
+					path);
+			close(probe);
+			close(fd);
+			return -1;
+		}
+		if (probe != -1)
+			close(probe);
+
+		unlink(path);
+		if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+			goto fail;
+	}
+
+	if (listen(fd, DAEMON_LISTEN_BACKLOG) == -1)
+		goto fail;
+
+	return fd;
+
+fail:
+	fprintf(stderr, "Couldn't listen on %s: %s\n", path, strerror(errno));
+	close(fd);
+	return -1;
+}
+
+/**
+ * Builds the address of a Unix domain socket.
+ *
+ * @param  addr Address to be populated.
+ * @param  path Path to the socket.
+ * @return      TRUE if the path fits in the address.
+ */
+bool daemon_sockaddr(struct sockaddr_un *addr, const char *path) {
+	memset(addr, 0, sizeof(struct sockaddr_un));
+	addr->sun_family = AF_UNIX;
+
+	if (strlen(path) >= sizeof(addr->sun_path)) {
+		fprintf(stderr, "Socket path is too long: %s\n", path);
+		return false;
+	}
+	strcpy(addr->sun_path, path);
+
+	return true;
+}
+
+/**
+ * Asks the main loop to stop.
+ *
+ * @param signum Signal that was received.
+ */
+void daemon_signal(int signum) {
+	(void)signum;
+	daemon_stop = 1;
+}
+
+/**
+ * Encodes the container into a new snapshot and makes it the current one.
+ * Clients still being sent the previous snapshot keep it alive until they're
+ * done. The container also gets published to the memory-mapped file if we
+ * have one.
+ *
+ * @param d Daemon state.
+ */
+void daemon_publish(daemon_t *d) {
+	daemon_snapshot_t *snap;
+
+	snap = malloc(sizeof(daemon_snapshot_t));
+	snap->refs = 1;
+	buffer_init(&snap->buf);
+	snapshot_encode(d->container, &snap->buf);
+
+	if (d->current != NULL)
+		daemon_snapshot_unref(d->current);
+	d->current = snap;
+
+	if (d->shm != NULL)
+		shm_publish(d->shm, d->container);
+}
+
+/**
+ * Starts rescanning all the devices in the background, unless a rescan is
+ * already running.
+ *
+ * @param  d Daemon state.
+ * @return   TRUE if a rescan is running.
+ */
+bool daemon_refresh_start(daemon_t *d) {
+	sigset_t all;
+	sigset_t old;
+	int ret;
+
+	if (d->rescan.running)
+		return true;
+
+	// Signals have to keep interrupting the main loop, not the rescan.
+	device_container_init(&d->rescan.fresh);
+	d->rescan.stale = false;
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	ret = pthread_create(&d->rescan.thread, NULL, daemon_refresh_run, d);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if (ret != 0) {
+		fprintf(stderr, "Couldn't start a rescan: %s\n", strerror(ret));
+		device_container_free(&d->rescan.fresh);
+		return false;
+	}
+
+	d->rescan.running = true;
+	return true;
+}
+
+/**
+ * Rescans all the devices into the rescan container. Runs on its own thread
+ * and only touches the rescan state until the main loop joins it.
+ *
+ * @param  arg Daemon state.
+ * @return     Always NULL.
+ */
+void *daemon_refresh_run(void *arg) {
+	daemon_t *d = arg;
+	char done = 1;
+
+	d->rescan.success = populate_devices(&d->rescan.fresh, d->opts);
+	while ((write(d->rescan.pipefd[1], &done, 1) == -1) && (errno == EINTR))
+		;
+
+	return NULL;
+}
+
+/**
+ * Waits for the rescan that just signalled it was done and publishes the
+ * devices it found. A rescan that raced with device events is thrown away
+ * and started over, since it may have missed them while the container that
+ * is being served already has them.
+ *
+ * @param d Daemon state.
+ */
+void daemon_refresh_finish(daemon_t *d) {
+	char done;
+
+	while ((read(d->rescan.pipefd[0], &done, 1) == -1) && (errno == EINTR))
+		;
+	pthread_join(d->rescan.thread, NULL);
+	d->rescan.running = false;
+
+	// Whatever was gathered before a failure still has to go.
+	if (!d->rescan.success || d->rescan.stale) {
+		device_container_free(&d->rescan.fresh);
+		if (d->rescan.stale)
+			daemon_refresh_start(d);
+		return;
+	}
+
+	device_container_free(d->container);
+	*d->container = d->rescan.fresh;
+	d->garbage = 0;
+	daemon_publish(d);
+}
+
+/**
+ * Accepts all the pending clients and starts sending them the current
+ * snapshot.
+ *
+ * @param d   Daemon state.
+ * @param lfd Listening socket.
+ */
+void daemon_accept(daemon_t *d, int lfd) {
+	daemon_client_t *client;
+	int fd;
+
+	while (d->nclients < DAEMON_MAX_CLIENTS) {
+		fd = accept(lfd, NULL, NULL);
+		if (fd == -1)
+			return;
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+		client = &d->clients[d->nclients++];
+		client->fd = fd;
+		client->snap = daemon_snapshot_ref(d->current);
+		client->sent = 0;
+
+		// Most snapshots fit in the socket buffer in one go.
+		if (!daemon_client_send(client) ||
+				(client->sent == client->snap->buf.len)) {
+			daemon_client_drop(d, d->nclients - 1);
+		}
+	}
+}
+
+/**
+ * Sends as much of the snapshot as the client's socket takes without
+ * blocking.
+ *
+ * @param  client Client.
+ * @return        FALSE if the client should be dropped.
+ */
+bool daemon_client_send(daemon_client_t *client) {
+	const buffer_t *buf = &client->snap->buf;
+	ssize_t len;
+
+	while (client->sent < buf->len) {
+		len = send(client->fd, buf->data + client->sent,
+				   buf->len - client->sent, MSG_NOSIGNAL);
+		if (len == -1) {
+			if (errno == EINTR)
+				continue;
+
+			return (errno == EAGAIN) || (errno == EWOULDBLOCK);
+		}
+
+		client->sent += len;
+	}
+
+	return true;
+}
+
+/**
+ * Disconnects a client and releases its snapshot.
+ *
+ * @param d   Daemon state.
+ * @param idx Index of the client.
+ */
+void daemon_client_drop(daemon_t *d, unsigned int idx) {
+	close(d->clients[idx].fd);
+	daemon_snapshot_unref(d->clients[idx].snap);
+	d->clients[idx] = d->clients[--d->nclients];
+}
+
+/**
+ * Grabs a reference to a snapshot.
+ *
+ * @param  snap Snapshot.
+ * @return      The same snapshot.
+ */
+daemon_snapshot_t *daemon_snapshot_ref(daemon_snapshot_t *snap) {
+	snap->refs++;
+	return snap;
+}
+
+/**
+ * Releases a reference to a snapshot, freeing it when nobody uses it anymore.
+ *
+ * @param snap Snapshot.
+ */
+void daemon_snapshot_unref(daemon_snapshot_t *snap) {
+	if (--snap->refs > 0)
+		return;
+
+	buffer_free(&snap->buf);
+	free(snap);
+}
+
+/**
+ * Gets the current time from a clock that never jumps.
+ *
+ * @return Seconds since some point in the past.
+ */
+time_t daemon_now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec;
+}
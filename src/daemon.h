@@ -0,0 +1,34 @@
+/**
+ * daemon.h
+ * Resident daemon that serves device snapshots over a Unix domain socket.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _DAEMON_H
+#define _DAEMON_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "device.h"
+
+// Constants.
+#define DAEMON_DEF_SOCKET   "/run/lssd.sock"
+#define DAEMON_DEF_INTERVAL 60
+
+// Daemon options.
+typedef struct {
+	const char  *socket_path;
+	const char  *publish_path;
+	unsigned int interval;
+} daemon_opts_t;
+
+// Server.
+bool daemon_run(stdev_container *container, const populate_opts_t *opts,
+				const daemon_opts_t *dopts);
+
+// Client.
+bool daemon_query(stdev_container *container, const char *socket_path);
+
+#endif  //_DAEMON_H
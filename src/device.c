@@ -11,32 +11,339 @@
 #include <string.h>
 #include "utils.h"
 
-#define SIZE_PRINTF "%.2f%c"
+#define CONTAINER_INIT_CAPACITY 8
+
+// Sorting key of a device or partition.
+typedef struct {
+	uint32_t    major;
+	uint32_t    minor;
+	const char *name;
+	uint32_t    idx;
+} device_key_t;
+
+// Private methods.
+int device_key_cmp(const void *a, const void *b);
+
+/**
+ * Initializes an empty storage device container.
+ *
+ * @param container Storage device container to be initialized.
+ */
+void device_container_init(stdev_container *container) {
+	container->count = 0;
+	container->capacity = 0;
+	container->list = NULL;
+	arena_init(&container->arena);
+	strpool_init(&container->strings);
+}
 
 /**
  * Pushes a storage device into a container.
  *
- * @param list Device container.
- * @param sd   Storage device.
+ * @param  container Device container.
+ * @param  sd        Storage device to be copied into the container.
+ * @return           Storage device inside the container.
  */
-void device_list_push(stdev_container *list, stdev_t sd) {
-	list->list = realloc(list->list, sizeof(stdev_t) * (list->count + 1));
-	list->list[list->count++] = sd;
+stdev_t *device_list_push(stdev_container *container, const stdev_t *sd) {
+	// Grow the list geometrically.
+	if (container->count == container->capacity) {
+		container->capacity = (container->capacity == 0) ?
+			CONTAINER_INIT_CAPACITY : container->capacity * 2;
+		container->list = realloc(container->list,
+								  sizeof(stdev_t) * container->capacity);
+	}
+
+	container->list[container->count] = *sd;
+	return &container->list[container->count++];
 }
 
 /**
  * Pushes a partition into a storage device.
  *
- * @param parts Partition container.
- * @param name  Partition name.
+ * @param  container Device container that owns the partition's memory.
+ * @param  parts     Partition container.
+ * @param  name      Partition name.
+ * @return           The newly added partition.
+ */
+partition_t *device_partition_push(stdev_container *container,
+								   partition_container *parts,
+								   const char *name) {
+	partition_t *part;
+
+	// Grow the list geometrically.
+	if (parts->count == parts->capacity) {
+		uint32_t capacity = (parts->capacity == 0) ? CONTAINER_INIT_CAPACITY :
+			parts->capacity * 2;
+
+		parts->list = arena_realloc(&container->arena, parts->list,
+									sizeof(partition_t) * parts->capacity,
+									sizeof(partition_t) * capacity);
+		parts->capacity = capacity;
+	}
+
+	// Initialize the partition.
+	part = &parts->list[parts->count++];
+	memset(part, 0, sizeof(partition_t));
+	part->name = strpool_intern(&container->strings, name);
+
+	return part;
+}
+
+/**
+ * Adds a mount point to a partition.
+ *
+ * @param container Device container that owns the partition's memory.
+ * @param part      Partition structure.
+ * @param mntpoint  Where the partition is mounted.
+ */
+void device_partition_mount_push(stdev_container *container, partition_t *part,
+								 const char *mntpoint) {
+	// The capacity is always the next power of two, so grow when we hit it.
+	if ((part->mntcount & (part->mntcount - 1)) == 0) {
+		uint32_t capacity = (part->mntcount == 0) ? 1 : part->mntcount * 2;
+
+		part->mntpoints = arena_realloc(&container->arena, part->mntpoints,
+										sizeof(strref_t) * part->mntcount,
+										sizeof(strref_t) * capacity);
+	}
+
+	part->mntpoints[part->mntcount++] =
+		strpool_intern(&container->strings, mntpoint);
+}
+
+/**
+ * Sets the probed filesystem information of a partition.
+ *
+ * @param container Device container that owns the partition's strings.
+ * @param part      Partition structure.
+ * @param info      Probed filesystem information.
  */
-void device_partition_push(partition_container *parts, const char *name) {
-	parts->list = realloc(parts->list, sizeof(partition_t) * (parts->count + 1));
+void device_partition_set_info(stdev_container *container, partition_t *part,
+							   const probe_info_t *info) {
+	part->uuid = strpool_intern(&container->strings, info->uuid);
+	part->label = strpool_intern(&container->strings, info->label);
+	part->type = strpool_intern(&container->strings, info->type);
+}
 
-	strncpy(parts->list[parts->count++].name, name, PARTITION_NAME_MAX_LEN);
-	snprintf(parts->list[parts->count - 1].path, DEVICE_PATH_MAX_LEN, "/dev/%s",
-			parts->list[parts->count - 1].name);
-	parts->list[parts->count - 1].mntpoint[0] = '\0';
+/**
+ * Finds a storage device in a container by its name.
+ *
+ * @param  container Device container.
+ * @param  name      Name of the device.
+ * @return           The device or NULL if it isn't in the container.
+ */
+stdev_t *device_list_find(const stdev_container *container, const char *name) {
+	for (uint32_t i = 0; i < container->count; i++) {
+		if (strcmp(device_str(container, container->list[i].name), name) == 0)
+			return &container->list[i];
+	}
+
+	return NULL;
+}
+
+/**
+ * Removes a storage device from a container keeping the order of the others.
+ * Its memory is only reclaimed when the container is compacted or freed.
+ *
+ * @param container Device container.
+ * @param sd        Device inside the container to be removed.
+ */
+void device_list_remove(stdev_container *container, stdev_t *sd) {
+	uint32_t idx = sd - container->list;
+
+	memmove(&container->list[idx], &container->list[idx + 1],
+			sizeof(stdev_t) * (container->count - idx - 1));
+	container->count--;
+}
+
+/**
+ * Deep copies a storage device from one container into another.
+ *
+ * @param  dst Destination container.
+ * @param  src Container that owns the device.
+ * @param  sd  Storage device to be copied.
+ * @return     Copy of the device inside the destination container.
+ */
+stdev_t *device_list_copy(stdev_container *dst, const stdev_container *src,
+						  const stdev_t *sd) {
+	stdev_t copy = *sd;
+
+	// Copy the partitions.
+	memset(&copy.partitions, 0, sizeof(partition_container));
+	copy.name = strpool_intern(&dst->strings, device_str(src, sd->name));
+	for (uint32_t i = 0; i < sd->partitions.count; i++) {
+		const partition_t *part = &sd->partitions.list[i];
+		partition_t *cpart;
+
+		cpart = device_partition_push(dst, &copy.partitions,
+									  device_str(src, part->name));
+		*cpart = *part;
+		cpart->name = strpool_intern(&dst->strings, device_str(src, part->name));
+		cpart->uuid = strpool_intern(&dst->strings, device_str(src, part->uuid));
+		cpart->label = strpool_intern(&dst->strings,
+									  device_str(src, part->label));
+		cpart->type = strpool_intern(&dst->strings, device_str(src, part->type));
+
+		// Copy the mount points.
+		cpart->mntpoints = NULL;
+		cpart->mntcount = 0;
+		for (uint32_t j = 0; j < part->mntcount; j++) {
+			device_partition_mount_push(dst, cpart,
+										device_str(src, part->mntpoints[j]));
+		}
+	}
+
+	return device_list_push(dst, &copy);
+}
+
+/**
+ * Reclaims the memory left behind by devices that were removed or replaced
+ * by rebuilding the container from scratch.
+ *
+ * @param container Device container to be compacted.
+ */
+void device_container_compact(stdev_container *container) {
+	stdev_container fresh;
+
+	device_container_init(&fresh);
+	for (uint32_t i = 0; i < container->count; i++)
+		device_list_copy(&fresh, container, &container->list[i]);
+
+	device_container_free(container);
+	*container = fresh;
+}
+
+/**
+ * Sorts the devices of a container, and the partitions of each device, by
+ * their device numbers and then by their names, which is the only order that
+ * doesn't depend on how the kernel happened to list them.
+ *
+ * @param container Device container to be sorted.
+ */
+void device_container_sort(stdev_container *container) {
+	device_key_t *keys;
+	partition_t *parts;
+	stdev_t *list;
+	uint32_t max = container->count;
+
+	// Get scratch space big enough for the longest list.
+	for (uint32_t i = 0; i < container->count; i++) {
+		if (container->list[i].partitions.count > max)
+			max = container->list[i].partitions.count;
+	}
+	if (max < 2)
+		return;
+	keys = malloc(sizeof(device_key_t) * max);
+	parts = malloc(sizeof(partition_t) * max);
+
+	// Sort the partitions of every device.
+	for (uint32_t i = 0; i < container->count; i++) {
+		partition_container *plist = &container->list[i].partitions;
+
+		if (plist->count < 2)
+			continue;
+		for (uint32_t j = 0; j < plist->count; j++) {
+			keys[j].major = plist->list[j].major;
+			keys[j].minor = plist->list[j].minor;
+			keys[j].name = device_str(container, plist->list[j].name);
+			keys[j].idx = j;
+		}
+		qsort(keys, plist->count, sizeof(device_key_t), device_key_cmp);
+
+		for (uint32_t j = 0; j < plist->count; j++)
+			parts[j] = plist->list[keys[j].idx];
+		memcpy(plist->list, parts, sizeof(partition_t) * plist->count);
+	}
+	free(parts);
+
+	// Sort the devices themselves.
+	for (uint32_t i = 0; i < container->count; i++) {
+		keys[i].major = container->list[i].major;
+		keys[i].minor = container->list[i].minor;
+		keys[i].name = device_str(container, container->list[i].name);
+		keys[i].idx = i;
+	}
+	qsort(keys, container->count, sizeof(device_key_t), device_key_cmp);
+
+	list = malloc(sizeof(stdev_t) * container->capacity);
+	for (uint32_t i = 0; i < container->count; i++)
+		list[i] = container->list[keys[i].idx];
+	free(container->list);
+	container->list = list;
+
+	free(keys);
+}
+
+/**
+ * Checks if two storage devices, possibly from different containers, have
+ * exactly the same information.
+ *
+ * @param  ca Container that owns the first device.
+ * @param  a  First device.
+ * @param  cb Container that owns the second device.
+ * @param  b  Second device.
+ * @return    TRUE if both devices are the same.
+ */
+bool device_equal(const stdev_container *ca, const stdev_t *a,
+				  const stdev_container *cb, const stdev_t *b) {
+	// Check the device itself.
+	if ((a->sectors != b->sectors) || (a->sector_size != b->sector_size) ||
+			(a->major != b->major) || (a->minor != b->minor) ||
+			(a->ro != b->ro) || (a->partitions.count != b->partitions.count) ||
+			(strcmp(device_str(ca, a->name), device_str(cb, b->name)) != 0)) {
+		return false;
+	}
+
+	// Check its partitions.
+	for (uint32_t i = 0; i < a->partitions.count; i++) {
+		const partition_t *pa = &a->partitions.list[i];
+		const partition_t *pb = &b->partitions.list[i];
+
+		if ((pa->sectors != pb->sectors) || (pa->start != pb->start) ||
+				(pa->major != pb->major) || (pa->minor != pb->minor) ||
+				(pa->ro != pb->ro) || (pa->mntcount != pb->mntcount) ||
+				(strcmp(device_str(ca, pa->name), device_str(cb, pb->name)) != 0) ||
+				(strcmp(device_str(ca, pa->uuid), device_str(cb, pb->uuid)) != 0) ||
+				(strcmp(device_str(ca, pa->label), device_str(cb, pb->label)) != 0) ||
+				(strcmp(device_str(ca, pa->type), device_str(cb, pb->type)) != 0)) {
+			return false;
+		}
+
+		for (uint32_t j = 0; j < pa->mntcount; j++) {
+			if (strcmp(device_str(ca, pa->mntpoints[j]),
+					   device_str(cb, pb->mntpoints[j])) != 0) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Gets a string from the container's string pool.
+ *
+ * @param  container Device container.
+ * @param  ref       Reference to the string.
+ * @return           The string.
+ */
+const char *device_str(const stdev_container *container, strref_t ref) {
+	return strpool_get(&container->strings, ref);
+}
+
+/**
+ * Builds the path to the device file of a partition.
+ *
+ * @param container Device container.
+ * @param devroot   Directory where the device files live. (usually /dev)
+ * @param part      Partition structure.
+ * @param path      Buffer with at least DEVICE_PATH_MAX_LEN bytes.
+ */
+void device_partition_path(const stdev_container *container,
+						   const char *devroot, const partition_t *part,
+						   char *path) {
+	snprintf(path, DEVICE_PATH_MAX_LEN, "%s/%s", devroot,
+			 device_str(container, part->name));
 }
 
 /**
@@ -45,12 +352,10 @@ void device_partition_push(partition_container *parts, const char *name) {
  * @param container Storage device container to be freed.
  */
 void device_container_free(stdev_container *container) {
-	for (uint8_t i = 0; i < container->count; i++) {
-		free(container->list[i].partitions.list);
-	}
-
 	free(container->list);
-	container->count = 0;
+	arena_free(&container->arena);
+	strpool_free(&container->strings);
+	device_container_init(container);
 }
 
 /**
@@ -64,113 +369,204 @@ bool device_exists(const char *devpath) {
 }
 
 /**
- * Prints the device information.
+ * Adds to a set of device fields everything needed to gather them. Probing
+ * needs the partition geometry to validate the probe cache and mount points
+ * are matched by device number.
  *
- * @param sd     Storage device structure to be printed.
- * @param pretty FALSE will print everything we have on the device.
+ * @param  fields Device fields that are wanted. (DEVICE_FIELD_*)
+ * @return        Device fields that have to be gathered.
  */
-void device_print_info(const stdev_t sd, const bool pretty) {
-	float size;
-	char sunit;
-
-	// Print device information.
-	pretty_bytes(sd.size, &size, &sunit);
-	if (pretty) {
-		printf("%s (%s) " SIZE_PRINTF "\n", sd.name, sd.ro ? "R" : "R/W", size, sunit);
-	} else {
-		printf("Device:\t\t%s\n", sd.name);
-		printf("Sectors:\t%zu\n", sd.sectors);
-		printf("Sector Size:\t%zu bytes/sector\n", sd.sector_size);
-		printf("Size:\t\t" SIZE_PRINTF "\n", size, sunit);
-		printf("Permission:\t%s\n", sd.ro ? "Read Only" : "Read and Write");
+uint32_t device_fields_resolve(uint32_t fields) {
+	if (fields & DEVICE_FIELD_PROBE) {
+		fields |= DEVICE_FIELD_PARTSIZE | DEVICE_FIELD_DEVNUM |
+			DEVICE_FIELD_START;
 	}
-
-	// Print partition header.
-	if (sd.partitions.count > 0) {
-		if (!pretty)
-			printf("Partitions (%d):\n", sd.partitions.count);
-	} else {
-		printf("\tNo partitions available!\n");
+	if (fields & DEVICE_FIELD_MOUNTS)
+		fields |= DEVICE_FIELD_DEVNUM;
+	if (fields & (DEVICE_FIELD_PARTSIZE | DEVICE_FIELD_DEVNUM |
+			DEVICE_FIELD_START)) {
+		fields |= DEVICE_FIELD_PARTITIONS;
 	}
 
-	// Loop through the partitions and print their information.
-	for (int i = 0; i < sd.partitions.count; i++) {
-		// Get pretty size.
-		pretty_bytes(sd.partitions.list[i].size, &size, &sunit);
+	return fields;
+}
 
-		if (pretty) {
-			// Print "tree" thingy.
-			if (i == (sd.partitions.count - 1)) {
-				printf("\t\u2514 ");
-			} else {
-				printf("\t\u251C ");
-			}
+/**
+ * Prints all the information available about a storage device.
+ *
+ * @param container Storage device container.
+ * @param sd        Storage device.
+ * @param pretty    FALSE will print everything we have on the device.
+ */
+void device_print_info(const stdev_container *container, const stdev_t *sd,
+					   const bool pretty) {
+	buffer_t buf;
 
-			// Print information.
-			printf("%s (%s) [%s] " SIZE_PRINTF "\n", sd.partitions.list[i].name,
-					sd.partitions.list[i].ro ? "R" : "R/W",
-				   sd.partitions.list[i].type, size, sunit);
+	buffer_init(&buf);
+	device_format_info(container, sd, pretty, &buf);
 
-			// Print label.
-			if (sd.partitions.list[i].label[0] != '\0') {
-				printf("\t");
+	// Make sure whatever was printed before ends up before us.
+	fflush(stdout);
+	buffer_write(&buf, STDOUT_FILENO);
 
-				// If it's not the last partition continue the root branch.
-				if (i < (sd.partitions.count - 1)) {
-					printf("\u2502");
-				}
+	buffer_free(&buf);
+}
 
-				if (sd.partitions.list[i].mntpoint[0] != '\0') {
-					printf("\t\u251C ");
-				} else {
-					printf("\t\u2514 ");
-				}
+/**
+ * Renders all the information available about a storage device into a
+ * buffer, exactly as it should be printed.
+ *
+ * @param container Storage device container.
+ * @param sd        Storage device.
+ * @param pretty    FALSE will render everything we have on the device.
+ * @param buf       Buffer where the text will be appended.
+ */
+void device_format_info(const stdev_container *container, const stdev_t *sd,
+						const bool pretty, buffer_t *buf) {
+	// Device information.
+	if (pretty) {
+		buffer_append_str(buf, device_str(container, sd->name));
+		buffer_append_str(buf, sd->ro ? " (R) " : " (R/W) ");
+		device_format_size(buf, sd->size);
+		buffer_append_char(buf, '\n');
+	} else {
+		buffer_append_str(buf, "Device:\t\t");
+		buffer_append_str(buf, device_str(container, sd->name));
+		buffer_append_str(buf, "\nSectors:\t");
+		buffer_append_uint(buf, sd->sectors);
+		buffer_append_str(buf, "\nSector Size:\t");
+		buffer_append_uint(buf, sd->sector_size);
+		buffer_append_str(buf, " bytes/sector\nSize:\t\t");
+		device_format_size(buf, sd->size);
+		buffer_append_str(buf, sd->ro ? "\nPermission:\tRead Only\n" :
+						  "\nPermission:\tRead and Write\n");
+	}
 
-				printf("Label: %s\n", sd.partitions.list[i].label);
-			}
+	// Partition header.
+	if (sd->partitions.count > 0) {
+		if (!pretty) {
+			buffer_append_str(buf, "Partitions (");
+			buffer_append_uint(buf, sd->partitions.count);
+			buffer_append_str(buf, "):\n");
+		}
+	} else {
+		buffer_append_str(buf, "\tNo partitions available!\n");
+	}
 
-			// Print mount point.
-			if (sd.partitions.list[i].mntpoint[0] != '\0') {
-				printf("\t");
+	// Loop through the partitions and render their information.
+	for (uint32_t i = 0; i < sd->partitions.count; i++) {
+		const partition_t *part = &sd->partitions.list[i];
 
-				// If it's not the last partition continue the root branch.
-				if (i < (sd.partitions.count - 1)) {
-					printf("\u2502");
-				}
+		if (pretty) {
+			// If it's not the last partition continue the root branch.
+			const char *branch = (i < (sd->partitions.count - 1)) ?
+				"\t\u2502\t" : "\t\t";
 
-				// Are we the last item or there's the UUID to come?
-				if (sd.partitions.list[i].uuid[0] != '\0') {
-					printf("\t\u251C ");
-				} else {
-					printf("\t\u2514 ");
-				}
+			// Information with its "tree" thingy.
+			buffer_append_str(buf, (i == (sd->partitions.count - 1)) ?
+							  "\t\u2514 " : "\t\u251C ");
+			buffer_append_str(buf, device_str(container, part->name));
+			buffer_append_str(buf, part->ro ? " (R) [" : " (R/W) [");
+			buffer_append_str(buf, device_str(container, part->type));
+			buffer_append_str(buf, "] ");
+			device_format_size(buf, part->size);
+			buffer_append_char(buf, '\n');
 
-				printf("Mount Point: %s\n", sd.partitions.list[i].mntpoint);
+			// Label.
+			if (part->label != STRREF_EMPTY) {
+				buffer_append_str(buf, branch);
+				buffer_append_str(buf, (part->mntcount > 0) ? "\u251C " :
+								  "\u2514 ");
+				buffer_append_str(buf, "Label: ");
+				buffer_append_str(buf, device_str(container, part->label));
+				buffer_append_char(buf, '\n');
 			}
 
-			// Print UUID.
-			if (sd.partitions.list[i].uuid[0] != '\0') {
-				printf("\t");
-
-				// If it's not the last partition continue the root branch.
-				if (i < (sd.partitions.count - 1)) {
-					printf("\u2502");
-				}
+			// Mount points.
+			for (uint32_t j = 0; j < part->mntcount; j++) {
+				// Are we the last item or there's more to come?
+				buffer_append_str(buf, branch);
+				buffer_append_str(buf, ((j < (part->mntcount - 1)) ||
+										(part->uuid != STRREF_EMPTY)) ?
+								  "\u251C " : "\u2514 ");
+				buffer_append_str(buf, "Mount Point: ");
+				buffer_append_str(buf,
+					device_str(container, part->mntpoints[j]));
+				buffer_append_char(buf, '\n');
+			}
 
-				printf("\t\u2514 ");
-				printf("UUID: %s\n", sd.partitions.list[i].uuid);
+			// UUID.
+			if (part->uuid != STRREF_EMPTY) {
+				buffer_append_str(buf, branch);
+				buffer_append_str(buf, "\u2514 UUID: ");
+				buffer_append_str(buf, device_str(container, part->uuid));
+				buffer_append_char(buf, '\n');
 			}
 		} else {
-			printf("\t%d: %s\n", i, sd.partitions.list[i].name);
-			printf("\t\tUUID:        %s\n", sd.partitions.list[i].uuid);
-			printf("\t\tType:        %s\n", sd.partitions.list[i].type);
-			printf("\t\tLabel:       %s\n", sd.partitions.list[i].label);
-			printf("\t\tSectors:     %zu\n", sd.partitions.list[i].sectors);
-			printf("\t\tSize:        " SIZE_PRINTF "\n", size, sunit);
-			printf("\t\tPermission:  %s\n", sd.partitions.list[i].ro ? "Read Only" : "Read and Write");
-			printf("\t\tMount Point: %s\n", sd.partitions.list[i].mntpoint);
+			buffer_append_char(buf, '\t');
+			buffer_append_uint(buf, i);
+			buffer_append_str(buf, ": ");
+			buffer_append_str(buf, device_str(container, part->name));
+			buffer_append_str(buf, "\n\t\tUUID:        ");
+			buffer_append_str(buf, device_str(container, part->uuid));
+			buffer_append_str(buf, "\n\t\tType:        ");
+			buffer_append_str(buf, device_str(container, part->type));
+			buffer_append_str(buf, "\n\t\tLabel:       ");
+			buffer_append_str(buf, device_str(container, part->label));
+			buffer_append_str(buf, "\n\t\tSectors:     ");
+			buffer_append_uint(buf, part->sectors);
+			buffer_append_str(buf, "\n\t\tSize:        ");
+			device_format_size(buf, part->size);
+			buffer_append_str(buf, part->ro ?
+							  "\n\t\tPermission:  Read Only\n" :
+							  "\n\t\tPermission:  Read and Write\n");
+			if (part->mntcount == 0)
+				buffer_append_str(buf, "\t\tMount Point: \n");
+			for (uint32_t j = 0; j < part->mntcount; j++) {
+				buffer_append_str(buf, "\t\tMount Point: ");
+				buffer_append_str(buf,
+					device_str(container, part->mntpoints[j]));
+				buffer_append_char(buf, '\n');
+			}
 		}
 	}
 
-	printf("\n");
+	buffer_append_char(buf, '\n');
+}
+
+/**
+ * Renders a size in bytes with two decimal places and its unit.
+ *
+ * @param buf  Buffer where the text will be appended.
+ * @param size Size in bytes.
+ */
+void device_format_size(buffer_t *buf, uint64_t size) {
+	uint64_t hundredths;
+	char unit;
+
+	pretty_bytes(size, &hundredths, &unit);
+	buffer_append_uint(buf, hundredths / 100);
+	buffer_append_char(buf, '.');
+	buffer_append_char(buf, '0' + ((hundredths / 10) % 10));
+	buffer_append_char(buf, '0' + (hundredths % 10));
+	buffer_append_char(buf, unit);
+}
+
+/**
+ * Compares two sorting keys by device number and then by name.
+ *
+ * @param  a First key.
+ * @param  b Second key.
+ * @return   Negative, zero or positive like strcmp.
+ */
+int device_key_cmp(const void *a, const void *b) {
+	const device_key_t *ka = a;
+	const device_key_t *kb = b;
+
+	if (ka->major != kb->major)
+		return (ka->major < kb->major) ? -1 : 1;
+	if (ka->minor != kb->minor)
+		return (ka->minor < kb->minor) ? -1 : 1;
+
+	return strcmp(ka->name, kb->name);
 }
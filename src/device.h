@@ -12,57 +12,159 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <limits.h>
+#include "arena.h"
+#include "buffer.h"
+#include "strpool.h"
 
 // Constants.
-#define PARTITION_NAME_MAX_LEN 128
-#define PARTITION_TYPE_MAX_LEN 32
-#define DEVICE_PATH_MAX_LEN    PARTITION_NAME_MAX_LEN * 2
+#define PARTITION_NAME_MAX_LEN    128
+#define PARTITION_TYPE_MAX_LEN    32
+#define DEVICE_PATH_MAX_LEN       PARTITION_NAME_MAX_LEN * 2
+#define DEVICE_SYSFS_DEF_ROOT     "/sys"
+#define DEVICE_DEV_DEF_ROOT       "/dev"
+#define DEVICE_MOUNTINFO_DEF_PATH "/proc/self/mountinfo"
+#define DEVICE_MTAB_DEF_PATH      "/etc/mtab"
 
-// Device partition structure.
+// Filesystem information gathered by probing a partition, before it gets
+// interned into the container.
 typedef struct {
-	char   name[PARTITION_NAME_MAX_LEN];
-	char   path[DEVICE_PATH_MAX_LEN];
-	char   uuid[PARTITION_NAME_MAX_LEN];
-	char   label[PARTITION_NAME_MAX_LEN];
-	char   type[PARTITION_TYPE_MAX_LEN];
-	char   mntpoint[DEVICE_PATH_MAX_LEN];
-	size_t sectors;
-	size_t size;
-	bool   ro;
+	char uuid[PARTITION_NAME_MAX_LEN];
+	char label[PARTITION_NAME_MAX_LEN];
+	char type[PARTITION_TYPE_MAX_LEN];
+} probe_info_t;
+
+// Device partition structure. Strings live in the container's string pool.
+typedef struct {
+	uint64_t  sectors;
+	uint64_t  size;
+	uint64_t  start;
+	uint32_t  major;
+	uint32_t  minor;
+	strref_t  name;
+	strref_t  uuid;
+	strref_t  label;
+	strref_t  type;
+	uint32_t  mntcount;
+	bool      ro;
+	strref_t *mntpoints;
 } partition_t;
 
 // Partition dynamic array.
 typedef struct {
-	uint8_t      count;
+	uint32_t     count;
+	uint32_t     capacity;
 	partition_t *list;
 } partition_container;
 
 // Storage device structure.
 typedef struct {
-	char   name[PARTITION_NAME_MAX_LEN];
-	char   path[DEVICE_PATH_MAX_LEN];
-	size_t sectors;
-	size_t sector_size;
-	size_t size;
-	bool   ro;
+	uint64_t sectors;
+	uint64_t sector_size;
+	uint64_t size;
+	uint32_t major;
+	uint32_t minor;
+	strref_t name;
+	bool     ro;
 	partition_container partitions;
 } stdev_t;
 
-// Storage device dynamic array.
+// Storage device dynamic array. Everything that hangs off the devices is
+// allocated from the arena and every string is interned in the pool.
 typedef struct {
-	uint8_t count;
-	stdev_t *list;
+	uint32_t  count;
+	uint32_t  capacity;
+	stdev_t  *list;
+	arena_t   arena;
+	strpool_t strings;
 } stdev_container;
 
+// Information that can be gathered about devices besides their names and
+// sizes, which are always needed to tell if they exist.
+#define DEVICE_FIELD_RO         (1 << 0)  // Device and partition permissions.
+#define DEVICE_FIELD_PARTITIONS (1 << 1)  // Partition names.
+#define DEVICE_FIELD_PARTSIZE   (1 << 2)  // Partition sizes.
+#define DEVICE_FIELD_DEVNUM     (1 << 3)  // Partition device numbers.
+#define DEVICE_FIELD_START      (1 << 4)  // Partition starting sectors.
+#define DEVICE_FIELD_MOUNTS     (1 << 5)  // Mount points and mounted types.
+#define DEVICE_FIELD_PROBE      (1 << 6)  // Probed type, label and UUID.
+#define DEVICE_FIELD_DISKNUM    (1 << 7)  // Device numbers of whole devices.
+#define DEVICE_FIELD_ALL        0xFF
+
+// Where the system exposes its devices and mount table. Everything can be
+// pointed somewhere else to run against a fixture instead of the live system.
+typedef struct {
+	const char *sysfs;
+	const char *dev;
+	const char *mountinfo;
+	const char *mtab;
+} device_roots_t;
+
+// Device filter. (see filter.h)
+typedef struct filter_s filter_t;
+
+// Phase timings and counters. (see profile.h)
+typedef struct profile_s profile_t;
+
+// Called, in order, for each device as soon as it's fully populated.
+typedef void (*device_ready_func_t)(const stdev_container *container,
+									const stdev_t *sd, void *arg);
+
+// Device population options.
+typedef struct {
+	bool                useblkid;
+	unsigned int        jobs;
+	const char         *cache_path;
+	bool                refresh;
+	const char         *udev_path;
+	device_ready_func_t on_ready;
+	void               *ready_arg;
+	const filter_t     *filter;
+	uint32_t            fields;
+	bool                debug;
+	bool                uring;
+	device_roots_t      roots;
+	profile_t          *profile;
+} populate_opts_t;
+
 // Checking.
 bool device_exists(const char *devpath);
+uint32_t device_fields_resolve(uint32_t fields);
+
+// Initialization.
+void device_container_init(stdev_container *container);
 
 // List operation.
-void device_list_push(stdev_container *list, stdev_t sd);
-void device_partition_push(partition_container *parts, const char *name);
+stdev_t *device_list_push(stdev_container *container, const stdev_t *sd);
+partition_t *device_partition_push(stdev_container *container,
+								   partition_container *parts,
+								   const char *name);
+void device_partition_mount_push(stdev_container *container, partition_t *part,
+								 const char *mntpoint);
+void device_partition_set_info(stdev_container *container, partition_t *part,
+							   const probe_info_t *info);
+stdev_t *device_list_find(const stdev_container *container, const char *name);
+void device_list_remove(stdev_container *container, stdev_t *sd);
+stdev_t *device_list_copy(stdev_container *dst, const stdev_container *src,
+						  const stdev_t *sd);
+void device_container_compact(stdev_container *container);
+void device_container_sort(stdev_container *container);
+
+// Comparison.
+bool device_equal(const stdev_container *ca, const stdev_t *a,
+				  const stdev_container *cb, const stdev_t *b);
+
+// Strings.
+const char *device_str(const stdev_container *container, strref_t ref);
+void device_partition_path(const stdev_container *container,
+						   const char *devroot, const partition_t *part,
+						   char *path);
 
 // Showing off.
-void device_print_info(const stdev_t sd, const bool pretty);
+void device_print_info(const stdev_container *container, const stdev_t *sd,
+					   const bool pretty);
+void device_format_info(const stdev_container *container, const stdev_t *sd,
+						const bool pretty, buffer_t *buf);
+void device_format_size(buffer_t *buf, uint64_t size);
 
 // Clean up.
 void device_container_free(stdev_container *container);
@@ -0,0 +1,339 @@
+/**
+ * diff.c
+ * Differences between two listings of the storage devices.
+ *
+ * Both listings have to be sorted with device_container_sort, so they can be
+ * walked side by side and matched up by device number and name. Devices and
+ * partitions that only exist on one side are reported as added or removed,
+ * the ones on both only get the fields that changed:
+ *
+ *   + sdb 500.11G
+ *   - sdc
+ *   ~ sda size 100.00G -> 200.00G
+ *   ~ sda1 mounts /mnt -> /mnt,/boot
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "diff.h"
+#include <string.h>
+
+// Private methods.
+int diff_cmp(uint32_t amajor, uint32_t aminor, const char *aname,
+			 uint32_t bmajor, uint32_t bminor, const char *bname);
+uint32_t diff_device(const stdev_container *ca, const stdev_t *a,
+					 const stdev_container *cb, const stdev_t *b,
+					 buffer_t *buf);
+uint32_t diff_partition(const stdev_container *ca, const partition_t *a,
+						const stdev_container *cb, const partition_t *b,
+						buffer_t *buf);
+void diff_presence(buffer_t *buf, char sign, const char *name, uint64_t size);
+void diff_field(buffer_t *buf, const char *name, const char *field);
+void diff_size(buffer_t *buf, const char *name, uint64_t from, uint64_t to);
+void diff_str(buffer_t *buf, const char *name, const char *field,
+			  const char *from, const char *to);
+void diff_mounts(buffer_t *buf, const stdev_container *container,
+				 const partition_t *part);
+
+/**
+ * Describes everything that changed between two sorted listings.
+ *
+ * @param  old Listing that was taken before.
+ * @param  cur Listing that was just taken.
+ * @param  buf Buffer where the changes will be appended, one per line.
+ * @return     Number of changes found.
+ */
+uint32_t diff_containers(const stdev_container *old, const stdev_container *cur,
+						 buffer_t *buf) {
+	uint32_t changes = 0;
+	uint32_t i = 0;
+	uint32_t j = 0;
+	int cmp;
+
+	while ((i < old->count) || (j < cur->count)) {
+		const stdev_t *a = (i < old->count) ? &old->list[i] : NULL;
+		const stdev_t *b = (j < cur->count) ? &cur->list[j] : NULL;
+
+		// Find out which side is behind.
+		if (b == NULL) {
+			cmp = -1;
+		} else if (a == NULL) {
+			cmp = 1;
+		} else {
+			cmp = diff_cmp(a->major, a->minor, device_str(old, a->name),
+						   b->major, b->minor, device_str(cur, b->name));
+		}
+
+		// Report it.
+		if (cmp < 0) {
+			diff_presence(buf, '-', device_str(old, a->name), 0);
+			changes++;
+			i++;
+		} else if (cmp > 0) {
+			diff_presence(buf, '+', device_str(cur, b->name), b->size);
+			changes++;
+			j++;
+		} else {
+			changes += diff_device(old, a, cur, b, buf);
+			i++;
+			j++;
+		}
+	}
+
+	return changes;
+}
+
+/**
+ * Describes what changed in a device that's in both listings.
+ *
+ * @param  ca  Container of the old listing.
+ * @param  a   Device as it was.
+ * @param  cb  Container of the current listing.
+ * @param  b   Device as it is now.
+ * @param  buf Buffer where the changes will be appended.
+ * @return     Number of changes found.
+ */
+uint32_t diff_device(const stdev_container *ca, const stdev_t *a,
+					 const stdev_container *cb, const stdev_t *b,
+					 buffer_t *buf) {
+	const char *name = device_str(cb, b->name);
+	uint32_t changes = 0;
+	uint32_t i = 0;
+	uint32_t j = 0;
+	int cmp;
+
+	// Check the device itself.
+	if (a->size != b->size) {
+		diff_size(buf, name, a->size, b->size);
+		changes++;
+	}
+	if (a->sector_size != b->sector_size) {
+		diff_field(buf, name, "sector-size");
+		buffer_append_uint(buf, a->sector_size);
+		buffer_append_str(buf, " -> ");
+		buffer_append_uint(buf, b->sector_size);
+		buffer_append_char(buf, '\n');
+		changes++;
+	}
+	if (a->ro != b->ro) {
+		diff_str(buf, name, "mode", a->ro ? "R" : "R/W", b->ro ? "R" : "R/W");
+		changes++;
+	}
+
+	// Walk its partitions side by side.
+	while ((i < a->partitions.count) || (j < b->partitions.count)) {
+		const partition_t *pa = (i < a->partitions.count) ?
+			&a->partitions.list[i] : NULL;
+		const partition_t *pb = (j < b->partitions.count) ?
+			&b->partitions.list[j] : NULL;
+
+		// Find out which side is behind.
+		if (pb == NULL) {
+			cmp = -1;
+		} else if (pa == NULL) {
+			cmp = 1;
+		} else {
+			cmp = diff_cmp(pa->major, pa->minor, device_str(ca, pa->name),
+						   pb->major, pb->minor, device_str(cb, pb->name));
+		}
+
+		// Report it.
+		if (cmp < 0) {
+			diff_presence(buf, '-', device_str(ca, pa->name), 0);
+			changes++;
+			i++;
+		} else if (cmp > 0) {
+			diff_presence(buf, '+', device_str(cb, pb->name), pb->size);
+			changes++;
+			j++;
+		} else {
+			changes += diff_partition(ca, pa, cb, pb, buf);
+			i++;
+			j++;
+		}
+	}
+
+	return changes;
+}
+
+/**
+ * Describes what changed in a partition that's in both listings.
+ *
+ * @param  ca  Container of the old listing.
+ * @param  a   Partition as it was.
+ * @param  cb  Container of the current listing.
+ * @param  b   Partition as it is now.
+ * @param  buf Buffer where the changes will be appended.
+ * @return     Number of changes found.
+ */
+uint32_t diff_partition(const stdev_container *ca, const partition_t *a,
+						const stdev_container *cb, const partition_t *b,
+						buffer_t *buf) {
+	const char *name = device_str(cb, b->name);
+	uint32_t changes = 0;
+	bool remounted;
+
+	// Geometry and permissions.
+	if (a->size != b->size) {
+		diff_size(buf, name, a->size, b->size);
+		changes++;
+	}
+	if (a->start != b->start) {
+		diff_field(buf, name, "start");
+		buffer_append_uint(buf, a->start);
+		buffer_append_str(buf, " -> ");
+		buffer_append_uint(buf, b->start);
+		buffer_append_char(buf, '\n');
+		changes++;
+	}
+	if (a->ro != b->ro) {
+		diff_str(buf, name, "mode", a->ro ? "R" : "R/W", b->ro ? "R" : "R/W");
+		changes++;
+	}
+
+	// Probed information.
+	if (strcmp(device_str(ca, a->type), device_str(cb, b->type)) != 0) {
+		diff_str(buf, name, "type", device_str(ca, a->type),
+				 device_str(cb, b->type));
+		changes++;
+	}
+	if (strcmp(device_str(ca, a->label), device_str(cb, b->label)) != 0) {
+		diff_str(buf, name, "label", device_str(ca, a->label),
+				 device_str(cb, b->label));
+		changes++;
+	}
+	if (strcmp(device_str(ca, a->uuid), device_str(cb, b->uuid)) != 0) {
+		diff_str(buf, name, "uuid", device_str(ca, a->uuid),
+				 device_str(cb, b->uuid));
+		changes++;
+	}
+
+	// Mount points.
+	remounted = a->mntcount != b->mntcount;
+	for (uint32_t i = 0; !remounted && (i < a->mntcount); i++) {
+		remounted = strcmp(device_str(ca, a->mntpoints[i]),
+						   device_str(cb, b->mntpoints[i])) != 0;
+	}
+	if (remounted) {
+		diff_field(buf, name, "mounts");
+		diff_mounts(buf, ca, a);
+		buffer_append_str(buf, " -> ");
+		diff_mounts(buf, cb, b);
+		buffer_append_char(buf, '\n');
+		changes++;
+	}
+
+	return changes;
+}
+
+/**
+ * Compares two devices or partitions by device number and then by name, the
+ * same way device_container_sort orders them.
+ *
+ * @param  amajor Major number of the first one.
+ * @param  aminor Minor number of the first one.
+ * @param  aname  Name of the first one.
+ * @param  bmajor Major number of the second one.
+ * @param  bminor Minor number of the second one.
+ * @param  bname  Name of the second one.
+ * @return        Negative, zero or positive like strcmp.
+ */
+int diff_cmp(uint32_t amajor, uint32_t aminor, const char *aname,
+			 uint32_t bmajor, uint32_t bminor, const char *bname) {
+	if (amajor != bmajor)
+		return (amajor < bmajor) ? -1 : 1;
+	if (aminor != bminor)
+		return (aminor < bminor) ? -1 : 1;
+
+	return strcmp(aname, bname);
+}
+
+/**
+ * Reports a device or partition that was added or removed.
+ *
+ * @param buf  Buffer where the line will be appended.
+ * @param sign '+' if it was added or '-' if it was removed.
+ * @param name Name of the device or partition.
+ * @param size Its size if it was added.
+ */
+void diff_presence(buffer_t *buf, char sign, const char *name, uint64_t size) {
+	buffer_append_char(buf, sign);
+	buffer_append_char(buf, ' ');
+	buffer_append_str(buf, name);
+	if (sign == '+') {
+		buffer_append_char(buf, ' ');
+		device_format_size(buf, size);
+	}
+	buffer_append_char(buf, '\n');
+}
+
+/**
+ * Starts the line of a field that changed.
+ *
+ * @param buf   Buffer where the line will be appended.
+ * @param name  Name of the device or partition.
+ * @param field Name of the field.
+ */
+void diff_field(buffer_t *buf, const char *name, const char *field) {
+	buffer_append_str(buf, "~ ");
+	buffer_append_str(buf, name);
+	buffer_append_char(buf, ' ');
+	buffer_append_str(buf, field);
+	buffer_append_char(buf, ' ');
+}
+
+/**
+ * Reports a size that changed.
+ *
+ * @param buf  Buffer where the line will be appended.
+ * @param name Name of the device or partition.
+ * @param from Size it had before.
+ * @param to   Size it has now.
+ */
+void diff_size(buffer_t *buf, const char *name, uint64_t from, uint64_t to) {
+	diff_field(buf, name, "size");
+	device_format_size(buf, from);
+	buffer_append_str(buf, " -> ");
+	device_format_size(buf, to);
+	buffer_append_char(buf, '\n');
+}
+
+/**
+ * Reports a text field that changed. Empty values are shown as a dash.
+ *
+ * @param buf   Buffer where the line will be appended.
+ * @param name  Name of the device or partition.
+ * @param field Name of the field.
+ * @param from  Value it had before.
+ * @param to    Value it has now.
+ */
+void diff_str(buffer_t *buf, const char *name, const char *field,
+			  const char *from, const char *to) {
+	diff_field(buf, name, field);
+	buffer_append_str(buf, (from[0] != '\0') ? from : "-");
+	buffer_append_str(buf, " -> ");
+	buffer_append_str(buf, (to[0] != '\0') ? to : "-");
+	buffer_append_char(buf, '\n');
+}
+
+/**
+ * Appends the mount points of a partition separated by commas, or a dash if
+ * it isn't mounted.
+ *
+ * @param buf       Buffer where the mount points will be appended.
+ * @param container Container that owns the partition.
+ * @param part      Partition.
+ */
+void diff_mounts(buffer_t *buf, const stdev_container *container,
+				 const partition_t *part) {
+	if (part->mntcount == 0) {
+		buffer_append_char(buf, '-');
+		return;
+	}
+
+	for (uint32_t i = 0; i < part->mntcount; i++) {
+		if (i > 0)
+			buffer_append_char(buf, ',');
+		buffer_append_str(buf, device_str(container, part->mntpoints[i]));
+	}
+}
@@ -0,0 +1,21 @@
+/**
+ * diff.h
+ * Differences between two listings of the storage devices.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _DIFF_H
+#define _DIFF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "device.h"
+#include "buffer.h"
+
+// Comparison.
+uint32_t diff_containers(const stdev_container *old, const stdev_container *cur,
+						 buffer_t *buf);
+
+#endif  //_DIFF_H
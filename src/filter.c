@@ -0,0 +1,790 @@
+/**
+ * filter.c
+ * Selects which storage devices we care about using name globs and a small
+ * predicate language.
+ *
+ * Predicates are made out of comparisons between a field and a value, like
+ * "size>1T" or "type==xfs", combined with "&&", "||", "!" and parenthesis.
+ * String fields are compared using globs, numbers accept K, M, G, T and P
+ * (powers of 1000) suffixes, and flags like "ro" stand on their own.
+ * Partition fields (type, label, uuid and mountpoint) match if any of the
+ * device's partitions do.
+ *
+ * Devices get filtered a few times while they're being populated, each time
+ * knowing a bit more about them. Anything that can't be answered yet
+ * evaluates as unknown, so a device only gets dropped as soon as it can't
+ * possibly match, before any of the expensive steps run on it.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "filter.h"
+#include <stdio.h>
+#include <string.h>
+#include <fnmatch.h>
+#include "utils.h"
+
+// Kinds of values a field can hold.
+typedef enum {
+	FIELD_KIND_STR,
+	FIELD_KIND_NUM,
+	FIELD_KIND_FLAG
+} field_kind_t;
+
+// Fields that can be used in a predicate.
+typedef enum {
+	FIELD_NAME,
+	FIELD_SIZE,
+	FIELD_SECTORS,
+	FIELD_RO,
+	FIELD_PARTITIONS,
+	FIELD_MOUNTPOINT,
+	FIELD_TYPE,
+	FIELD_LABEL,
+	FIELD_UUID
+} filter_field_t;
+
+// Field description.
+typedef struct {
+	const char    *name;
+	field_kind_t   kind;
+	filter_stage_t stage;
+	uint32_t       needs;
+} field_desc_t;
+
+// Comparison operators.
+typedef enum {
+	OP_EQ,
+	OP_NE,
+	OP_LT,
+	OP_LE,
+	OP_GT,
+	OP_GE
+} filter_op_t;
+
+// Node types.
+typedef enum {
+	NODE_AND,
+	NODE_OR,
+	NODE_NOT,
+	NODE_CMP,
+	NODE_FLAG
+} node_type_t;
+
+// Predicate expression node.
+struct filter_node_s {
+	node_type_t    type;
+	filter_field_t field;
+	filter_op_t    op;
+	uint32_t       left;
+	uint32_t       right;
+	uint64_t       num;
+	char          *str;
+};
+
+// Expression parser state.
+typedef struct {
+	filter_t   *filter;
+	const char *cur;
+} filter_parser_t;
+
+// What we know about the device being evaluated.
+typedef struct {
+	const stdev_container *container;
+	const stdev_t         *sd;
+	const char            *name;
+	filter_stage_t         stage;
+} filter_ctx_t;
+
+// Fields available, in the same order as filter_field_t.
+static const field_desc_t fields[] = {
+	{ "name",       FIELD_KIND_STR,  FILTER_STAGE_NAME, 0 },
+	{ "size",       FIELD_KIND_NUM,  FILTER_STAGE_DEVICE, 0 },
+	{ "sectors",    FIELD_KIND_NUM,  FILTER_STAGE_DEVICE, 0 },
+	{ "ro",         FIELD_KIND_FLAG, FILTER_STAGE_DEVICE, DEVICE_FIELD_RO },
+	{ "partitions", FIELD_KIND_NUM,  FILTER_STAGE_PARTITIONS,
+		DEVICE_FIELD_PARTITIONS },
+	{ "mountpoint", FIELD_KIND_STR,  FILTER_STAGE_PARTITIONS,
+		DEVICE_FIELD_MOUNTS },
+	{ "type",       FIELD_KIND_STR,  FILTER_STAGE_FINAL,
+		DEVICE_FIELD_MOUNTS | DEVICE_FIELD_PROBE },
+	{ "label",      FIELD_KIND_STR,  FILTER_STAGE_FINAL, DEVICE_FIELD_PROBE },
+	{ "uuid",       FIELD_KIND_STR,  FILTER_STAGE_FINAL, DEVICE_FIELD_PROBE }
+};
+
+// Private methods.
+void filter_push_glob(char ***list, uint32_t *count, const char *glob);
+uint32_t filter_node_push(filter_t *filter, node_type_t type, uint32_t left,
+						  uint32_t right);
+bool parse_or(filter_parser_t *p, uint32_t *node);
+bool parse_and(filter_parser_t *p, uint32_t *node);
+bool parse_unary(filter_parser_t *p, uint32_t *node);
+bool parse_cmp(filter_parser_t *p, uint32_t *node);
+bool parse_value(filter_parser_t *p, filter_node_t *node);
+bool parse_match(filter_parser_t *p, const char *token);
+bool parse_error(filter_parser_t *p, const char *msg);
+filter_result_t eval_node(const filter_t *filter, uint32_t idx,
+						  const filter_ctx_t *ctx);
+filter_result_t eval_cmp(const filter_node_t *node, const filter_ctx_t *ctx);
+bool eval_partitions(const filter_node_t *node, const filter_ctx_t *ctx);
+filter_result_t eval_num(filter_op_t op, uint64_t a, uint64_t b);
+
+/**
+ * Initializes an empty filter that lets everything through.
+ *
+ * @param filter Filter to be initialized.
+ */
+void filter_init(filter_t *filter) {
+	memset(filter, 0, sizeof(filter_t));
+}
+
+/**
+ * Adds a device name glob that devices must match. When any are set, devices
+ * have to match at least one of them.
+ *
+ * @param filter Filter.
+ * @param glob   Device name glob.
+ */
+void filter_include(filter_t *filter, const char *glob) {
+	filter_push_glob(&filter->include, &filter->ninclude, glob);
+}
+
+/**
+ * Adds a device name glob that devices must not match.
+ *
+ * @param filter Filter.
+ * @param glob   Device name glob.
+ */
+void filter_exclude(filter_t *filter, const char *glob) {
+	filter_push_glob(&filter->exclude, &filter->nexclude, glob);
+}
+
+/**
+ * Parses a predicate expression. Multiple expressions must all match.
+ *
+ * @param  filter Filter.
+ * @param  expr   Predicate expression.
+ * @return        TRUE if the expression was valid.
+ */
+bool filter_parse(filter_t *filter, const char *expr) {
+	filter_parser_t p;
+	uint32_t node;
+
+	p.filter = filter;
+	p.cur = expr;
+	if (!parse_or(&p, &node))
+		return false;
+	if (!parse_match(&p, ""))
+		return false;
+	if (*p.cur != '\0')
+		return parse_error(&p, "unexpected characters");
+
+	// Combine it with any previous expressions.
+	if (filter->root != 0)
+		node = filter_node_push(filter, NODE_AND, filter->root, node);
+	filter->root = node;
+
+	return true;
+}
+
+/**
+ * Checks if a device name goes through the filter. This is done before
+ * anything else is known about the device.
+ *
+ * @param  filter Filter or NULL to let everything through.
+ * @param  name   Device name.
+ * @return        TRUE if the device might match.
+ */
+bool filter_name(const filter_t *filter, const char *name) {
+	filter_ctx_t ctx;
+	bool included;
+
+	if (filter == NULL)
+		return true;
+
+	// Name globs.
+	included = filter->ninclude == 0;
+	for (uint32_t i = 0; !included && (i < filter->ninclude); i++)
+		included = fnmatch(filter->include[i], name, 0) == 0;
+	if (!included)
+		return false;
+	for (uint32_t i = 0; i < filter->nexclude; i++) {
+		if (fnmatch(filter->exclude[i], name, 0) == 0)
+			return false;
+	}
+
+	// Predicates that only need the name.
+	if (filter->nnodes == 0)
+		return true;
+	ctx.container = NULL;
+	ctx.sd = NULL;
+	ctx.name = name;
+	ctx.stage = FILTER_STAGE_NAME;
+
+	return eval_node(filter, filter->root, &ctx) != FILTER_FALSE;
+}
+
+/**
+ * Evaluates the predicate with what's known about a device so far.
+ *
+ * @param  filter    Filter.
+ * @param  container Storage device container that owns the device strings.
+ * @param  sd        Storage device.
+ * @param  stage     How much we know about the device.
+ * @return           Result of the evaluation.
+ */
+filter_result_t filter_eval(const filter_t *filter,
+							const stdev_container *container,
+							const stdev_t *sd, filter_stage_t stage) {
+	filter_ctx_t ctx;
+
+	if (filter->nnodes == 0)
+		return FILTER_TRUE;
+
+	ctx.container = container;
+	ctx.sd = sd;
+	ctx.name = device_str(container, sd->name);
+	ctx.stage = stage;
+
+	return eval_node(filter, filter->root, &ctx);
+}
+
+/**
+ * Checks if a device might still match the filter.
+ *
+ * @param  filter    Filter or NULL to let everything through.
+ * @param  container Storage device container that owns the device strings.
+ * @param  sd        Storage device.
+ * @param  stage     How much we know about the device.
+ * @return           FALSE if the device can't possibly match.
+ */
+bool filter_match(const filter_t *filter, const stdev_container *container,
+				  const stdev_t *sd, filter_stage_t stage) {
+	if (filter == NULL)
+		return true;
+
+	return filter_eval(filter, container, sd, stage) != FILTER_FALSE;
+}
+
+/**
+ * Gets the device fields that have to be gathered to evaluate a filter.
+ *
+ * @param  filter Filter or NULL to let everything through.
+ * @return        Device fields used by the filter. (DEVICE_FIELD_*)
+ */
+uint32_t filter_fields(const filter_t *filter) {
+	uint32_t needs = 0;
+
+	if (filter == NULL)
+		return 0;
+
+	for (uint32_t i = 1; i < filter->nnodes; i++) {
+		const filter_node_t *node = &filter->nodes[i];
+
+		if ((node->type == NODE_CMP) || (node->type == NODE_FLAG))
+			needs |= fields[node->field].needs;
+	}
+
+	return needs;
+}
+
+/**
+ * Removes all the fully populated devices that don't match the filter from a
+ * container, keeping the order of the ones that are left. Devices go through
+ * the name globs and then the predicate, just like when they're populated,
+ * and partitions stay or go along with their devices.
+ *
+ * @param filter    Filter or NULL to let everything through.
+ * @param container Storage device container.
+ */
+void filter_container(const filter_t *filter, stdev_container *container) {
+	uint32_t count = 0;
+
+	if ((filter == NULL) || ((filter->nnodes == 0) &&
+			(filter->ninclude == 0) && (filter->nexclude == 0))) {
+		return;
+	}
+
+	for (uint32_t i = 0; i < container->count; i++) {
+		const stdev_t *sd = &container->list[i];
+
+		if (filter_name(filter, device_str(container, sd->name)) &&
+				filter_match(filter, container, sd, FILTER_STAGE_FINAL)) {
+			container->list[count++] = container->list[i];
+		}
+	}
+
+	container->count = count;
+}
+
+/**
+ * Frees up everything in a filter.
+ *
+ * @param filter Filter to be freed.
+ */
+void filter_free(filter_t *filter) {
+	for (uint32_t i = 0; i < filter->ninclude; i++)
+		free(filter->include[i]);
+	for (uint32_t i = 0; i < filter->nexclude; i++)
+		free(filter->exclude[i]);
+	for (uint32_t i = 0; i < filter->nnodes; i++)
+		free(filter->nodes[i].str);
+
+	free(filter->include);
+	free(filter->exclude);
+	free(filter->nodes);
+	filter_init(filter);
+}
+
+/**
+ * Appends a copy of a glob to a list.
+ *
+ * @param list  List of globs.
+ * @param count Number of globs in the list.
+ * @param glob  Glob to be appended.
+ */
+void filter_push_glob(char ***list, uint32_t *count, const char *glob) {
+	*list = realloc(*list, sizeof(char *) * (*count + 1));
+	(*list)[(*count)++] = strdup(glob);
+}
+
+/**
+ * Appends a node to the expression tree.
+ *
+ * @param  filter Filter.
+ * @param  type   Type of the node.
+ * @param  left   Left operand node.
+ * @param  right  Right operand node.
+ * @return        Index of the new node.
+ */
+uint32_t filter_node_push(filter_t *filter, node_type_t type, uint32_t left,
+						  uint32_t right) {
+	filter_node_t *node;
+
+	// Index zero is never used so that it can mean "no node".
+	if (filter->nnodes == 0) {
+		filter->nodes = calloc(1, sizeof(filter_node_t));
+		filter->nnodes = 1;
+	}
+
+	filter->nodes = realloc(filter->nodes,
+							sizeof(filter_node_t) * (filter->nnodes + 1));
+	node = &filter->nodes[filter->nnodes];
+	memset(node, 0, sizeof(filter_node_t));
+	node->type = type;
+	node->left = left;
+	node->right = right;
+
+	return filter->nnodes++;
+}
+
+/**
+ * Parses an expression with "||" operators.
+ *
+ * @param  p    Parser state.
+ * @param  node Index of the parsed node.
+ * @return      TRUE if the expression was valid.
+ */
+bool parse_or(filter_parser_t *p, uint32_t *node) {
+	uint32_t right;
+
+	if (!parse_and(p, node))
+		return false;
+
+	while (parse_match(p, "||")) {
+		if (!parse_and(p, &right))
+			return false;
+		*node = filter_node_push(p->filter, NODE_OR, *node, right);
+	}
+
+	return true;
+}
+
+/**
+ * Parses an expression with "&&" operators.
+ *
+ * @param  p    Parser state.
+ * @param  node Index of the parsed node.
+ * @return      TRUE if the expression was valid.
+ */
+bool parse_and(filter_parser_t *p, uint32_t *node) {
+	uint32_t right;
+
+	if (!parse_unary(p, node))
+		return false;
+
+	while (parse_match(p, "&&")) {
+		if (!parse_unary(p, &right))
+			return false;
+		*node = filter_node_push(p->filter, NODE_AND, *node, right);
+	}
+
+	return true;
+}
+
+/**
+ * Parses a negation, a parenthesized expression or a comparison.
+ *
+ * @param  p    Parser state.
+ * @param  node Index of the parsed node.
+ * @return      TRUE if the expression was valid.
+ */
+bool parse_unary(filter_parser_t *p, uint32_t *node) {
+	uint32_t inner;
+
+	// Negation.
+	if (parse_match(p, "!")) {
+		if (!parse_unary(p, &inner))
+			return false;
+		*node = filter_node_push(p->filter, NODE_NOT, inner, 0);
+
+		return true;
+	}
+
+	// Parenthesis.
+	if (parse_match(p, "(")) {
+		if (!parse_or(p, node))
+			return false;
+		if (!parse_match(p, ")"))
+			return parse_error(p, "expected a closing parenthesis");
+
+		return true;
+	}
+
+	return parse_cmp(p, node);
+}
+
+/**
+ * Parses a comparison or a flag.
+ *
+ * @param  p    Parser state.
+ * @param  node Index of the parsed node.
+ * @return      TRUE if the expression was valid.
+ */
+bool parse_cmp(filter_parser_t *p, uint32_t *node) {
+	const char *ops[] = { "==", "!=", "<=", ">=", "<", ">" };
+	const filter_op_t opvals[] = { OP_EQ, OP_NE, OP_LE, OP_GE, OP_LT, OP_GT };
+	const char *start;
+	filter_node_t *n;
+	size_t len;
+	int field = -1;
+	int op = -1;
+
+	// Get the field name.
+	parse_match(p, "");
+	start = p->cur;
+	while (((*p->cur >= 'a') && (*p->cur <= 'z')) || (*p->cur == '_'))
+		p->cur++;
+	len = p->cur - start;
+	for (size_t i = 0; i < (sizeof(fields) / sizeof(fields[0])); i++) {
+		if ((strlen(fields[i].name) == len) &&
+				(strncmp(fields[i].name, start, len) == 0)) {
+			field = i;
+			break;
+		}
+	}
+	if (field == -1) {
+		p->cur = start;
+		return parse_error(p, "unknown field");
+	}
+
+	// Get the operator.
+	for (size_t i = 0; i < (sizeof(ops) / sizeof(ops[0])); i++) {
+		if (parse_match(p, ops[i])) {
+			op = opvals[i];
+			break;
+		}
+	}
+
+	// Flags stand on their own.
+	if (fields[field].kind == FIELD_KIND_FLAG) {
+		if (op != -1)
+			return parse_error(p, "flags can't be compared");
+
+		*node = filter_node_push(p->filter, NODE_FLAG, 0, 0);
+		p->filter->nodes[*node].field = field;
+		return true;
+	}
+
+	// Everything else needs something to be compared to.
+	if (op == -1)
+		return parse_error(p, "expected a comparison operator");
+	if ((fields[field].kind == FIELD_KIND_STR) && (op != OP_EQ) &&
+			(op != OP_NE)) {
+		return parse_error(p, "strings can only be compared with == or !=");
+	}
+
+	*node = filter_node_push(p->filter, NODE_CMP, 0, 0);
+	n = &p->filter->nodes[*node];
+	n->field = field;
+	n->op = op;
+
+	return parse_value(p, n);
+}
+
+/**
+ * Parses the value of a comparison. Strings may be quoted.
+ *
+ * @param  p    Parser state.
+ * @param  node Comparison node that will hold the value.
+ * @return      TRUE if the value was valid.
+ */
+bool parse_value(filter_parser_t *p, filter_node_t *node) {
+	const char *units = "KMGTP";
+	const char *start;
+	const char *stop;
+	const char *end;
+	const char *unit;
+	size_t num;
+	char c;
+
+	// Find where the value is.
+	parse_match(p, "");
+	start = p->cur;
+	if (*p->cur == '"') {
+		start = ++p->cur;
+		while ((*p->cur != '"') && (*p->cur != '\0'))
+			p->cur++;
+		if (*p->cur != '"')
+			return parse_error(p, "unterminated string");
+		stop = p->cur++;
+	} else {
+		while ((*p->cur != '\0') && (strchr(" \t\n()&|", *p->cur) == NULL))
+			p->cur++;
+		stop = p->cur;
+	}
+	if (start == stop)
+		return parse_error(p, "expected a value");
+
+	// Strings are used as they are.
+	if (fields[node->field].kind == FIELD_KIND_STR) {
+		node->str = strndup(start, stop - start);
+		return true;
+	}
+
+	// Numbers may have a unit suffix.
+	end = parse_num(start, &num);
+	if ((end == NULL) || (end > stop))
+		goto invalid;
+	node->num = num;
+	c = (end < stop) ? *end : '\0';
+	if ((c >= 'a') && (c <= 'z'))
+		c -= 'a' - 'A';
+	if ((c != '\0') && ((unit = strchr(units, c)) != NULL)) {
+		for (const char *u = units; u <= unit; u++) {
+			if (node->num > (UINT64_MAX / 1000))
+				goto invalid;
+			node->num *= 1000;
+		}
+		end++;
+	}
+
+	// And a B at the very end.
+	if ((end < stop) && ((*end == 'B') || (*end == 'b')))
+		end++;
+	if (end != stop)
+		goto invalid;
+
+	return true;
+
+invalid:
+	p->cur = start;
+	return parse_error(p, "invalid number");
+}
+
+/**
+ * Skips any whitespace and consumes a token if it's next.
+ *
+ * @param  p     Parser state.
+ * @param  token Token to be matched. An empty token only skips whitespace.
+ * @return       TRUE if the token was consumed.
+ */
+bool parse_match(filter_parser_t *p, const char *token) {
+	size_t len = strlen(token);
+
+	while ((*p->cur == ' ') || (*p->cur == '\t') || (*p->cur == '\n'))
+		p->cur++;
+
+	// Don't mistake the start of "!=" for a negation.
+	if ((strcmp(token, "!") == 0) && (strncmp(p->cur, "!=", 2) == 0))
+		return false;
+
+	if (strncmp(p->cur, token, len) != 0)
+		return false;
+
+	p->cur += len;
+	return true;
+}
+
+/**
+ * Reports a parsing error.
+ *
+ * @param  p   Parser state.
+ * @param  msg Error message.
+ * @return     Always FALSE.
+ */
+bool parse_error(filter_parser_t *p, const char *msg) {
+	if (*p->cur == '\0') {
+		fprintf(stderr, "Invalid filter at the end: %s\n", msg);
+	} else {
+		fprintf(stderr, "Invalid filter at \"%s\": %s\n", p->cur, msg);
+	}
+
+	return false;
+}
+
+/**
+ * Evaluates an expression node.
+ *
+ * @param  filter Filter.
+ * @param  idx    Index of the node.
+ * @param  ctx    What we know about the device.
+ * @return        Result of the evaluation.
+ */
+filter_result_t eval_node(const filter_t *filter, uint32_t idx,
+						  const filter_ctx_t *ctx) {
+	const filter_node_t *node = &filter->nodes[idx];
+	filter_result_t left;
+	filter_result_t right;
+
+	switch (node->type) {
+	case NODE_AND:
+		left = eval_node(filter, node->left, ctx);
+		if (left == FILTER_FALSE)
+			return FILTER_FALSE;
+		right = eval_node(filter, node->right, ctx);
+		if (right == FILTER_FALSE)
+			return FILTER_FALSE;
+		return ((left == FILTER_TRUE) && (right == FILTER_TRUE)) ?
+			FILTER_TRUE : FILTER_UNKNOWN;
+	case NODE_OR:
+		left = eval_node(filter, node->left, ctx);
+		if (left == FILTER_TRUE)
+			return FILTER_TRUE;
+		right = eval_node(filter, node->right, ctx);
+		if (right == FILTER_TRUE)
+			return FILTER_TRUE;
+		return ((left == FILTER_FALSE) && (right == FILTER_FALSE)) ?
+			FILTER_FALSE : FILTER_UNKNOWN;
+	case NODE_NOT:
+		left = eval_node(filter, node->left, ctx);
+		if (left == FILTER_UNKNOWN)
+			return FILTER_UNKNOWN;
+		return (left == FILTER_TRUE) ? FILTER_FALSE : FILTER_TRUE;
+	case NODE_CMP:
+	case NODE_FLAG:
+		return eval_cmp(node, ctx);
+	}
+
+	return FILTER_UNKNOWN;
+}
+
+/**
+ * Evaluates a comparison or a flag.
+ *
+ * @param  node Comparison node.
+ * @param  ctx  What we know about the device.
+ * @return      Result of the evaluation.
+ */
+filter_result_t eval_cmp(const filter_node_t *node, const filter_ctx_t *ctx) {
+	bool match;
+
+	// Can't tell just yet.
+	if (ctx->stage < fields[node->field].stage)
+		return FILTER_UNKNOWN;
+
+	switch (node->field) {
+	case FIELD_NAME:
+		match = fnmatch(node->str, ctx->name, 0) == 0;
+		break;
+	case FIELD_SIZE:
+		return eval_num(node->op, ctx->sd->size, node->num);
+	case FIELD_SECTORS:
+		return eval_num(node->op, ctx->sd->sectors, node->num);
+	case FIELD_RO:
+		return ctx->sd->ro ? FILTER_TRUE : FILTER_FALSE;
+	case FIELD_PARTITIONS:
+		return eval_num(node->op, ctx->sd->partitions.count, node->num);
+	default:
+		match = eval_partitions(node, ctx);
+		break;
+	}
+
+	// Strings can only be equal or not.
+	return (match == (node->op == OP_EQ)) ? FILTER_TRUE : FILTER_FALSE;
+}
+
+/**
+ * Checks if any of the device's partitions match a string comparison.
+ *
+ * @param  node Comparison node.
+ * @param  ctx  What we know about the device.
+ * @return      TRUE if any of the partitions match the glob.
+ */
+bool eval_partitions(const filter_node_t *node, const filter_ctx_t *ctx) {
+	const stdev_container *container = ctx->container;
+
+	for (uint32_t i = 0; i < ctx->sd->partitions.count; i++) {
+		const partition_t *part = &ctx->sd->partitions.list[i];
+		strref_t ref;
+
+		switch (node->field) {
+		case FIELD_MOUNTPOINT:
+			for (uint32_t j = 0; j < part->mntcount; j++) {
+				if (fnmatch(node->str, device_str(container,
+												  part->mntpoints[j]), 0) == 0)
+					return true;
+			}
+			continue;
+		case FIELD_TYPE:
+			ref = part->type;
+			break;
+		case FIELD_LABEL:
+			ref = part->label;
+			break;
+		default:
+			ref = part->uuid;
+			break;
+		}
+
+		if (fnmatch(node->str, device_str(container, ref), 0) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * Compares two numbers.
+ *
+ * @param  op Comparison operator.
+ * @param  a  Left side of the comparison.
+ * @param  b  Right side of the comparison.
+ * @return    FILTER_TRUE if the comparison holds.
+ */
+filter_result_t eval_num(filter_op_t op, uint64_t a, uint64_t b) {
+	bool result = false;
+
+	switch (op) {
+	case OP_EQ:
+		result = a == b;
+		break;
+	case OP_NE:
+		result = a != b;
+		break;
+	case OP_LT:
+		result = a < b;
+		break;
+	case OP_LE:
+		result = a <= b;
+		break;
+	case OP_GT:
+		result = a > b;
+		break;
+	case OP_GE:
+		result = a >= b;
+		break;
+	}
+
+	return result ? FILTER_TRUE : FILTER_FALSE;
+}
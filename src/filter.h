@@ -0,0 +1,65 @@
+/**
+ * filter.h
+ * Selects which storage devices we care about using name globs and a small
+ * predicate language.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _FILTER_H
+#define _FILTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "device.h"
+
+// How much we know about a device at the time it's being filtered.
+typedef enum {
+	FILTER_STAGE_NAME,
+	FILTER_STAGE_DEVICE,
+	FILTER_STAGE_PARTITIONS,
+	FILTER_STAGE_FINAL
+} filter_stage_t;
+
+// Result of evaluating a filter with what's known so far.
+typedef enum {
+	FILTER_FALSE,
+	FILTER_TRUE,
+	FILTER_UNKNOWN
+} filter_result_t;
+
+// Predicate expression node.
+typedef struct filter_node_s filter_node_t;
+
+// Device filter.
+struct filter_s {
+	char         **include;
+	uint32_t       ninclude;
+	char         **exclude;
+	uint32_t       nexclude;
+	filter_node_t *nodes;
+	uint32_t       nnodes;
+	uint32_t       root;
+};
+
+// Initialization.
+void filter_init(filter_t *filter);
+void filter_include(filter_t *filter, const char *glob);
+void filter_exclude(filter_t *filter, const char *glob);
+bool filter_parse(filter_t *filter, const char *expr);
+
+// Evaluation.
+bool filter_name(const filter_t *filter, const char *name);
+filter_result_t filter_eval(const filter_t *filter,
+							const stdev_container *container,
+							const stdev_t *sd, filter_stage_t stage);
+bool filter_match(const filter_t *filter, const stdev_container *container,
+				  const stdev_t *sd, filter_stage_t stage);
+void filter_container(const filter_t *filter, stdev_container *container);
+uint32_t filter_fields(const filter_t *filter);
+
+// Clean up.
+void filter_free(filter_t *filter);
+
+#endif  //_FILTER_H
@@ -0,0 +1,491 @@
+/**
+ * iostat.c
+ * Live throughput and latency sampling of block devices.
+ *
+ * The stat file of every device and partition is opened once and then read
+ * again from the start at every sample, either with pread or with a single
+ * io_uring submission for all of them, so a sample costs one read per file
+ * and nothing else, even with thousands of devices.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "iostat.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "utils.h"
+
+// Constants.
+#define IOSTAT_BLOCKDEVS_DIR "/block/"
+#define IOSTAT_NAME_HEADER   "Device"
+#define IOSTAT_TAB_WIDTH     8
+#define IOSTAT_COL_WIDTH     9
+#define IOSTAT_NS_PER_SEC    1000000000ULL
+
+// Fields of a stat file in the order the kernel writes them.
+enum {
+	IOSTAT_READ_IOS,
+	IOSTAT_READ_MERGES,
+	IOSTAT_READ_SECTORS,
+	IOSTAT_READ_TICKS,
+	IOSTAT_WRITE_IOS,
+	IOSTAT_WRITE_MERGES,
+	IOSTAT_WRITE_SECTORS,
+	IOSTAT_WRITE_TICKS,
+	IOSTAT_IN_FLIGHT,
+	IOSTAT_IO_TICKS,
+	IOSTAT_TIME_IN_QUEUE,
+	IOSTAT_FIELD_COUNT
+};
+
+// Headers of the columns.
+static const char *iostat_columns[] = {
+	"r/s", "w/s", "rkB/s", "wkB/s", "r_await", "w_await", "aqu-sz", "%util"
+};
+#define IOSTAT_COL_COUNT (sizeof(iostat_columns) / sizeof(iostat_columns[0]))
+
+// Private methods.
+bool iostat_entry_open(iostat_entry_t *entry, const char *path);
+void iostat_read(iostat_t *io);
+bool iostat_read_uring(iostat_t *io);
+bool iostat_parse(const char *buf, iostat_counters_t *counters);
+uint64_t iostat_now(void);
+uint32_t iostat_name_width(const stdev_container *container,
+						   const iostat_entry_t *entry);
+void iostat_format_entry(const iostat_t *io, const iostat_entry_t *entry,
+						 double secs, buffer_t *buf);
+void iostat_append_pad(buffer_t *buf, uint32_t count);
+void iostat_append_num(buffer_t *buf, double value);
+uint64_t iostat_delta(uint64_t prev, uint64_t cur);
+
+/**
+ * Opens the stat file of every device in a container and its partitions.
+ * Devices that go away later simply stop being sampled.
+ *
+ * @param  io         Sampler to be initialized.
+ * @param  container  Devices to be sampled. (must outlive the sampler)
+ * @param  sysfs_root Path to where sysfs is mounted.
+ * @param  uring      Read the stat files with io_uring if the kernel has it.
+ * @return            TRUE if the sampler is ready.
+ */
+bool iostat_open(iostat_t *io, const stdev_container *container,
+				 const char *sysfs_root, bool uring) {
+	char path[PATH_MAX];
+	uint32_t count = container->count;
+	uint32_t width;
+	uint8_t read_op = IORING_OP_READ;
+
+	// Allocate an entry for every device and partition.
+	memset(io, 0, sizeof(iostat_t));
+	io->container = container;
+	io->width = strlen(IOSTAT_NAME_HEADER);
+	for (uint32_t i = 0; i < container->count; i++)
+		count += container->list[i].partitions.count;
+	io->entries = calloc((count > 0) ? count : 1, sizeof(iostat_entry_t));
+	if (io->entries == NULL)
+		return false;
+
+	// Open the stat files, in the same order as the tree is shown.
+	for (uint32_t i = 0; i < container->count; i++) {
+		const stdev_t *sd = &container->list[i];
+		const char *name = device_str(container, sd->name);
+		iostat_entry_t *entry = &io->entries[io->count++];
+
+		entry->sd = sd;
+		snprintf(path, PATH_MAX, "%s%s%s/stat", sysfs_root,
+				 IOSTAT_BLOCKDEVS_DIR, name);
+		iostat_entry_open(entry, path);
+
+		for (uint32_t j = 0; j < sd->partitions.count; j++) {
+			const partition_t *part = &sd->partitions.list[j];
+			iostat_entry_t *pentry = &io->entries[io->count++];
+
+			pentry->sd = sd;
+			pentry->part = part;
+			pentry->last = j == (sd->partitions.count - 1);
+			snprintf(path, PATH_MAX, "%s%s%s/%s/stat", sysfs_root,
+					 IOSTAT_BLOCKDEVS_DIR, name,
+					 device_str(container, part->name));
+			iostat_entry_open(pentry, path);
+		}
+	}
+
+	// Line up the columns with the widest name.
+	for (uint32_t i = 0; i < io->count; i++) {
+		width = iostat_name_width(container, &io->entries[i]);
+		if (width > io->width)
+			io->width = width;
+	}
+
+	// Set up the ring.
+	io->uring = uring && uring_init(&io->ring, URING_DEF_ENTRIES, &read_op, 1);
+
+	return true;
+}
+
+/**
+ * Takes a sample of every device, keeping the previous one around.
+ *
+ * @param io Sampler.
+ */
+void iostat_sample(iostat_t *io) {
+	io->prev_ns = io->cur_ns;
+	io->cur_ns = iostat_now();
+	iostat_read(io);
+
+	for (uint32_t i = 0; i < io->count; i++) {
+		iostat_entry_t *entry = &io->entries[i];
+		bool ok;
+
+		entry->prev = entry->cur;
+		ok = (entry->len > 0) && iostat_parse(entry->buf, &entry->cur);
+		entry->valid = ok && entry->ok;
+		entry->ok = ok;
+	}
+}
+
+/**
+ * Keeps printing the activity of every device at a fixed interval until the
+ * output goes away. The samples are taken on absolute deadlines, so the time
+ * spent sampling and printing doesn't make the interval drift.
+ *
+ * @param  io          Sampler.
+ * @param  interval_ns Time between samples in nanoseconds.
+ * @param  fd          File descriptor to print to.
+ * @return             FALSE once the output couldn't be written.
+ */
+bool iostat_run(iostat_t *io, uint64_t interval_ns, int fd) {
+	uint64_t deadline;
+	uint64_t now;
+	struct timespec ts;
+	buffer_t buf;
+	bool success = true;
+
+	// Take the first sample to have something to compare against.
+	buffer_init(&buf);
+	iostat_sample(io);
+	deadline = io->cur_ns;
+
+	while (success) {
+		// Wait for the next deadline, skipping the ones we've already missed.
+		deadline += interval_ns;
+		now = iostat_now();
+		if (deadline < now)
+			deadline = now;
+		ts.tv_sec = deadline / IOSTAT_NS_PER_SEC;
+		ts.tv_nsec = deadline % IOSTAT_NS_PER_SEC;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts,
+							   NULL) == EINTR);
+
+		// Sample and print everything in a single write.
+		iostat_sample(io);
+		buffer_clear(&buf);
+		iostat_format(io, &buf);
+		success = buffer_write(&buf, fd);
+	}
+
+	buffer_free(&buf);
+	return success;
+}
+
+/**
+ * Renders the activity between the last two samples as a tree lined up with
+ * the one of the regular listing.
+ *
+ * @param io  Sampler.
+ * @param buf Buffer where the table will be appended.
+ */
+void iostat_format(const iostat_t *io, buffer_t *buf) {
+	double secs = (double)(io->cur_ns - io->prev_ns) / IOSTAT_NS_PER_SEC;
+
+	// Header.
+	buffer_append_str(buf, IOSTAT_NAME_HEADER);
+	iostat_append_pad(buf, io->width - strlen(IOSTAT_NAME_HEADER));
+	for (size_t i = 0; i < IOSTAT_COL_COUNT; i++) {
+		iostat_append_pad(buf, IOSTAT_COL_WIDTH - strlen(iostat_columns[i]));
+		buffer_append_str(buf, iostat_columns[i]);
+	}
+	buffer_append_char(buf, '\n');
+
+	// Devices and their partitions.
+	for (uint32_t i = 0; i < io->count; i++)
+		iostat_format_entry(io, &io->entries[i], secs, buf);
+	buffer_append_char(buf, '\n');
+}
+
+/**
+ * Closes every stat file and frees the sampler.
+ *
+ * @param io Sampler to be freed.
+ */
+void iostat_close(iostat_t *io) {
+	for (uint32_t i = 0; i < io->count; i++) {
+		if (io->entries[i].fd != -1)
+			close(io->entries[i].fd);
+	}
+	free(io->entries);
+	if (io->uring)
+		uring_free(&io->ring);
+
+	io->entries = NULL;
+	io->count = 0;
+	io->uring = false;
+}
+
+/**
+ * Opens the stat file of a device or partition.
+ *
+ * @param  entry Entry of the device or partition.
+ * @param  path  Path to its stat file.
+ * @return       TRUE if the file was opened.
+ */
+bool iostat_entry_open(iostat_entry_t *entry, const char *path) {
+	entry->len = -1;
+	entry->fd = open(path, O_RDONLY | O_CLOEXEC);
+	return entry->fd != -1;
+}
+
+/**
+ * Reads every stat file from the start.
+ *
+ * @param io Sampler.
+ */
+void iostat_read(iostat_t *io) {
+	// Give up on the ring for good if it fails on us.
+	if (io->uring) {
+		if (iostat_read_uring(io))
+			return;
+
+		uring_free(&io->ring);
+		io->uring = false;
+	}
+
+	for (uint32_t i = 0; i < io->count; i++) {
+		iostat_entry_t *entry = &io->entries[i];
+
+		entry->len = (entry->fd != -1) ?
+			pread(entry->fd, entry->buf, IOSTAT_STAT_BUF_LEN - 1, 0) : -1;
+		if (entry->len >= 0)
+			entry->buf[entry->len] = '\0';
+	}
+}
+
+/**
+ * Reads every stat file from the start with as few submissions as the ring
+ * allows.
+ *
+ * @param  io Sampler.
+ * @return    TRUE if every submission went through.
+ */
+bool iostat_read_uring(iostat_t *io) {
+	struct io_uring_sqe *sqe;
+	uint64_t idx;
+	int32_t res;
+	uint32_t i = 0;
+
+	while (i < io->count) {
+		// Queue as many reads as fit in the ring.
+		for (; (i < io->count) && (io->ring.queued < io->ring.entries); i++) {
+			iostat_entry_t *entry = &io->entries[i];
+
+			entry->len = -1;
+			if (entry->fd == -1)
+				continue;
+
+			sqe = uring_get_sqe(&io->ring);
+			sqe->opcode = IORING_OP_READ;
+			sqe->fd = entry->fd;
+			sqe->addr = (uintptr_t)entry->buf;
+			sqe->len = IOSTAT_STAT_BUF_LEN - 1;
+			sqe->off = 0;
+			sqe->user_data = i;
+		}
+		if (!uring_submit_wait(&io->ring))
+			return false;
+
+		// Collect them.
+		while (uring_next_cqe(&io->ring, &idx, &res)) {
+			iostat_entry_t *entry = &io->entries[idx];
+
+			entry->len = (res >= 0) ? res : -1;
+			if (entry->len >= 0)
+				entry->buf[entry->len] = '\0';
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Parses the counters we care about out of the contents of a stat file.
+ *
+ * @param  buf      Contents of the stat file.
+ * @param  counters Counters to be populated.
+ * @return          TRUE if every counter was there.
+ */
+bool iostat_parse(const char *buf, iostat_counters_t *counters) {
+	uint64_t fields[IOSTAT_FIELD_COUNT];
+	size_t num;
+
+	for (int i = 0; i < IOSTAT_FIELD_COUNT; i++) {
+		buf = parse_num(buf, &num);
+		if (buf == NULL)
+			return false;
+		fields[i] = num;
+	}
+
+	counters->rios = fields[IOSTAT_READ_IOS];
+	counters->rsectors = fields[IOSTAT_READ_SECTORS];
+	counters->rticks = fields[IOSTAT_READ_TICKS];
+	counters->wios = fields[IOSTAT_WRITE_IOS];
+	counters->wsectors = fields[IOSTAT_WRITE_SECTORS];
+	counters->wticks = fields[IOSTAT_WRITE_TICKS];
+	counters->ioticks = fields[IOSTAT_IO_TICKS];
+	counters->queue = fields[IOSTAT_TIME_IN_QUEUE];
+
+	return true;
+}
+
+/**
+ * Gets the current monotonic time.
+ *
+ * @return Nanoseconds since some unspecified point in the past.
+ */
+uint64_t iostat_now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * IOSTAT_NS_PER_SEC) + ts.tv_nsec;
+}
+
+/**
+ * Gets how many columns the name of an entry takes on the screen, counting
+ * the tab and tree glyph in front of partitions.
+ *
+ * @param  container Container that owns the devices.
+ * @param  entry     Entry of the device or partition.
+ * @return           Width of the name.
+ */
+uint32_t iostat_name_width(const stdev_container *container,
+						   const iostat_entry_t *entry) {
+	if (entry->part == NULL)
+		return strlen(device_str(container, entry->sd->name));
+
+	return IOSTAT_TAB_WIDTH + 2 +
+		strlen(device_str(container, entry->part->name));
+}
+
+/**
+ * Renders the activity of a single device or partition.
+ *
+ * @param io    Sampler.
+ * @param entry Entry of the device or partition.
+ * @param secs  Seconds between the last two samples.
+ * @param buf   Buffer where the line will be appended.
+ */
+void iostat_format_entry(const iostat_t *io, const iostat_entry_t *entry,
+						 double secs, buffer_t *buf) {
+	const iostat_counters_t *prev = &entry->prev;
+	const iostat_counters_t *cur = &entry->cur;
+	uint64_t rios;
+	uint64_t wios;
+	double msecs;
+
+	// Name in the tree.
+	if (entry->part == NULL) {
+		buffer_append_str(buf, device_str(io->container, entry->sd->name));
+	} else {
+		buffer_append_str(buf, entry->last ? "\t\u2514 " : "\t\u251C ");
+		buffer_append_str(buf, device_str(io->container, entry->part->name));
+	}
+	iostat_append_pad(buf, io->width - iostat_name_width(io->container, entry));
+
+	// Devices that couldn't be sampled.
+	if (!entry->valid || (secs <= 0)) {
+		for (size_t i = 0; i < IOSTAT_COL_COUNT; i++) {
+			iostat_append_pad(buf, IOSTAT_COL_WIDTH - 1);
+			buffer_append_char(buf, '-');
+		}
+		buffer_append_char(buf, '\n');
+		return;
+	}
+
+	// Operations and throughput.
+	rios = iostat_delta(prev->rios, cur->rios);
+	wios = iostat_delta(prev->wios, cur->wios);
+	iostat_append_num(buf, rios / secs);
+	iostat_append_num(buf, wios / secs);
+	iostat_append_num(buf, iostat_delta(prev->rsectors, cur->rsectors) /
+					  2.0 / secs);
+	iostat_append_num(buf, iostat_delta(prev->wsectors, cur->wsectors) /
+					  2.0 / secs);
+
+	// Latency.
+	iostat_append_num(buf, (rios > 0) ?
+					  (double)iostat_delta(prev->rticks, cur->rticks) / rios :
+					  0);
+	iostat_append_num(buf, (wios > 0) ?
+					  (double)iostat_delta(prev->wticks, cur->wticks) / wios :
+					  0);
+
+	// Queue depth and utilization.
+	msecs = secs * 1000;
+	iostat_append_num(buf, iostat_delta(prev->queue, cur->queue) / msecs);
+	iostat_append_num(buf, iostat_delta(prev->ioticks, cur->ioticks) * 100 /
+					  msecs);
+	buffer_append_char(buf, '\n');
+}
+
+/**
+ * Appends spaces.
+ *
+ * @param buf   Buffer where the spaces will be appended.
+ * @param count Number of spaces.
+ */
+void iostat_append_pad(buffer_t *buf, uint32_t count) {
+	if (count > 0)
+		memset(buffer_reserve(buf, count), ' ', count);
+}
+
+/**
+ * Appends a number with two decimal places right aligned to a column.
+ *
+ * @param buf   Buffer where the number will be appended.
+ * @param value Number to be appended.
+ */
+void iostat_append_num(buffer_t *buf, double value) {
+	char digits[24];
+	uint64_t hundredths;
+	uint32_t len = 0;
+
+	// Write the digits backwards.
+	hundredths = (value > 0) ? (uint64_t)((value * 100) + 0.5) : 0;
+	do {
+		if (len == 2)
+			digits[len++] = '.';
+		digits[len++] = '0' + (hundredths % 10);
+		hundredths /= 10;
+	} while ((hundredths > 0) || (len < 4));
+
+	// Right align them.
+	iostat_append_pad(buf, (len < IOSTAT_COL_WIDTH) ?
+					  (IOSTAT_COL_WIDTH - len) : 1);
+	while (len > 0)
+		buffer_append_char(buf, digits[--len]);
+}
+
+/**
+ * Gets how much a counter went up, ignoring counters that were reset.
+ *
+ * @param  prev Previous value of the counter.
+ * @param  cur  Current value of the counter.
+ * @return      Difference between them.
+ */
+uint64_t iostat_delta(uint64_t prev, uint64_t cur) {
+	return (cur >= prev) ? (cur - prev) : 0;
+}
@@ -0,0 +1,75 @@
+/**
+ * iostat.h
+ * Live throughput and latency sampling of block devices.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _IOSTAT_H
+#define _IOSTAT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include "device.h"
+#include "buffer.h"
+#include "uring.h"
+
+// Constants.
+#define IOSTAT_STAT_BUF_LEN 256
+
+// Counters of a stat file that we care about. Times are in milliseconds and
+// sectors are always 512 bytes long, whatever the device's sector size is.
+typedef struct {
+	uint64_t rios;
+	uint64_t rsectors;
+	uint64_t rticks;
+	uint64_t wios;
+	uint64_t wsectors;
+	uint64_t wticks;
+	uint64_t ioticks;
+	uint64_t queue;
+} iostat_counters_t;
+
+// Whole device or partition being sampled, with its stat file kept open.
+typedef struct {
+	int                fd;
+	const stdev_t     *sd;
+	const partition_t *part;   // NULL for whole devices.
+	bool               last;   // Last partition of its device.
+	bool               ok;     // The latest sample was read.
+	bool               valid;  // The latest two samples were read.
+	ssize_t            len;
+	iostat_counters_t  prev;
+	iostat_counters_t  cur;
+	char               buf[IOSTAT_STAT_BUF_LEN];
+} iostat_entry_t;
+
+// Sampler of every device in a container.
+typedef struct {
+	const stdev_container *container;
+	iostat_entry_t        *entries;
+	uint32_t               count;
+	uint32_t               width;  // Columns taken by the widest name.
+	uint64_t               prev_ns;
+	uint64_t               cur_ns;
+	bool                   uring;
+	uring_t                ring;
+} iostat_t;
+
+// Initialization.
+bool iostat_open(iostat_t *io, const stdev_container *container,
+				 const char *sysfs_root, bool uring);
+
+// Sampling.
+void iostat_sample(iostat_t *io);
+bool iostat_run(iostat_t *io, uint64_t interval_ns, int fd);
+
+// Showing off.
+void iostat_format(const iostat_t *io, buffer_t *buf);
+
+// Clean up.
+void iostat_close(iostat_t *io);
+
+#endif  //_IOSTAT_H
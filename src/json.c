@@ -0,0 +1,211 @@
+/**
+ * json.c
+ * Renders storage devices as JSON.
+ *
+ * Each device becomes a single line object with its partitions nested in it.
+ * Strings are escaped straight into the output buffer, and empty ones (like a
+ * partition without a label) are rendered as null.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "json.h"
+#include <string.h>
+
+// Private methods.
+void json_append_key(buffer_t *buf, const char *key, bool *first);
+void json_append_strref(buffer_t *buf, const stdev_container *container,
+						strref_t ref);
+void json_append_bool(buffer_t *buf, bool value);
+
+/**
+ * Renders a storage device as a single line JSON object. Only the keys of the
+ * selected columns are included, always in the same order.
+ *
+ * @param container Storage device container.
+ * @param sd        Storage device.
+ * @param cols      Selected columns.
+ * @param buf       Buffer where the object will be appended.
+ */
+void json_format_device(const stdev_container *container, const stdev_t *sd,
+						const columns_t *cols, buffer_t *buf) {
+	bool first = true;
+
+	// Device information.
+	buffer_append_char(buf, '{');
+	if (columns_has(cols, COLUMN_NAME)) {
+		json_append_key(buf, "name", &first);
+		json_append_strref(buf, container, sd->name);
+	}
+	if (columns_has(cols, COLUMN_SIZE)) {
+		json_append_key(buf, "size", &first);
+		buffer_append_uint(buf, sd->size);
+	}
+	if (columns_has(cols, COLUMN_SECTORS)) {
+		json_append_key(buf, "sectors", &first);
+		buffer_append_uint(buf, sd->sectors);
+		json_append_key(buf, "sector_size", &first);
+		buffer_append_uint(buf, sd->sector_size);
+	}
+	if (columns_has(cols, COLUMN_RO)) {
+		json_append_key(buf, "ro", &first);
+		json_append_bool(buf, sd->ro);
+	}
+
+	// Partitions.
+	json_append_key(buf, "partitions", &first);
+	buffer_append_char(buf, '[');
+	for (uint32_t i = 0; i < sd->partitions.count; i++) {
+		const partition_t *part = &sd->partitions.list[i];
+
+		if (i > 0)
+			buffer_append_char(buf, ',');
+		buffer_append_char(buf, '{');
+		first = true;
+		if (columns_has(cols, COLUMN_NAME)) {
+			json_append_key(buf, "name", &first);
+			json_append_strref(buf, container, part->name);
+		}
+		if (columns_has(cols, COLUMN_MAJMIN)) {
+			json_append_key(buf, "major", &first);
+			buffer_append_uint(buf, part->major);
+			json_append_key(buf, "minor", &first);
+			buffer_append_uint(buf, part->minor);
+		}
+		if (columns_has(cols, COLUMN_START)) {
+			json_append_key(buf, "start", &first);
+			buffer_append_uint(buf, part->start);
+		}
+		if (columns_has(cols, COLUMN_SIZE)) {
+			json_append_key(buf, "size", &first);
+			buffer_append_uint(buf, part->size);
+		}
+		if (columns_has(cols, COLUMN_SECTORS)) {
+			json_append_key(buf, "sectors", &first);
+			buffer_append_uint(buf, part->sectors);
+		}
+		if (columns_has(cols, COLUMN_RO)) {
+			json_append_key(buf, "ro", &first);
+			json_append_bool(buf, part->ro);
+		}
+		if (columns_has(cols, COLUMN_TYPE)) {
+			json_append_key(buf, "type", &first);
+			json_append_strref(buf, container, part->type);
+		}
+		if (columns_has(cols, COLUMN_LABEL)) {
+			json_append_key(buf, "label", &first);
+			json_append_strref(buf, container, part->label);
+		}
+		if (columns_has(cols, COLUMN_UUID)) {
+			json_append_key(buf, "uuid", &first);
+			json_append_strref(buf, container, part->uuid);
+		}
+
+		// Mount points.
+		if (columns_has(cols, COLUMN_MNT)) {
+			json_append_key(buf, "mountpoints", &first);
+			buffer_append_char(buf, '[');
+			for (uint32_t j = 0; j < part->mntcount; j++) {
+				if (j > 0)
+					buffer_append_char(buf, ',');
+				json_append_str(buf, device_str(container,
+												part->mntpoints[j]));
+			}
+			buffer_append_char(buf, ']');
+		}
+		buffer_append_char(buf, '}');
+	}
+	buffer_append_str(buf, "]}");
+}
+
+/**
+ * Appends a quoted and escaped JSON string. Runs of characters that don't
+ * need escaping are copied in one go.
+ *
+ * @param buf Buffer where the string will be appended.
+ * @param str String to be escaped.
+ */
+void json_append_str(buffer_t *buf, const char *str) {
+	const char hex[] = "0123456789abcdef";
+	const char *run = str;
+
+	buffer_append_char(buf, '"');
+	for (; *str != '\0'; str++) {
+		unsigned char c = (unsigned char)*str;
+
+		if ((c >= 0x20) && (c != '"') && (c != '\\'))
+			continue;
+
+		// Flush the characters before the one that needs escaping.
+		buffer_append(buf, run, str - run);
+		run = str + 1;
+
+		switch (c) {
+		case '"':
+			buffer_append_str(buf, "\\\"");
+			break;
+		case '\\':
+			buffer_append_str(buf, "\\\\");
+			break;
+		case '\n':
+			buffer_append_str(buf, "\\n");
+			break;
+		case '\r':
+			buffer_append_str(buf, "\\r");
+			break;
+		case '\t':
+			buffer_append_str(buf, "\\t");
+			break;
+		default:
+			buffer_append_str(buf, "\\u00");
+			buffer_append_char(buf, hex[c >> 4]);
+			buffer_append_char(buf, hex[c & 0xF]);
+			break;
+		}
+	}
+	buffer_append(buf, run, str - run);
+	buffer_append_char(buf, '"');
+}
+
+/**
+ * Appends an object key.
+ *
+ * @param buf   Buffer where the key will be appended.
+ * @param key   Key name, which must not need escaping.
+ * @param first Is this the first key of the object? Gets cleared afterwards.
+ */
+void json_append_key(buffer_t *buf, const char *key, bool *first) {
+	if (!*first)
+		buffer_append_char(buf, ',');
+	*first = false;
+	buffer_append_char(buf, '"');
+	buffer_append_str(buf, key);
+	buffer_append_str(buf, "\":");
+}
+
+/**
+ * Appends an interned string, or null if it's empty.
+ *
+ * @param buf       Buffer where the string will be appended.
+ * @param container Storage device container that owns the string.
+ * @param ref       Reference to the string.
+ */
+void json_append_strref(buffer_t *buf, const stdev_container *container,
+						strref_t ref) {
+	if (ref == STRREF_EMPTY) {
+		buffer_append_str(buf, "null");
+		return;
+	}
+
+	json_append_str(buf, device_str(container, ref));
+}
+
+/**
+ * Appends a boolean.
+ *
+ * @param buf   Buffer where the boolean will be appended.
+ * @param value Value to be appended.
+ */
+void json_append_bool(buffer_t *buf, bool value) {
+	buffer_append_str(buf, value ? "true" : "false");
+}
@@ -0,0 +1,23 @@
+/**
+ * json.h
+ * Renders storage devices as JSON.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _JSON_H
+#define _JSON_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "device.h"
+#include "buffer.h"
+#include "columns.h"
+
+// Rendering.
+void json_format_device(const stdev_container *container, const stdev_t *sd,
+						const columns_t *cols, buffer_t *buf);
+void json_append_str(buffer_t *buf, const char *str);
+
+#endif  //_JSON_H
@@ -7,387 +7,1282 @@
 
 #include "linux.h"
 #include <stdio.h>
+#include <inttypes.h>
 #include <dirent.h>
 #include <unistd.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
 #include <blkid/blkid.h>
-#include <mntent.h>
 #include "utils.h"
+#include "workers.h"
+#include "cache.h"
+#include "udevdb.h"
+#include "sysfs.h"
+#include "mounts.h"
+#include "filter.h"
+#include "profile.h"
 
 // Constants.
-#define SYSFS_BLOCKDEVS_PATH "/sys/block/"
-#define MOUNTPOINT_DEF_PATH "/etc/mtab"
+#define SYSFS_BLOCKDEVS_DIR  "/block/"
+#define SYSFS_CLASS_DIR      "/class/block/"
+#define BLOCK_CLASS_NONE     UINT32_MAX
+#define PROC_THREAD_IO_PATH  "/proc/thread-self/io"
+#define PROC_IO_BUF_LEN      512
 
+// Superblock values we actually use.
+#define BLKID_PROBE_FLAGS \
+	(BLKID_SUBLKS_LABEL | BLKID_SUBLKS_UUID | BLKID_SUBLKS_TYPE)
+
+
+// Partition probing task for the worker pool.
+typedef struct {
+	partition_t *part;
+	uint32_t dev;
+	char path[DEVICE_PATH_MAX_LEN];
+	probe_info_t info;
+	bool ok;
+
+	// Debugging statistics.
+	int64_t bytes;
+	uint64_t usecs;
+} blkid_task_t;
+
+// Batch of probing tasks. Devices are finished in order as soon as all of
+// their partitions (and the ones of the devices before them) were probed.
+typedef struct {
+	stdev_container       *container;
+	stdev_t               *devs;
+	uint32_t               ndevs;
+	const populate_opts_t *opts;
+	blkid_task_t          *tasks;
+	size_t                 ntasks;
+	size_t                *first;
+	size_t                *pending;
+	uint32_t               next;
+	pthread_mutex_t        lock;
+} blkid_batch_t;
+
+// Entry of the block class. Devices keep a list of their partitions.
+typedef struct {
+	strref_t name;
+	strref_t parent;  // Directory its link points inside of.
+	bool     part;
+	uint32_t partnum;
+	uint32_t next;
+	uint32_t first;
+	uint32_t last;
+	uint32_t nparts;
+} class_entry_t;
+
+// Every entry of the block class, with the partitions grouped under their
+// devices.
+typedef struct {
+	strpool_t      names;
+	class_entry_t *list;
+	uint32_t       count;
+	uint32_t       capacity;
+} block_class_t;
 
 // Private methods.
 bool ignore_dir_entry(const struct dirent *dir);
-bool get_device_size(stdev_t *sd);
-bool get_device_permission(stdev_t *sd);
-bool get_partitions(stdev_t *sd);
-bool get_partitions_mountpoints(stdev_t *sd);
-bool sysfs_exists();
-bool sysfs_device_info(stdev_t *sd);
-bool get_partitions_size(stdev_t *sd);
-bool get_partitions_permission(stdev_t *sd);
-bool blkid_info(stdev_t *sd);
-bool sysfs_device_list(stdev_container *devlist);
+bool block_class_scan(block_class_t *bc, const populate_opts_t *opts);
+strref_t block_class_parent(block_class_t *bc, int dirfd, const char *name);
+void block_class_group(block_class_t *bc, int dirfd);
+void block_class_free(block_class_t *bc);
+bool get_partitions(stdev_container *container, stdev_t *sd,
+					sysfs_dir_t *devdir, const char *const *parts,
+					uint32_t nparts);
+bool get_partitions_info(const stdev_container *container, stdev_t *sd,
+						 sysfs_dir_t *devdir, sysfs_batch_t *batch,
+						 uint32_t fields);
+bool get_partitions_mountpoints(stdev_container *container, stdev_t *sd,
+								const mount_index_t *mounts);
+bool sysfs_exists(const char *root);
+bool sysfs_device_info(stdev_t *sd, sysfs_dir_t *devdir, sysfs_batch_t *batch,
+					   uint32_t fields);
+bool sysfs_device_load(stdev_container *container, const char *name,
+					   const char *const *parts, uint32_t nparts,
+					   const mount_index_t *mounts, sysfs_batch_t *batch,
+					   const populate_opts_t *opts, stdev_t *sd);
+bool populate_partition(stdev_container *container, const char *name,
+						const char *part, const populate_opts_t *opts,
+						stdev_t *sd);
+bool blkid_info(stdev_container *container, stdev_t *devs, uint32_t ndevs,
+				const populate_opts_t *opts);
+const probe_info_t *blkid_known_info(probe_cache_t *cache,
+									 const char *udev_path,
+									 const partition_t *part,
+									 probe_info_t *udev,
+									 const populate_opts_t *opts);
+bool blkid_probe_tasks(blkid_batch_t *batch, unsigned int jobs);
+bool blkid_partition_info(const char *path, uint64_t size, probe_info_t *info);
+int64_t blkid_thread_rchar(size_t *len);
+void blkid_debug(const blkid_batch_t *batch);
+void blkid_task(size_t idx, void *arg);
+void blkid_batch_advance(blkid_batch_t *batch);
+void blkid_error(const char *path);
+bool sysfs_device_list(stdev_container *devlist, const populate_opts_t *opts);
 
 
 /**
  * Populates a storage device container.
  *
  * @param  container Storage device structure container.
- * @param  useblkid  Use blkid for probing? (requires root)
+ * @param  opts      Population options.
  * @return           TRUE if everything went fine.
  */
-bool populate_devices(stdev_container *container, const bool useblkid) {
+bool populate_devices(stdev_container *container, const populate_opts_t *opts) {
 	// Check with device discovery system we are going to use.
-	if (sysfs_exists()) {
+	if (sysfs_exists(opts->roots.sysfs)) {
 		// Use sysfs.
-		if (!sysfs_device_list(container))
+		if (!sysfs_device_list(container, opts))
 			return false;
 	} else {
 		fprintf(stderr, "Cannot determine a device discovery system to use.\n");
 		return false;
 	}
 
-	// Use blkid to get more information for our devices.
-	if (useblkid) {
-		for (int i = 0; i < container->count; i++) {
-			if (!blkid_info(&container->list[i]))
-				return false;
+	// Use blkid to get more information for our devices and drop the ones that
+	// turned out not to match.
+	if (opts->useblkid) {
+		if (!blkid_info(container, container->list, container->count, opts))
+			return false;
+		filter_container(opts->filter, container);
+	}
+
+	return true;
+}
+
+/**
+ * Gets all the information about a single storage device. The device isn't
+ * added to the container, but all of its memory is owned by it. Probing
+ * failures are reported, but don't make the device any less valid.
+ *
+ * @param  container Storage device container that will own the device.
+ * @param  name      Name of the device. (sda, nvme0n1, etc.)
+ * @param  opts      Population options.
+ * @param  sd        Storage device structure to be populated.
+ * @return           TRUE if the device exists, is a valid storage device and
+ *                   matches the filter.
+ */
+bool populate_device(stdev_container *container, const char *name,
+					 const populate_opts_t *opts, stdev_t *sd) {
+	return populate_partition(container, name, NULL, opts, sd);
+}
+
+/**
+ * Populates a storage device container with the single device that was
+ * looked up. When the lookup matched a partition the device only gets that
+ * partition, so nothing else in the system is ever touched. A device that
+ * doesn't match the filter simply isn't added.
+ *
+ * @param  container Storage device structure container.
+ * @param  target    Device and partition that were looked up.
+ * @param  opts      Population options.
+ * @return           TRUE if everything went fine.
+ */
+bool populate_target(stdev_container *container, const lookup_target_t *target,
+					 const populate_opts_t *opts) {
+	populate_opts_t single;
+	stdev_t sd;
+
+	// Initialize the container.
+	device_container_init(container);
+
+	// Get the device, only letting everyone know about it once it's in the
+	// container.
+	single = *opts;
+	single.on_ready = NULL;
+	if (!populate_partition(container, target->disk,
+							(target->part[0] != '\0') ? target->part : NULL,
+							&single, &sd)) {
+		return true;
+	}
+	device_list_push(container, &sd);
+
+	// It's already fully populated.
+	if (opts->on_ready != NULL)
+		opts->on_ready(container, &container->list[0], opts->ready_arg);
+
+	return true;
+}
+
+/**
+ * Gets all the information about a single storage device, optionally
+ * restricted to only one of its partitions.
+ *
+ * @param  container Storage device container that will own the device.
+ * @param  name      Name of the device.
+ * @param  part      Name of the only partition to get or NULL for all of them.
+ * @param  opts      Population options.
+ * @param  sd        Storage device structure to be populated.
+ * @return           TRUE if the device exists, is a valid storage device and
+ *                   matches the filter.
+ */
+bool populate_partition(stdev_container *container, const char *name,
+						const char *part, const populate_opts_t *opts,
+						stdev_t *sd) {
+	mount_index_t mounts;
+	sysfs_batch_t batch;
+	uint64_t start;
+	bool success;
+
+	// Index the mount table if we need it.
+	if (opts->fields & DEVICE_FIELD_MOUNTS) {
+		start = profile_now(opts->profile);
+		success = mount_index_load(&mounts, opts->roots.mountinfo,
+								   opts->roots.mtab);
+		profile_add(opts->profile, PROFILE_MOUNTS, start);
+		profile_count_opens(opts->profile, 1);
+		if (!success) {
+			mount_index_free(&mounts);
+			return false;
 		}
 	}
 
+	// Get the device.
+	sysfs_batch_init(&batch, opts->uring);
+	success = sysfs_device_load(container, name, (part != NULL) ? &part : NULL,
+								1, (opts->fields & DEVICE_FIELD_MOUNTS) ?
+								&mounts : NULL, &batch, opts, sd);
+	sysfs_batch_free(&batch);
+	if (opts->fields & DEVICE_FIELD_MOUNTS)
+		mount_index_free(&mounts);
+	if (!success)
+		return false;
+
+	// Use blkid to get more information for our device.
+	if (opts->useblkid) {
+		blkid_info(container, sd, 1, opts);
+		return filter_match(opts->filter, container, sd, FILTER_STAGE_FINAL);
+	}
+
 	return true;
 }
 
 /**
  * Checks if the sysfs block device folders exists.
  *
- * @return TRUE if there are block device folders.
+ * @param  root Path to where sysfs is mounted.
+ * @return      TRUE if there are block device folders.
  */
-bool sysfs_exists() {
-	return access(SYSFS_BLOCKDEVS_PATH, F_OK) != -1;
+bool sysfs_exists(const char *root) {
+	char path[PATH_MAX];
+
+	snprintf(path, PATH_MAX, "%s%s", root, SYSFS_BLOCKDEVS_DIR);
+	return access(path, F_OK) != -1;
 }
 
 /**
- * Retrieves a block device list.
+ * Retrieves a block device list. Devices and partitions are found in a single
+ * pass over the block class, so no device directory ever has to be listed.
  *
  * @param  devlist Array of block devices to be populated.
+ * @param  opts    Population options.
  * @return         TRUE if the operation was successful.
  */
-bool sysfs_device_list(stdev_container *devlist) {
-	DIR *dh;
-	struct dirent *dir;
+bool sysfs_device_list(stdev_container *devlist, const populate_opts_t *opts) {
+	mount_index_t mounts;
+	const mount_index_t *index = NULL;
+	sysfs_batch_t batch;
+	block_class_t bc;
+	const char **parts;
+	uint32_t capacity;
+	uint64_t start;
+	bool success;
+	stdev_t sd;
 
 	// Initialize the container.
-	devlist->count = 0;
+	device_container_init(devlist);
 
-	// Open the block device folder.
-	dh = opendir(SYSFS_BLOCKDEVS_PATH);
+	// Index the mount table if we need it.
+	if (opts->fields & DEVICE_FIELD_MOUNTS) {
+		start = profile_now(opts->profile);
+		success = mount_index_load(&mounts, opts->roots.mountinfo,
+								   opts->roots.mtab);
+		profile_add(opts->profile, PROFILE_MOUNTS, start);
+		profile_count_opens(opts->profile, 1);
+		if (!success) {
+			mount_index_free(&mounts);
+			return false;
+		}
+		index = &mounts;
+	}
+
+	// Find every device and partition.
+	if (!block_class_scan(&bc, opts)) {
+		if (index != NULL)
+			mount_index_free(&mounts);
+		return false;
+	}
+
+	// Get the information of each device along with its partitions.
+	sysfs_batch_init(&batch, opts->uring);
+	capacity = 16;
+	parts = malloc(sizeof(const char *) * capacity);
+	for (uint32_t i = 0; i < bc.count; i++) {
+		const class_entry_t *dev = &bc.list[i];
+		uint32_t nparts = 0;
+
+		// Partitions are loaded along with their devices.
+		if (dev->part)
+			continue;
+
+		// Gather the names of its partitions.
+		if (dev->nparts > capacity) {
+			while (dev->nparts > capacity)
+				capacity *= 2;
+			parts = realloc(parts, sizeof(const char *) * capacity);
+		}
+		for (uint32_t j = dev->first; j != BLOCK_CLASS_NONE;
+				j = bc.list[j].next) {
+			parts[nparts++] = strpool_get(&bc.names, bc.list[j].name);
+		}
+
+		// Get device information and add it to the list.
+		if (!sysfs_device_load(devlist, strpool_get(&bc.names, dev->name),
+							   parts, nparts, index, &batch, opts, &sd)) {
+			continue;
+		}
+		device_list_push(devlist, &sd);
+
+		// Without probing there's nothing else to wait for.
+		if (!opts->useblkid && (opts->on_ready != NULL))
+			opts->on_ready(devlist, &devlist->list[devlist->count - 1],
+						   opts->ready_arg);
+	}
+
+	// Clean up.
+	free(parts);
+	sysfs_batch_free(&batch);
+	block_class_free(&bc);
+	if (index != NULL)
+		mount_index_free(&mounts);
+	return true;
+}
+
+/**
+ * Lists the block class and groups the partitions under their devices.
+ *
+ * @param  bc   Block class listing to be populated.
+ * @param  opts Population options.
+ * @return      TRUE if the block class could be listed.
+ */
+bool block_class_scan(block_class_t *bc, const populate_opts_t *opts) {
+	char path[PATH_MAX];
+	struct dirent *dir;
+	class_entry_t *entry;
+	uint64_t start;
+	DIR *dh;
+
+	memset(bc, 0, sizeof(block_class_t));
+	strpool_init(&bc->names);
+
+	// Open the block class folder.
+	snprintf(path, PATH_MAX, "%s%s", opts->roots.sysfs, SYSFS_CLASS_DIR);
+	profile_count_opens(opts->profile, 1);
+	dh = opendir(path);
 	if (dh == NULL) {
-		fprintf(stderr, "Couldn't open %s to list block devices.\n",
-				SYSFS_BLOCKDEVS_PATH);
+		fprintf(stderr, "Couldn't open %s to list block devices.\n", path);
+		strpool_free(&bc->names);
 		return false;
 	}
 
 	// Get the directory listing.
-	while ((dir = readdir(dh)) != NULL) {
+	while (true) {
+		start = profile_now(opts->profile);
+		dir = readdir(dh);
+		profile_add(opts->profile, PROFILE_READDIR, start);
+		if (dir == NULL)
+			break;
+
 		// Filter out anything that isn't a block device.
-		if (ignore_dir_entry(dir)) {
+		if (ignore_dir_entry(dir))
 			continue;
+
+		// Make sure we have space for it.
+		if (bc->count == bc->capacity) {
+			bc->capacity = (bc->capacity > 0) ? bc->capacity * 2 : 64;
+			bc->list = realloc(bc->list, sizeof(class_entry_t) * bc->capacity);
 		}
 
-		// Filter out the special "boot" devices.
-		if (strstr(dir->d_name, "boot") != NULL) {
+		// Store it along with where it lives in the device tree.
+		entry = &bc->list[bc->count++];
+		memset(entry, 0, sizeof(class_entry_t));
+		entry->name = strpool_intern(&bc->names, dir->d_name);
+		entry->parent = block_class_parent(bc, dirfd(dh), dir->d_name);
+		entry->first = BLOCK_CLASS_NONE;
+		entry->last = BLOCK_CLASS_NONE;
+		entry->next = BLOCK_CLASS_NONE;
+	}
+
+	// Sort the partitions out while we still have the folder open.
+	block_class_group(bc, dirfd(dh));
+	closedir(dh);
+
+	return true;
+}
+
+/**
+ * Gets the name of the directory a block class entry's link points inside
+ * of. Partitions live inside the directory of their device.
+ *
+ * @param  bc    Block class listing that owns the names.
+ * @param  dirfd Opened block class directory.
+ * @param  name  Name of the entry.
+ * @return       Name of the directory or STRREF_EMPTY if it isn't a link.
+ */
+strref_t block_class_parent(block_class_t *bc, int dirfd, const char *name) {
+	char path[PATH_MAX];
+	const char *start;
+	char *end;
+	ssize_t len;
+
+	// Get where it lives in the device tree.
+	len = readlinkat(dirfd, name, path, PATH_MAX - 1);
+	if (len <= 0)
+		return STRREF_EMPTY;
+	path[len] = '\0';
+
+	// Strip the entry itself and get the name of the directory above it.
+	end = strrchr(path, '/');
+	if (end == NULL)
+		return STRREF_EMPTY;
+	*end = '\0';
+	start = strrchr(path, '/');
+	start = (start != NULL) ? start + 1 : path;
+
+	return strpool_intern(&bc->names, start);
+}
+
+/**
+ * Attaches each partition to its device, ordered by their partition numbers
+ * rather than the order they were found in. Only the entries that live inside
+ * the directory of another entry can be partitions, and only those have their
+ * partition attribute read, which weeds out things like the eMMC boot areas.
+ * Interned names are unique, so entries are matched by their references
+ * alone.
+ *
+ * @param bc    Block class listing.
+ * @param dirfd Opened block class directory.
+ */
+void block_class_group(block_class_t *bc, int dirfd) {
+	char path[PATH_MAX];
+	sysfs_dir_t classdir;
+	uint32_t *table;
+	uint32_t size;
+	uint32_t mask;
+	uint64_t num;
+
+	// Read the partition attributes relative to the block class.
+	memset(&classdir, 0, sizeof(sysfs_dir_t));
+	classdir.fd = dirfd;
+	classdir.path = SYSFS_CLASS_DIR;
+
+	// Index the entries by their names.
+	size = 16;
+	while (size < (bc->count * 2))
+		size *= 2;
+	mask = size - 1;
+	table = malloc(sizeof(uint32_t) * size);
+	memset(table, 0xFF, sizeof(uint32_t) * size);
+	for (uint32_t i = 0; i < bc->count; i++) {
+		uint32_t slot = (bc->list[i].name * 2654435761u) & mask;
+
+		while (table[slot] != BLOCK_CLASS_NONE)
+			slot = (slot + 1) & mask;
+		table[slot] = i;
+	}
+
+	// Append each partition to its device's list.
+	for (uint32_t i = 0; i < bc->count; i++) {
+		class_entry_t *entry = &bc->list[i];
+		class_entry_t *dev;
+		uint32_t slot;
+
+		// Check if it's inside another entry.
+		if (entry->parent == STRREF_EMPTY)
 			continue;
+		slot = (entry->parent * 2654435761u) & mask;
+		while ((table[slot] != BLOCK_CLASS_NONE) &&
+				(bc->list[table[slot]].name != entry->parent)) {
+			slot = (slot + 1) & mask;
 		}
+		if ((table[slot] == BLOCK_CLASS_NONE) || (table[slot] == i))
+			continue;
 
-		// Get device information.
-		stdev_t sd;
-		strncpy(sd.name, dir->d_name, PARTITION_NAME_MAX_LEN);
-		sysfs_device_info(&sd);
-		if (sd.size == 0)
+		// Only partitions have a partition number.
+		snprintf(path, PATH_MAX, "%s/partition",
+				 strpool_get(&bc->names, entry->name));
+		if (!sysfs_read_num(&classdir, path, &num))
 			continue;
+		entry->part = true;
+		entry->partnum = num;
 
-		// Get partitions and information on them.
-		sd.partitions.list = malloc(sizeof(partition_t));
-		get_partitions(&sd);
-		get_partitions_size(&sd);
-		get_partitions_permission(&sd);
-		get_partitions_mountpoints(&sd);
+		// Add it to the device, usually right at the end.
+		dev = &bc->list[table[slot]];
+		if (dev->first == BLOCK_CLASS_NONE) {
+			dev->first = i;
+			dev->last = i;
+		} else if (bc->list[dev->last].partnum <= entry->partnum) {
+			bc->list[dev->last].next = i;
+			dev->last = i;
+		} else if (bc->list[dev->first].partnum > entry->partnum) {
+			entry->next = dev->first;
+			dev->first = i;
+		} else {
+			uint32_t prev = dev->first;
 
-		// Add the storage device to the list.
-		device_list_push(devlist, sd);
+			while (bc->list[bc->list[prev].next].partnum <= entry->partnum)
+				prev = bc->list[prev].next;
+			entry->next = bc->list[prev].next;
+			bc->list[prev].next = i;
+		}
+		dev->nparts++;
 	}
 
-	// Clean up.
-	closedir(dh);
-	dh = NULL;
-	return true;
+	free(table);
+}
+
+/**
+ * Frees a block class listing.
+ *
+ * @param bc Block class listing to be freed.
+ */
+void block_class_free(block_class_t *bc) {
+	free(bc->list);
+	strpool_free(&bc->names);
+	memset(bc, 0, sizeof(block_class_t));
 }
 
 /**
- * Gets information about a given block device.
+ * Gets all the information sysfs has about a block device and its partitions.
+ * The device is checked against the filter as soon as something new is known
+ * about it, so that the ones we don't care about are dropped before any of
+ * the more expensive steps.
  *
- * @param  sd    Storage device structure to be populated with information.
- * @return       TRUE if the parsing was successful.
+ * @param  container Storage device container that will own the device.
+ * @param  name      Name of the device.
+ * @param  parts     Names of the partitions to load or NULL to look for all of
+ *                   them in the device's directory.
+ * @param  nparts    Number of partitions in the list.
+ * @param  mounts    Index of the system's mount table. (NULL to skip matching
+ *                   the mount points)
+ * @param  batch     Attribute batch to read the device's attributes with.
+ * @param  opts      Population options.
+ * @param  sd        Storage device structure to be populated.
+ * @return           TRUE if it's a valid storage device that might match the
+ *                   filter.
  */
-bool sysfs_device_info(stdev_t *sd) {
-	// Build device path.
-	strcpy(sd->path, SYSFS_BLOCKDEVS_PATH);
-	strcat(sd->path, sd->name);
+bool sysfs_device_load(stdev_container *container, const char *name,
+					   const char *const *parts, uint32_t nparts,
+					   const mount_index_t *mounts, sysfs_batch_t *batch,
+					   const populate_opts_t *opts, stdev_t *sd) {
+	sysfs_dir_t devdir;
+	char devpath[PATH_MAX];
+	uint64_t start;
+	bool valid;
 
-	// Get device size.
-	if (!get_device_size(sd))
+	// Filter out the special "boot" devices and the ones we don't want.
+	if ((strstr(name, "boot") != NULL) || !filter_name(opts->filter, name))
 		return false;
 
-	// Get device permission.
-	if (!get_device_permission(sd))
+	// Build device path and open its directory.
+	start = profile_now(opts->profile);
+	memset(sd, 0, sizeof(stdev_t));
+	snprintf(devpath, PATH_MAX, "%s%s%s", opts->roots.sysfs,
+			 SYSFS_BLOCKDEVS_DIR, name);
+	if (!sysfs_dir_open(&devdir, devpath)) {
+		profile_count_opens(opts->profile, devdir.opens);
 		return false;
+	}
 
-	return true;
+	// Get device information.
+	sd->name = strpool_intern(&container->strings, name);
+	valid = sysfs_device_info(sd, &devdir, batch, opts->fields) &&
+		(sd->size != 0);
+	profile_add(opts->profile, PROFILE_DEVICE, start);
+	if (!valid ||
+			!filter_match(opts->filter, container, sd, FILTER_STAGE_DEVICE)) {
+		profile_count_opens(opts->profile, devdir.opens);
+		sysfs_dir_close(&devdir);
+		return false;
+	}
+
+	// Get partitions and whatever information on them we need.
+	if (opts->fields & DEVICE_FIELD_PARTITIONS) {
+		start = profile_now(opts->profile);
+		get_partitions(container, sd, &devdir, parts, nparts);
+		profile_add(opts->profile, PROFILE_PARTITIONS, start);
+
+		start = profile_now(opts->profile);
+		get_partitions_info(container, sd, &devdir, batch, opts->fields);
+		profile_add(opts->profile, PROFILE_PARTINFO, start);
+
+		if (mounts != NULL) {
+			start = profile_now(opts->profile);
+			get_partitions_mountpoints(container, sd, mounts);
+			profile_add(opts->profile, PROFILE_MOUNTMATCH, start);
+		}
+	}
+	profile_count_opens(opts->profile, devdir.opens);
+	sysfs_dir_close(&devdir);
+
+	// Without probing this is all we'll ever know about it.
+	return filter_match(opts->filter, container, sd, opts->useblkid ?
+						FILTER_STAGE_PARTITIONS : FILTER_STAGE_FINAL);
 }
 
 /**
- * Gets the size of the block device in bytes.
+ * Gets information about a given block device. Every attribute that's needed
+ * is read in a single batch.
  *
- * @param  sd Storage device structure to be populated with information.
- * @return    TRUE if the parsing was successful.
+ * @param  sd     Storage device structure to be populated with information.
+ * @param  devdir Opened sysfs directory of the device.
+ * @param  batch  Attribute batch to read them with.
+ * @param  fields Device fields that have to be gathered. (DEVICE_FIELD_*)
+ * @return        TRUE if the parsing was successful.
  */
-bool get_device_size(stdev_t *sd) {
-	char attrpath[PATH_MAX];
+bool sysfs_device_info(stdev_t *sd, sysfs_dir_t *devdir, sysfs_batch_t *batch,
+					   uint32_t fields) {
+	size_t size;
+	size_t secsize;
+	size_t ro = 0;
+	size_t dev = 0;
+	uint64_t perm;
+
+	// Read everything at once.
+	sysfs_batch_clear(batch);
+	size = sysfs_batch_add(batch, NULL, "size");
+	secsize = sysfs_batch_add(batch, NULL, "queue/hw_sector_size");
+	if (fields & DEVICE_FIELD_RO)
+		ro = sysfs_batch_add(batch, NULL, "ro");
+	if (fields & DEVICE_FIELD_DISKNUM)
+		dev = sysfs_batch_add(batch, NULL, "dev");
+	sysfs_batch_read(batch, devdir);
 
 	// Get the number of sectors.
-	snprintf(attrpath, PATH_MAX, "%s/size", sd->path);
-	if (!freadnum(attrpath, &sd->sectors)) {
+	if (!sysfs_batch_num(batch, size, &sd->sectors)) {
 		fprintf(stderr, "Failed to read the number of sectors for %s.\n",
-				sd->path);
+				devdir->path);
 		return false;
 	}
 
 	// Get the number of bytes per sector.
-	snprintf(attrpath, PATH_MAX, "%s/queue/hw_sector_size", sd->path);
-	if (!freadnum(attrpath, &sd->sector_size)) {
-		fprintf(stderr, "Failed to read the sector size for %s.\n", sd->path);
+	if (!sysfs_batch_num(batch, secsize, &sd->sector_size)) {
+		fprintf(stderr, "Failed to read the sector size for %s.\n",
+				devdir->path);
 		return false;
 	}
 
 	// Calculate the size.
 	sd->size = sd->sectors * sd->sector_size;
-	return true;
-}
-
-/**
- * Gets the permission of a block device. (Read/Write)
- *
- * @param  sd Storage device structure to be populated with information.
- * @return    TRUE if the parsing was successful.
- */
-bool get_device_permission(stdev_t *sd) {
-	char attrpath[PATH_MAX];
-	size_t perm;
 
 	// Get the permission.
-	snprintf(attrpath, PATH_MAX, "%s/ro", sd->path);
-	if (!freadnum(attrpath, &perm)) {
-		fprintf(stderr, "Failed to read %s permissions.\n",
-				sd->path);
-		return false;
+	if (fields & DEVICE_FIELD_RO) {
+		if (!sysfs_batch_num(batch, ro, &perm)) {
+			fprintf(stderr, "Failed to read %s permissions.\n",
+					devdir->path);
+			return false;
+		}
+
+		sd->ro = (perm & true);
+	}
+
+	// Get the device number.
+	if (fields & DEVICE_FIELD_DISKNUM) {
+		if (!sysfs_batch_dev(batch, dev, &sd->major, &sd->minor)) {
+			fprintf(stderr, "Failed to read the device number for %s.\n",
+					devdir->path);
+			return false;
+		}
 	}
 
-	// Convert to boolean and return.
-	sd->ro = (perm & true);
 	return true;
 }
 
 /**
  * Gets the partitions from a block device. Just populates the number of
  * partitions and their names. For more information on each partition check
- * `blkid_info`.
+ * `get_partitions_info` and `blkid_info`.
  *
- * @param  sd    Storage device structure to be populated with information.
- * @return       TRUE if the operation was successful.
+ * @param  container Device container that owns the device's memory.
+ * @param  sd        Storage device structure to be populated with information.
+ * @param  devdir    Opened sysfs directory of the device.
+ * @param  parts     Names of the partitions to add or NULL to look for all of
+ *                   them in the device's directory.
+ * @param  nparts    Number of partitions in the list.
+ * @return           TRUE if the operation was successful.
  */
-bool get_partitions(stdev_t *sd) {
+bool get_partitions(stdev_container *container, stdev_t *sd,
+					sysfs_dir_t *devdir, const char *const *parts,
+					uint32_t nparts) {
 	DIR *dh;
 	struct dirent *dir;
+	char name[NAME_MAX + 1];
+	char attr[PATH_MAX];
+	uint32_t *nums;
+	uint32_t capacity;
+	size_t namelen;
+	uint64_t num;
+	int fd;
+
+	// No need to list anything if we already know the partitions.
+	if (parts != NULL) {
+		for (uint32_t i = 0; i < nparts; i++)
+			device_partition_push(container, &sd->partitions, parts[i]);
+		return true;
+	}
 
 	// Open the block device folder.
-	dh = opendir(sd->path);
+	fd = dup(devdir->fd);
+	dh = (fd != -1) ? fdopendir(fd) : NULL;
 	if (dh == NULL) {
-		fprintf(stderr, "Couldn't open %s to list partitions.\n", sd->path);
+		fprintf(stderr, "Couldn't open %s to list partitions.\n",
+				devdir->path);
+		if (fd != -1)
+			close(fd);
 		return false;
 	}
 
-	// Get the directory listing.
-	sd->partitions.count = 0;
+	// Get the directory listing. The device name is copied since interning
+	// the partition names might move the string pool around.
+	snprintf(name, sizeof(name), "%s", device_str(container, sd->name));
+	namelen = strlen(name);
+	capacity = 16;
+	nums = malloc(sizeof(uint32_t) * capacity);
 	while ((dir = readdir(dh)) != NULL) {
+		uint32_t i;
+
 		// Filter out anything that isn't a partition device.
-		if (strncmp(dir->d_name, sd->name, strlen(sd->name)) != 0)
+		if (strncmp(dir->d_name, name, namelen) != 0)
 			continue;
 
-		// Filter out the special "boot" partitions.
-		if (strstr(dir->d_name, "boot") != NULL) {
+		// Only partitions have a partition number.
+		snprintf(attr, PATH_MAX, "%s/partition", dir->d_name);
+		if (!sysfs_read_num(devdir, attr, &num))
 			continue;
-		}
 
 		// Add the partition to the list.
-		device_partition_push(&sd->partitions, dir->d_name);
+		device_partition_push(container, &sd->partitions, dir->d_name);
+		if (sd->partitions.count > capacity) {
+			capacity *= 2;
+			nums = realloc(nums, sizeof(uint32_t) * capacity);
+		}
+
+		// Keep the list ordered by partition number.
+		for (i = sd->partitions.count - 1; (i > 0) && (nums[i - 1] > num);
+				i--) {
+			partition_t part = sd->partitions.list[i];
+
+			sd->partitions.list[i] = sd->partitions.list[i - 1];
+			sd->partitions.list[i - 1] = part;
+			nums[i] = nums[i - 1];
+		}
+		nums[i] = num;
 	}
 
 	// Clean up.
+	free(nums);
 	closedir(dh);
 	dh = NULL;
 	return true;
 }
 
 /**
- * Gets the size of every partition in a block device in bytes.
+ * Gets the size, permission, device number and starting sector of every
+ * partition in a block device. The attributes that are needed are read
+ * relative to the device's directory, all of them in a single batch.
  *
- * @param  sd Storage device structure to be populated with information.
- * @return    TRUE if the parsing was successful.
+ * @param  container Device container that owns the device's strings.
+ * @param  sd        Storage device structure to be populated with information.
+ * @param  devdir    Opened sysfs directory of the device.
+ * @param  batch     Attribute batch to read them with.
+ * @param  fields    Device fields that have to be gathered. (DEVICE_FIELD_*)
+ * @return           TRUE if the parsing was successful.
  */
-bool get_partitions_size(stdev_t *sd) {
-	char attrpath[PATH_MAX];
+bool get_partitions_info(const stdev_container *container, stdev_t *sd,
+						 sysfs_dir_t *devdir, sysfs_batch_t *batch,
+						 uint32_t fields) {
+	uint64_t perm;
+	size_t idx;
 
-	for (uint8_t i = 0; i < sd->partitions.count; i++) {
-		// Get the number of bytes per sector.
-		snprintf(attrpath, PATH_MAX, "%s/%s/size", sd->path,
-				sd->partitions.list[i].name);
+	// Check if there's anything to be read at all.
+	if (!(fields & (DEVICE_FIELD_PARTSIZE | DEVICE_FIELD_RO |
+			DEVICE_FIELD_DEVNUM | DEVICE_FIELD_START)) ||
+			(sd->partitions.count == 0)) {
+		return true;
+	}
 
-		if (!freadnum(attrpath, &sd->partitions.list[i].sectors)) {
-			fprintf(stderr, "Failed to read the sector size for %s.\n",
-					sd->partitions.list[i].name);
-			return false;
+	// Read the attributes of every partition at once.
+	sysfs_batch_clear(batch);
+	for (uint32_t i = 0; i < sd->partitions.count; i++) {
+		const char *name = device_str(container, sd->partitions.list[i].name);
+
+		if (fields & DEVICE_FIELD_PARTSIZE)
+			sysfs_batch_add(batch, name, "size");
+		if (fields & DEVICE_FIELD_RO)
+			sysfs_batch_add(batch, name, "ro");
+		if (fields & DEVICE_FIELD_DEVNUM)
+			sysfs_batch_add(batch, name, "dev");
+		if (fields & DEVICE_FIELD_START)
+			sysfs_batch_add(batch, name, "start");
+	}
+	sysfs_batch_read(batch, devdir);
+
+	// Go through them in the same order they were added.
+	idx = 0;
+	for (uint32_t i = 0; i < sd->partitions.count; i++) {
+		partition_t *part = &sd->partitions.list[i];
+		const char *name = device_str(container, part->name);
+
+		// Get the number of sectors and calculate the size.
+		if (fields & DEVICE_FIELD_PARTSIZE) {
+			if (!sysfs_batch_num(batch, idx++, &part->sectors)) {
+				fprintf(stderr, "Failed to read the sector size for %s.\n",
+						name);
+				return false;
+			}
+
+			part->size = part->sectors * sd->sector_size;
+		}
+
+		// Get the permission.
+		if (fields & DEVICE_FIELD_RO) {
+			if (!sysfs_batch_num(batch, idx++, &perm)) {
+				fprintf(stderr, "Failed to read %s permissions.\n", name);
+				return false;
+			}
+
+			part->ro = (perm & true);
 		}
 
-		// Calculate the size.
-		sd->partitions.list[i].size = sd->partitions.list[i].sectors * sd->sector_size;
+		// Get the device number and starting sector for the probe cache.
+		if ((fields & DEVICE_FIELD_DEVNUM) &&
+				!sysfs_batch_dev(batch, idx++, &part->major, &part->minor)) {
+			fprintf(stderr, "Failed to read the device number for %s.\n",
+					name);
+			return false;
+		}
+		if ((fields & DEVICE_FIELD_START) &&
+				!sysfs_batch_num(batch, idx++, &part->start)) {
+			fprintf(stderr, "Failed to read the starting sector for %s.\n",
+					name);
+			return false;
+		}
 	}
 
 	return true;
 }
 
 /**
- * Gets the permission of every partition in a block device. (Read/Write)
+ * Gets the mount points for partitions.
  *
- * @param  sd Storage device structure to be populated with information.
- * @return    TRUE if the parsing was successful.
+ * @param  container Device container that owns the device's memory.
+ * @param  sd        Storage device structure to be populated with information.
+ * @param  mounts    Index of the system's mount table.
+ * @return           TRUE if the parsing was successful.
  */
-bool get_partitions_permission(stdev_t *sd) {
-	char attrpath[PATH_MAX];
-	size_t perm;
+bool get_partitions_mountpoints(stdev_container *container, stdev_t *sd,
+								const mount_index_t *mounts) {
+	for (uint32_t i = 0; i < sd->partitions.count; i++) {
+		partition_t *part = &sd->partitions.list[i];
+		const mount_dev_t *dev;
 
-	for (uint8_t i = 0; i < sd->partitions.count; i++) {
-		// Get the permission.
-		snprintf(attrpath, PATH_MAX, "%s/%s/ro", sd->path,
-				sd->partitions.list[i].name);
+		// Check if the partition is mounted anywhere.
+		dev = mount_index_lookup(mounts, part->major, part->minor);
+		if (dev == NULL)
+			continue;
 
-		if (!freadnum(attrpath, &perm)) {
-			fprintf(stderr, "Failed to read %s permissions.\n",
-					sd->partitions.list[i].name);
-			return false;
-		}
+		// Store the mount points.
+		for (uint32_t j = 0; j < dev->count; j++)
+			device_partition_mount_push(container, part, dev->list[j].mntpoint);
 
-		sd->partitions.list[i].ro = (perm & true);
+		// Store the filesystem type.
+		part->type = strpool_intern(&container->strings, dev->list[0].fstype);
 	}
 
 	return true;
 }
 
 /**
- * Gets the mount points for partitions.
+ * Gets the information of every partition of a list of devices using blkid.
+ * Values that are still valid in the probe cache or that udev already probed
+ * are used instead of touching the disk, everything else gets probed,
+ * optionally on a pool of worker threads.
  *
- * @param  sd Storage device structure to be populated with information.
- * @return    TRUE if the parsing was successful.
+ * @param  container Storage device container that owns the devices.
+ * @param  devs      Devices to be probed.
+ * @param  ndevs     Number of devices to be probed.
+ * @param  opts      Population options.
+ * @return           Always TRUE, partitions that couldn't be probed are just
+ *                   left without the probed information.
  */
-bool get_partitions_mountpoints(stdev_t *sd) {
-	FILE *fp;
-	struct mntent *fs;
-
-	// Open the mount point file.
-	fp = setmntent(MOUNTPOINT_DEF_PATH, "r");
-	if (fp == NULL) {
-		fprintf(stderr, "Failed to read the %s file.\n", MOUNTPOINT_DEF_PATH);
-		return false;
+bool blkid_info(stdev_container *container, stdev_t *devs, uint32_t ndevs,
+				const populate_opts_t *opts) {
+	probe_cache_t cache;
+	blkid_batch_t batch;
+	probe_info_t udev;
+	const char *udev_path;
+	size_t ntasks = 0;
+	unsigned int jobs;
+	uint64_t total;
+	uint64_t start;
+
+	// Load up the cache.
+	total = profile_now(opts->profile);
+	if (opts->cache_path != NULL) {
+		cache_load(&cache, opts->cache_path, opts->refresh);
+		profile_count_opens(opts->profile, 1);
 	}
 
-	// Loop through the mount points in the system.
-	while ((fs = getmntent(fp)) != NULL) {
-		// Check if it's a real device and check for a match with a known partition..
-		if (fs->mnt_fsname[0] == '/') {
-			for (uint8_t i = 0; i < sd->partitions.count; i++) {
-				if (strcmp(fs->mnt_fsname, sd->partitions.list[i].path) == 0) {
-					// Store the mount point.
-					strncpy(sd->partitions.list[i].mntpoint, fs->mnt_dir,
-							DEVICE_PATH_MAX_LEN);
-
-					// Store the filesystem type.
-					strncpy(sd->partitions.list[i].type, fs->mnt_type,
-							PARTITION_TYPE_MAX_LEN);
-				}
+	// Don't bother looking up every partition if there's no udev database.
+	udev_path = opts->udev_path;
+	if ((udev_path != NULL) && (access(udev_path, F_OK) == -1))
+		udev_path = NULL;
+
+	// Set up the batch.
+	for (uint32_t i = 0; i < ndevs; i++)
+		ntasks += devs[i].partitions.count;
+	batch.container = container;
+	batch.devs = devs;
+	batch.ndevs = ndevs;
+	batch.opts = opts;
+	batch.tasks = malloc(sizeof(blkid_task_t) * (ntasks + 1));
+	batch.ntasks = 0;
+	batch.first = malloc(sizeof(size_t) * (ndevs + 1));
+	batch.pending = calloc(ndevs + 1, sizeof(size_t));
+	batch.next = 0;
+	pthread_mutex_init(&batch.lock, NULL);
+
+	// Build the task list in device order with whatever wasn't cached.
+	for (uint32_t i = 0; i < ndevs; i++) {
+		batch.first[i] = batch.ntasks;
+
+		for (uint32_t j = 0; j < devs[i].partitions.count; j++) {
+			partition_t *part = &devs[i].partitions.list[j];
+			blkid_task_t *task = &batch.tasks[batch.ntasks];
+			const probe_info_t *info;
+
+			// Use what we already know about it if we can.
+			start = profile_now(opts->profile);
+			info = blkid_known_info((opts->cache_path != NULL) ? &cache : NULL,
+									udev_path, part, &udev, opts);
+			profile_add(opts->profile, PROFILE_LOOKUP, start);
+			if (info != NULL) {
+				device_partition_set_info(container, part, info);
+				continue;
 			}
+
+			task->part = part;
+			task->dev = i;
+			task->ok = false;
+			task->bytes = -1;
+			task->usecs = 0;
+			device_partition_path(container, opts->roots.dev, part,
+								  task->path);
+			batch.pending[i]++;
+			batch.ntasks++;
+		}
+	}
+
+	// Finish the devices that were fully cached and probe everything else. A
+	// partition we couldn't probe shouldn't take the whole listing down.
+	blkid_batch_advance(&batch);
+	jobs = (opts->jobs == 0) ? ndevs : opts->jobs;
+	blkid_probe_tasks(&batch, jobs);
+	if (opts->debug)
+		blkid_debug(&batch);
+
+	// Update the cache with the freshly probed partitions.
+	if (opts->cache_path != NULL) {
+		for (size_t i = 0; i < batch.ntasks; i++) {
+			if (batch.tasks[i].ok)
+				cache_store(&cache, batch.tasks[i].part, &batch.tasks[i].info);
 		}
+
+		cache_prune(&cache, opts->roots.sysfs);
+		cache_save(&cache);
+		cache_free(&cache);
 	}
 
 	// Clean up.
-	endmntent(fp);
+	pthread_mutex_destroy(&batch.lock);
+	free(batch.pending);
+	free(batch.first);
+	free(batch.tasks);
+	profile_add(opts->profile, PROFILE_BLKID, total);
 	return true;
 }
 
 /**
- * Gets a device information using blkid.
+ * Gets the information of a partition that is still valid in the probe cache
+ * or that udev already probed.
  *
- * @param  sd Storage device structure.
- * @return    TRUE if the probing went fine.
+ * @param  cache     Probe cache or NULL if it isn't used.
+ * @param  udev_path Path to the udev database or NULL if it isn't used.
+ * @param  part      Partition to look up.
+ * @param  udev      Storage for the information found in the udev database.
+ * @param  opts      Population options.
+ * @return           Information about the partition or NULL if it has to be
+ *                   probed.
  */
-bool blkid_info(stdev_t *sd) {
-	char partpath[DEVICE_PATH_MAX_LEN];
+const probe_info_t *blkid_known_info(probe_cache_t *cache,
+									 const char *udev_path,
+									 const partition_t *part,
+									 probe_info_t *udev,
+									 const populate_opts_t *opts) {
+	const probe_info_t *info;
+
+	// Use the cached information if we have it.
+	if (cache != NULL) {
+		info = cache_lookup(cache, part);
+		if (info != NULL)
+			return info;
+	}
+
+	// Use what udev already probed if it did.
+	if (udev_path != NULL) {
+		profile_count_opens(opts->profile, 1);
+		if (udevdb_lookup(udev_path, part->major, part->minor, udev))
+			return udev;
+	}
+
+	return NULL;
+}
+
+/**
+ * Probes all the partitions of a batch, finishing the devices as they're done.
+ * Partitions that couldn't be probed, usually because we aren't root, are
+ * simply left without any probed information.
+ *
+ * @param  batch Batch of partition probing tasks.
+ * @param  jobs  Number of partitions to probe at the same time.
+ * @return       TRUE if all the partitions were probed successfully.
+ */
+bool blkid_probe_tasks(blkid_batch_t *batch, unsigned int jobs) {
+	// Probe one partition at a time or everything at the same time.
+	if (jobs <= 1) {
+		for (size_t i = 0; i < batch->ntasks; i++)
+			blkid_task(i, batch);
+	} else {
+		workers_run(batch->ntasks, jobs, blkid_task, batch);
+	}
+
+	// Only warn about the first failure, the others are usually the same.
+	for (size_t i = 0; i < batch->ntasks; i++) {
+		if (!batch->tasks[i].ok) {
+			blkid_error(batch->tasks[i].path);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Worker pool task that probes a single partition.
+ *
+ * @param idx Index of the task in the batch.
+ * @param arg Batch of partition probing tasks.
+ */
+void blkid_task(size_t idx, void *arg) {
+	blkid_batch_t *batch = (blkid_batch_t *)arg;
+	blkid_task_t *task = &batch->tasks[idx];
+	struct timespec start;
+	struct timespec end;
+	int64_t before = -1;
+	int64_t after;
+	uint64_t began;
+	size_t len;
+
+	// Keep track of how much the probe costs.
+	if (batch->opts->debug) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		before = blkid_thread_rchar(&len);
+	}
+
+	began = profile_now(batch->opts->profile);
+	task->ok = blkid_partition_info(task->path, task->part->size, &task->info);
+	profile_add(batch->opts->profile, PROFILE_PROBE, began);
+	profile_count_opens(batch->opts->profile, 1);
+
+	// The second reading also counts the bytes of the first one.
+	if (batch->opts->debug) {
+		after = blkid_thread_rchar(NULL);
+		if ((before != -1) && (after != -1))
+			task->bytes = after - before - len;
+
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		task->usecs = ((end.tv_sec - start.tv_sec) * 1000000) +
+			((end.tv_nsec - start.tv_nsec) / 1000);
+	}
+
+	// Let the devices that are done go.
+	pthread_mutex_lock(&batch->lock);
+	batch->pending[task->dev]--;
+	blkid_batch_advance(batch);
+	pthread_mutex_unlock(&batch->lock);
+}
+
+/**
+ * Finishes, in order, all the devices that don't have any partitions left to
+ * be probed. Must be called with the batch locked if there are workers
+ * around.
+ *
+ * @param batch Batch of partition probing tasks.
+ */
+void blkid_batch_advance(blkid_batch_t *batch) {
+	const populate_opts_t *opts = batch->opts;
+
+	while ((batch->next < batch->ndevs) && (batch->pending[batch->next] == 0)) {
+		uint32_t dev = batch->next++;
+		size_t last = (batch->next < batch->ndevs) ?
+			batch->first[batch->next] : batch->ntasks;
+
+		// Store the probed information.
+		for (size_t i = batch->first[dev]; i < last; i++) {
+			if (batch->tasks[i].ok) {
+				device_partition_set_info(batch->container,
+										  batch->tasks[i].part,
+										  &batch->tasks[i].info);
+			}
+		}
+
+		// Let everyone know it's ready, if it's one we want.
+		if ((opts->on_ready != NULL) &&
+				filter_match(opts->filter, batch->container, &batch->devs[dev],
+							 FILTER_STAGE_FINAL)) {
+			opts->on_ready(batch->container, &batch->devs[dev], opts->ready_arg);
+		}
+	}
+}
+
+/**
+ * Gets a single partition information using blkid. The probe is restricted to
+ * the superblock values we actually use, without looking for partition tables
+ * or the device topology, and is told the size of the partition up front so
+ * that it doesn't have to figure it out by itself. This function doesn't touch
+ * anything other than its arguments, so it's safe to call it from multiple
+ * threads.
+ *
+ * @param  path Path to the partition device file.
+ * @param  size Size of the partition in bytes as reported by sysfs.
+ * @param  info Probed information to be populated.
+ * @return      TRUE if the probing went fine.
+ */
+bool blkid_partition_info(const char *path, uint64_t size, probe_info_t *info) {
+	blkid_probe pr;
 	const char *uuid;
 	const char *label;
 	const char *type;
+	int fd;
 
-	// Get partitions information.
-	for (int i = 0; i < sd->partitions.count; i++) {
-		// Get partition location.
-		snprintf(partpath, DEVICE_PATH_MAX_LEN, "/dev/%s",
-				sd->partitions.list[i].name);
-
-		// Initialize the parameter strings.
-		sd->partitions.list[i].uuid[0] = '\0';
-		sd->partitions.list[i].label[0] = '\0';
-		sd->partitions.list[i].type[0] = '\0';
-
-		// Create a partition probe.
-		blkid_probe pr = blkid_new_probe_from_filename(partpath);
-		if (!pr) {
-			fprintf(stderr, "Failed to create a blkid probe for %s. "
-					"Maybe run this program as root.\n", partpath);
-			printf("To suppress the error above at the cost of a bit less "
-					"information, just use the --no-blkid flag.\n");
-			return false;
-		}
+	// Initialize the parameter strings.
+	memset(info, 0, sizeof(probe_info_t));
 
-		// Probe partition information.
-		blkid_do_probe(pr);
-		if (!blkid_probe_lookup_value(pr, "UUID", &uuid, NULL))
-			strncpy(sd->partitions.list[i].uuid, uuid, PARTITION_NAME_MAX_LEN);
-		if (!blkid_probe_lookup_value(pr, "LABEL", &label, NULL))
-			strncpy(sd->partitions.list[i].label, label, PARTITION_NAME_MAX_LEN);
-		if (!blkid_probe_lookup_value(pr, "TYPE", &type, NULL))
-			strncpy(sd->partitions.list[i].type, type, PARTITION_TYPE_MAX_LEN);
+	// Open the partition without waiting on removable media.
+	fd = open(path, O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+	if (fd == -1)
+		return false;
 
-		// Clean up.
-		blkid_free_probe(pr);
+	// Create a partition probe that only looks for what we need.
+	pr = blkid_new_probe();
+	if (!pr || (blkid_probe_set_device(pr, fd, 0, size) != 0)) {
+		if (pr)
+			blkid_free_probe(pr);
+		close(fd);
+		return false;
 	}
+	blkid_probe_enable_partitions(pr, 0);
+	blkid_probe_enable_topology(pr, 0);
+	blkid_probe_enable_superblocks(pr, 1);
+	blkid_probe_set_superblocks_flags(pr, BLKID_PROBE_FLAGS);
+
+	// Probe partition information.
+	blkid_do_probe(pr);
+	if (!blkid_probe_lookup_value(pr, "UUID", &uuid, NULL))
+		strncpy(info->uuid, uuid, PARTITION_NAME_MAX_LEN - 1);
+	if (!blkid_probe_lookup_value(pr, "LABEL", &label, NULL))
+		strncpy(info->label, label, PARTITION_NAME_MAX_LEN - 1);
+	if (!blkid_probe_lookup_value(pr, "TYPE", &type, NULL))
+		strncpy(info->type, type, PARTITION_TYPE_MAX_LEN - 1);
 
+	// Clean up.
+	blkid_free_probe(pr);
+	close(fd);
 	return true;
 }
 
+/**
+ * Gets the number of bytes the calling thread has read so far.
+ *
+ * @param  len Optional pointer to store how many bytes reading this number
+ *             took, since it counts as well.
+ * @return     Bytes read by the thread or -1 if the kernel doesn't tell us.
+ */
+int64_t blkid_thread_rchar(size_t *len) {
+	char buf[PROC_IO_BUF_LEN];
+	const char *field;
+	size_t rchar;
+	ssize_t bytes;
+	int fd;
+
+	// Read the I/O statistics of the thread.
+	fd = open(PROC_THREAD_IO_PATH, O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return -1;
+	bytes = read(fd, buf, PROC_IO_BUF_LEN - 1);
+	close(fd);
+	if (bytes < 0)
+		return -1;
+	buf[bytes] = '\0';
+	if (len != NULL)
+		*len = bytes;
+
+	// Get the number of characters read.
+	field = strstr(buf, "rchar: ");
+	if ((field == NULL) || (parse_num(field + 7, &rchar) == NULL))
+		return -1;
+
+	return rchar;
+}
+
+/**
+ * Prints how much each partition probe cost.
+ *
+ * @param batch Batch of partition probing tasks that were run.
+ */
+void blkid_debug(const blkid_batch_t *batch) {
+	for (size_t i = 0; i < batch->ntasks; i++) {
+		const blkid_task_t *task = &batch->tasks[i];
+
+		if (task->bytes < 0) {
+			fprintf(stderr, "blkid: %s: ? bytes read in %" PRIu64 " us\n",
+					task->path, task->usecs);
+		} else {
+			fprintf(stderr, "blkid: %s: %" PRId64 " bytes read in %" PRIu64
+					" us\n", task->path, task->bytes, task->usecs);
+		}
+	}
+}
+
+/**
+ * Prints the error message for when we couldn't probe a partition.
+ *
+ * @param path Path to the partition that failed to be probed.
+ */
+void blkid_error(const char *path) {
+	fprintf(stderr, "Failed to create a blkid probe for %s. "
+			"Maybe run this program as root.\n", path);
+	fprintf(stderr, "To suppress the error above at the cost of a bit less "
+			"information, just use the --no-blkid flag.\n");
+}
+
 /**
  * Checks if a directory should be ignored because it's not a valid block
  * device.
@@ -12,8 +12,13 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include "device.h"
+#include "lookup.h"
 
-bool populate_devices(stdev_container *container, const bool useblkid);
+bool populate_devices(stdev_container *container, const populate_opts_t *opts);
+bool populate_device(stdev_container *container, const char *name,
+					 const populate_opts_t *opts, stdev_t *sd);
+bool populate_target(stdev_container *container, const lookup_target_t *target,
+					 const populate_opts_t *opts);
 
 #endif  //_LINUX_H
 
@@ -0,0 +1,242 @@
+/**
+ * lookup.c
+ * Resolves a single device from its name, UUID, label or mount point.
+ *
+ * Instead of enumerating every block device in the system, a lookup goes
+ * straight to the indexes the system already keeps: sysfs for device names
+ * and numbers, the udev by-uuid/by-label symlinks and the mount table. The
+ * resolved sysfs directory tells us if it's a partition and which device it
+ * belongs to, so that only that device ever gets looked at.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "lookup.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include "mounts.h"
+
+// Constants.
+#define LOOKUP_TAG_SAFE_CHARS "#+-.:=@_"
+
+// Names of the keys for error messages.
+static const char *lookup_key_names[] = {
+	"name",
+	"UUID",
+	"label",
+	"mount point"
+};
+
+// Private methods.
+bool lookup_sysfs(const char *path, lookup_target_t *target);
+bool lookup_devnum(const device_roots_t *roots, uint32_t major, uint32_t minor,
+				   lookup_target_t *target);
+bool lookup_block_file(const device_roots_t *roots, const char *path,
+					   lookup_target_t *target);
+bool lookup_tag(const device_roots_t *roots, const char *dir,
+				const char *value, lookup_target_t *target);
+bool lookup_mountpoint(const device_roots_t *roots, const char *mntpoint,
+					   lookup_target_t *target);
+bool lookup_copy_name(char *dst, const char *path);
+
+/**
+ * Resolves the device that a lookup is referring to.
+ *
+ * @param  roots  Where the system exposes its devices and mount table.
+ * @param  key    What the device is being looked up by.
+ * @param  value  Name (or device file), UUID, label or mount point.
+ * @param  target Device and partition that were found.
+ * @return        TRUE if the device was found.
+ */
+bool lookup_resolve(const device_roots_t *roots, lookup_key_t key,
+					const char *value, lookup_target_t *target) {
+	char path[PATH_MAX];
+	bool found = false;
+
+	memset(target, 0, sizeof(lookup_target_t));
+	switch (key) {
+		case LOOKUP_DEVICE:
+			// Device files may have any name, so go by their number.
+			if (strchr(value, '/') != NULL) {
+				found = lookup_block_file(roots, value, target);
+				break;
+			}
+
+			snprintf(path, PATH_MAX, "%s%s%s", roots->sysfs,
+					 LOOKUP_CLASS_BLOCK_DIR, value);
+			found = lookup_sysfs(path, target);
+			break;
+		case LOOKUP_UUID:
+			found = lookup_tag(roots, LOOKUP_BY_UUID_DIR, value, target);
+			break;
+		case LOOKUP_LABEL:
+			found = lookup_tag(roots, LOOKUP_BY_LABEL_DIR, value, target);
+			break;
+		case LOOKUP_MOUNTPOINT:
+			found = lookup_mountpoint(roots, value, target);
+			break;
+	}
+
+	if (!found) {
+		fprintf(stderr, "No device found with %s %s.\n", lookup_key_names[key],
+				value);
+	}
+
+	return found;
+}
+
+/**
+ * Resolves a device from its sysfs directory. Partition directories live
+ * inside the directory of the device they belong to.
+ *
+ * @param  path   Path to the sysfs directory, usually a symlink.
+ * @param  target Device and partition that were found.
+ * @return        TRUE if the directory exists.
+ */
+bool lookup_sysfs(const char *path, lookup_target_t *target) {
+	char real[PATH_MAX];
+	char attr[PATH_MAX];
+	char *sep;
+
+	// Find the actual device directory.
+	if (realpath(path, real) == NULL)
+		return false;
+
+	// Check if it's a partition.
+	if (snprintf(attr, PATH_MAX, "%s/partition", real) >= PATH_MAX)
+		return false;
+	if (access(attr, F_OK) == -1)
+		return lookup_copy_name(target->disk, real);
+
+	// Get the partition and then the device it belongs to.
+	if (!lookup_copy_name(target->part, real))
+		return false;
+	sep = strrchr(real, '/');
+	*sep = '\0';
+
+	return lookup_copy_name(target->disk, real);
+}
+
+/**
+ * Resolves a device from its device number.
+ *
+ * @param  roots  Where the system exposes its devices and mount table.
+ * @param  major  Major number of the device.
+ * @param  minor  Minor number of the device.
+ * @param  target Device and partition that were found.
+ * @return        TRUE if the device exists.
+ */
+bool lookup_devnum(const device_roots_t *roots, uint32_t major, uint32_t minor,
+				   lookup_target_t *target) {
+	char path[PATH_MAX];
+
+	snprintf(path, PATH_MAX, "%s%s%u:%u", roots->sysfs, LOOKUP_DEV_BLOCK_DIR,
+			 major, minor);
+	return lookup_sysfs(path, target);
+}
+
+/**
+ * Resolves a device from its device file.
+ *
+ * @param  roots  Where the system exposes its devices and mount table.
+ * @param  path   Path to the device file or a symlink to it.
+ * @param  target Device and partition that were found.
+ * @return        TRUE if the file is a block device.
+ */
+bool lookup_block_file(const device_roots_t *roots, const char *path,
+					   lookup_target_t *target) {
+	struct stat st;
+
+	if ((stat(path, &st) != 0) || !S_ISBLK(st.st_mode))
+		return false;
+
+	return lookup_devnum(roots, major(st.st_rdev), minor(st.st_rdev), target);
+}
+
+/**
+ * Resolves a device through one of the udev symlink directories. Tags are
+ * encoded the same way udev does it, with everything that isn't safe in a
+ * file name turned into a \xNN escape.
+ *
+ * @param  roots  Where the system exposes its devices and mount table.
+ * @param  dir    Symlink directory relative to /dev. (with a trailing slash)
+ * @param  value  UUID or label of the device.
+ * @param  target Device and partition that were found.
+ * @return        TRUE if the device was found.
+ */
+bool lookup_tag(const device_roots_t *roots, const char *dir,
+				const char *value, lookup_target_t *target) {
+	char path[PATH_MAX];
+	size_t len;
+
+	// Build the encoded symlink path.
+	len = snprintf(path, PATH_MAX, "%s%s", roots->dev, dir);
+	if (len >= PATH_MAX)
+		return false;
+	for (const unsigned char *c = (const unsigned char *)value; *c != '\0';
+			c++) {
+		if (len + 5 > PATH_MAX)
+			return false;
+
+		if ((*c >= 0x80) || ((*c >= '0') && (*c <= '9')) ||
+				((*c >= 'A') && (*c <= 'Z')) || ((*c >= 'a') && (*c <= 'z')) ||
+				(strchr(LOOKUP_TAG_SAFE_CHARS, *c) != NULL)) {
+			path[len++] = *c;
+		} else {
+			len += sprintf(path + len, "\\x%02x", *c);
+		}
+	}
+	path[len] = '\0';
+
+	return lookup_block_file(roots, path, target);
+}
+
+/**
+ * Resolves the device mounted at a path.
+ *
+ * @param  roots    Where the system exposes its devices and mount table.
+ * @param  mntpoint Mount point of the device.
+ * @param  target   Device and partition that were found.
+ * @return          TRUE if a block device is mounted at the path.
+ */
+bool lookup_mountpoint(const device_roots_t *roots, const char *mntpoint,
+					   lookup_target_t *target) {
+	char real[PATH_MAX];
+	uint32_t major;
+	uint32_t minor;
+
+	// The mount table only has canonical paths, but the ones of a fixture
+	// don't actually exist.
+	if (realpath(mntpoint, real) == NULL)
+		snprintf(real, PATH_MAX, "%s", mntpoint);
+
+	if (!mount_find_path(roots->mountinfo, roots->mtab, real, &major, &minor))
+		return false;
+
+	return lookup_devnum(roots, major, minor, target);
+}
+
+/**
+ * Copies the last component of a path as a device name.
+ *
+ * @param  dst  Buffer of NAME_MAX + 1 bytes for the name.
+ * @param  path Path to get the name from.
+ * @return      TRUE if the name fits.
+ */
+bool lookup_copy_name(char *dst, const char *path) {
+	const char *name;
+	size_t len;
+
+	name = strrchr(path, '/');
+	name = (name != NULL) ? name + 1 : path;
+	len = strlen(name);
+	if ((len == 0) || (len > NAME_MAX))
+		return false;
+
+	memcpy(dst, name, len + 1);
+	return true;
+}
@@ -0,0 +1,42 @@
+/**
+ * lookup.h
+ * Resolves a single device from its name, UUID, label or mount point.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _LOOKUP_H
+#define _LOOKUP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "device.h"
+
+// Constants. (relative to the sysfs and /dev roots)
+#define LOOKUP_CLASS_BLOCK_DIR "/class/block/"
+#define LOOKUP_DEV_BLOCK_DIR   "/dev/block/"
+#define LOOKUP_BY_UUID_DIR     "/disk/by-uuid/"
+#define LOOKUP_BY_LABEL_DIR    "/disk/by-label/"
+
+// What a device is being looked up by.
+typedef enum {
+	LOOKUP_DEVICE,
+	LOOKUP_UUID,
+	LOOKUP_LABEL,
+	LOOKUP_MOUNTPOINT
+} lookup_key_t;
+
+// Device that was found. The partition name is empty when the lookup matched
+// the whole device.
+typedef struct {
+	char disk[NAME_MAX + 1];
+	char part[NAME_MAX + 1];
+} lookup_target_t;
+
+// Resolving.
+bool lookup_resolve(const device_roots_t *roots, lookup_key_t key,
+					const char *value, lookup_target_t *target);
+
+#endif  //_LOOKUP_H
@@ -0,0 +1,215 @@
+/**
+ * lssd.c
+ * Embeddable interface for listing storage devices.
+ *
+ * A listing is populated exactly like the command-line tool does it, into a
+ * container that belongs to the listing alone. The devices are then laid out
+ * as plain structures allocated from the container's arena, with strings
+ * pointing straight into its string pool, so handing them out costs a single
+ * pass and freeing them is freeing the container.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "lssd.h"
+#include <string.h>
+#ifdef __linux__
+#include "linux.h"
+#include "udevdb.h"
+#elif __NetBSD__
+#include "netbsd.h"
+#endif
+#include "cache.h"
+#include "device.h"
+#include "filter.h"
+
+// The public fields are the same as the ones we use internally.
+_Static_assert(LSSD_FIELD_ALL == DEVICE_FIELD_ALL,
+			   "Public and internal device fields differ");
+_Static_assert(LSSD_FIELD_PROBE == DEVICE_FIELD_PROBE,
+			   "Public and internal device fields differ");
+
+// Private methods.
+bool lssd_filter(const lssd_context_t *ctx, filter_t *filter);
+void lssd_opts(const lssd_context_t *ctx, const filter_t *filter,
+			   populate_opts_t *opts);
+void lssd_layout(stdev_container *container, lssd_devices_t *devs);
+
+/**
+ * Initializes a context with the same defaults as the command-line tool.
+ *
+ * @param ctx Context to be initialized.
+ */
+void lssd_context_init(lssd_context_t *ctx) {
+	memset(ctx, 0, sizeof(lssd_context_t));
+	ctx->fields = LSSD_FIELD_ALL;
+	ctx->jobs = 1;
+	ctx->cache_path = CACHE_DEF_PATH;
+#ifdef __linux__
+	ctx->udev_path = UDEVDB_DEF_PATH;
+#endif
+	ctx->sysfs_root = DEVICE_SYSFS_DEF_ROOT;
+	ctx->dev_root = DEVICE_DEV_DEF_ROOT;
+	ctx->mountinfo = DEVICE_MOUNTINFO_DEF_PATH;
+	ctx->mtab = DEVICE_MTAB_DEF_PATH;
+}
+
+/**
+ * Lists the storage devices in the system. Safe to call from multiple
+ * threads at the same time.
+ *
+ * @param  ctx  Options of the listing.
+ * @param  devs Devices that were found. (must be freed with lssd_devices_free)
+ * @return      TRUE if the operation was successful.
+ */
+bool lssd_populate(const lssd_context_t *ctx, lssd_devices_t *devs) {
+	stdev_container *container;
+	populate_opts_t opts;
+	filter_t filter;
+	bool success;
+
+	memset(devs, 0, sizeof(lssd_devices_t));
+
+	// Set up what we want and how to get it.
+	if (!lssd_filter(ctx, &filter))
+		return false;
+	lssd_opts(ctx, &filter, &opts);
+
+	// Gather the devices.
+	container = malloc(sizeof(stdev_container));
+	device_container_init(container);
+	success = populate_devices(container, &opts);
+	filter_free(&filter);
+	if (!success) {
+		device_container_free(container);
+		free(container);
+		return false;
+	}
+
+	// Hand them out.
+	lssd_layout(container, devs);
+	return true;
+}
+
+/**
+ * Frees the devices of a listing.
+ *
+ * @param devs Devices to be freed.
+ */
+void lssd_devices_free(lssd_devices_t *devs) {
+	if (devs->priv != NULL) {
+		device_container_free((stdev_container *)devs->priv);
+		free(devs->priv);
+	}
+
+	memset(devs, 0, sizeof(lssd_devices_t));
+}
+
+/**
+ * Builds the device filter of a listing.
+ *
+ * @param  ctx    Options of the listing.
+ * @param  filter Filter to be initialized.
+ * @return        TRUE if the predicate expression is valid.
+ */
+bool lssd_filter(const lssd_context_t *ctx, filter_t *filter) {
+	filter_init(filter);
+	if (ctx->include != NULL)
+		filter_include(filter, ctx->include);
+	if (ctx->exclude != NULL)
+		filter_exclude(filter, ctx->exclude);
+	if ((ctx->filter != NULL) && !filter_parse(filter, ctx->filter)) {
+		filter_free(filter);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Translates a context into population options, only gathering what was
+ * asked for and what the filter needs.
+ *
+ * @param ctx    Options of the listing.
+ * @param filter Device filter of the listing.
+ * @param opts   Population options to be set up.
+ */
+void lssd_opts(const lssd_context_t *ctx, const filter_t *filter,
+			   populate_opts_t *opts) {
+	memset(opts, 0, sizeof(populate_opts_t));
+	opts->jobs = ctx->jobs;
+	opts->cache_path = ctx->cache_path;
+	opts->refresh = (ctx->flags & LSSD_FLAG_REFRESH) != 0;
+	opts->udev_path = ctx->udev_path;
+	opts->filter = filter;
+	opts->uring = (ctx->flags & LSSD_FLAG_URING) != 0;
+	opts->roots.sysfs = ctx->sysfs_root;
+	opts->roots.dev = ctx->dev_root;
+	opts->roots.mountinfo = ctx->mountinfo;
+	opts->roots.mtab = ctx->mtab;
+
+	opts->fields = device_fields_resolve((ctx->fields & DEVICE_FIELD_ALL) |
+										 filter_fields(filter));
+	opts->useblkid = (opts->fields & DEVICE_FIELD_PROBE) != 0;
+}
+
+/**
+ * Lays the devices of a container out as the public structures.
+ *
+ * @param container Populated devices, which will be owned by the listing.
+ * @param devs      Listing to be populated.
+ */
+void lssd_layout(stdev_container *container, lssd_devices_t *devs) {
+	lssd_device_t *list;
+
+	list = arena_alloc(&container->arena,
+					   sizeof(lssd_device_t) * container->count);
+	for (uint32_t i = 0; i < container->count; i++) {
+		const stdev_t *sd = &container->list[i];
+		lssd_device_t *dev = &list[i];
+		lssd_partition_t *parts;
+
+		// Device.
+		dev->name = device_str(container, sd->name);
+		dev->sectors = sd->sectors;
+		dev->sector_size = sd->sector_size;
+		dev->size = sd->size;
+		dev->major = sd->major;
+		dev->minor = sd->minor;
+		dev->ro = sd->ro;
+		dev->nparts = sd->partitions.count;
+
+		// Partitions.
+		parts = arena_alloc(&container->arena,
+							sizeof(lssd_partition_t) * sd->partitions.count);
+		for (uint32_t j = 0; j < sd->partitions.count; j++) {
+			const partition_t *part = &sd->partitions.list[j];
+			lssd_partition_t *p = &parts[j];
+			const char **mntpoints;
+
+			p->name = device_str(container, part->name);
+			p->uuid = device_str(container, part->uuid);
+			p->label = device_str(container, part->label);
+			p->type = device_str(container, part->type);
+			p->sectors = part->sectors;
+			p->size = part->size;
+			p->start = part->start;
+			p->major = part->major;
+			p->minor = part->minor;
+			p->ro = part->ro;
+			p->mntcount = part->mntcount;
+
+			// Mount points.
+			mntpoints = arena_alloc(&container->arena,
+									sizeof(const char *) * part->mntcount);
+			for (uint32_t k = 0; k < part->mntcount; k++)
+				mntpoints[k] = device_str(container, part->mntpoints[k]);
+			p->mntpoints = mntpoints;
+		}
+		dev->parts = parts;
+	}
+
+	devs->count = container->count;
+	devs->list = list;
+	devs->priv = container;
+}
@@ -8,19 +8,89 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <getopt.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
 
 #ifdef __linux__
 #include "linux.h"
+#include "watch.h"
+#include "daemon.h"
+#include "udevdb.h"
+#include "topology.h"
+#include "iostat.h"
 #elif __NetBSD__
 #include "netbsd.h"
 #endif
+#include "cache.h"
+#include "shm.h"
+#include "snapshot.h"
+#include "diff.h"
+#include "output.h"
+#include "filter.h"
+#include "columns.h"
+#include "profile.h"
+
+// Long-only options.
+enum {
+	OPT_WATCH_REPLAY = 256,
+	OPT_DAEMON,
+	OPT_CLIENT,
+	OPT_SOCKET,
+	OPT_INTERVAL,
+	OPT_PUBLISH,
+	OPT_JSON,
+	OPT_NDJSON,
+	OPT_INCLUDE,
+	OPT_EXCLUDE,
+	OPT_FILTER,
+	OPT_DEVICE,
+	OPT_UUID,
+	OPT_LABEL,
+	OPT_MOUNTPOINT,
+	OPT_DEBUG,
+	OPT_UDEV_DB,
+	OPT_NO_UDEV,
+	OPT_SYSFS_ROOT,
+	OPT_DEV_ROOT,
+	OPT_MOUNTINFO,
+	OPT_MTAB,
+	OPT_PROFILE,
+	OPT_URING,
+	OPT_TOPOLOGY,
+	OPT_SAVE_SNAPSHOT,
+	OPT_DIFF,
+	OPT_IOSTAT
+};
+
+// Exit codes when comparing against a snapshot, just like diff(1).
+#define EXIT_UNCHANGED EXIT_SUCCESS
+#define EXIT_CHANGED   1
+#define EXIT_TROUBLE   2
 
 // Prototypes.
 void usage();
+int compare_snapshot(stdev_container *container, const char *diff_path,
+					 const char *save_path);
+#ifdef __linux__
+bool print_topology(const stdev_container *container,
+					const device_roots_t *roots);
+bool print_iostat(const stdev_container *container, const char *sysfs_root,
+				  uint64_t interval_ns, bool uring);
+#endif
 
 // Storage device container.
 stdev_container stdevs;
 
+// Devices we care about.
+filter_t filter;
+
+// Columns to be shown.
+columns_t columns;
+
+// Where the time went.
+profile_t profile;
+
 /**
  * Application's main entry point.
  *
@@ -30,24 +100,253 @@ stdev_container stdevs;
  */
 int main(int argc, char **argv) {
 	int option_idx = 0;
-	bool pretty = true;
-	bool useblkid = true;
+	output_format_t format = OUTPUT_TREE;
+	bool table = false;
+	bool pretty;
+	bool watch = false;
+	const char *replay = NULL;
+	bool daemon = false;
+	bool client = false;
+	const char *publish = NULL;
+	bool profiling = false;
+	bool profile_json = false;
+	bool topology = false;
+	const char *save_path = NULL;
+	const char *diff_path = NULL;
+	bool snapshots;
+	int status = EXIT_SUCCESS;
+	uint64_t iostat = 0;
+	double secs;
+	uint64_t start;
+#ifdef __linux__
+	lookup_key_t lookup = LOOKUP_DEVICE;
+	const char *lookup_value = NULL;
+#endif
+	bool success;
+	output_t out;
+	char *endptr;
+	populate_opts_t opts = {
+		.useblkid = true,
+		.jobs = 1,
+		.cache_path = CACHE_DEF_PATH,
+		.refresh = false,
+#ifdef __linux__
+		.udev_path = UDEVDB_DEF_PATH,
+#else
+		.udev_path = NULL,
+#endif
+		.on_ready = NULL,
+		.ready_arg = NULL,
+		.filter = &filter,
+		.fields = DEVICE_FIELD_ALL,
+		.debug = false,
+		.uring = false,
+		.roots = {
+			.sysfs = DEVICE_SYSFS_DEF_ROOT,
+			.dev = DEVICE_DEV_DEF_ROOT,
+			.mountinfo = DEVICE_MOUNTINFO_DEF_PATH,
+			.mtab = DEVICE_MTAB_DEF_PATH
+		},
+		.profile = NULL
+	};
+#ifdef __linux__
+	daemon_opts_t dopts = {
+		.socket_path = DAEMON_DEF_SOCKET,
+		.publish_path = NULL,
+		.interval = DAEMON_DEF_INTERVAL
+	};
+#endif
 
 	// Set the long options for getopt.
 	static struct option loptions[] = {
 		{ "ugly", no_argument, NULL, 'u' },
 		{ "no-blkid", no_argument, NULL, 'k' },
-		{ "help", no_argument, NULL, 'h' }
+		{ "jobs", required_argument, NULL, 'j' },
+		{ "cache", required_argument, NULL, 'c' },
+		{ "refresh", no_argument, NULL, 'r' },
+		{ "watch", no_argument, NULL, 'w' },
+		{ "watch-replay", required_argument, NULL, OPT_WATCH_REPLAY },
+		{ "daemon", no_argument, NULL, OPT_DAEMON },
+		{ "client", no_argument, NULL, OPT_CLIENT },
+		{ "socket", required_argument, NULL, OPT_SOCKET },
+		{ "interval", required_argument, NULL, OPT_INTERVAL },
+		{ "publish", required_argument, NULL, OPT_PUBLISH },
+		{ "json", no_argument, NULL, OPT_JSON },
+		{ "ndjson", no_argument, NULL, OPT_NDJSON },
+		{ "include", required_argument, NULL, OPT_INCLUDE },
+		{ "exclude", required_argument, NULL, OPT_EXCLUDE },
+		{ "filter", required_argument, NULL, OPT_FILTER },
+		{ "output", required_argument, NULL, 'o' },
+		{ "debug", no_argument, NULL, OPT_DEBUG },
+		{ "udev-db", required_argument, NULL, OPT_UDEV_DB },
+		{ "no-udev", no_argument, NULL, OPT_NO_UDEV },
+		{ "sysfs-root", required_argument, NULL, OPT_SYSFS_ROOT },
+		{ "dev-root", required_argument, NULL, OPT_DEV_ROOT },
+		{ "mountinfo", required_argument, NULL, OPT_MOUNTINFO },
+		{ "mtab", required_argument, NULL, OPT_MTAB },
+		{ "profile", optional_argument, NULL, OPT_PROFILE },
+		{ "uring", no_argument, NULL, OPT_URING },
+		{ "topology", no_argument, NULL, OPT_TOPOLOGY },
+		{ "save-snapshot", required_argument, NULL, OPT_SAVE_SNAPSHOT },
+		{ "diff", required_argument, NULL, OPT_DIFF },
+		{ "iostat", required_argument, NULL, OPT_IOSTAT },
+		{ "device", required_argument, NULL, OPT_DEVICE },
+		{ "uuid", required_argument, NULL, OPT_UUID },
+		{ "label", required_argument, NULL, OPT_LABEL },
+		{ "mountpoint", required_argument, NULL, OPT_MOUNTPOINT },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
 	};
 
 	// Loop through flags.
-	while ((option_idx = getopt_long(argc, argv, "ukh", loptions, NULL)) != -1) {
+	columns_all(&columns);
+	while ((option_idx = getopt_long(argc, argv, "ukj:c:rwo:h", loptions, NULL)) != -1) {
 		switch (option_idx) {
 			case 'u':
-				pretty = false;
+				format = OUTPUT_UGLY;
 				break;
 			case 'k':
-				useblkid = false;
+				opts.useblkid = false;
+				break;
+			case 'j':
+				errno = 0;
+				opts.jobs = strtoul(optarg, &endptr, 10);
+				if ((errno != 0) || (*endptr != '\0') || (optarg[0] == '-')) {
+					fprintf(stderr, "Invalid number of jobs: %s\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'c':
+				opts.cache_path = (strcmp(optarg, "none") == 0) ? NULL : optarg;
+				break;
+			case 'r':
+				opts.refresh = true;
+				break;
+			case 'w':
+				watch = true;
+				break;
+			case 'o':
+				if (!columns_parse(&columns, optarg)) {
+					filter_free(&filter);
+					return EXIT_FAILURE;
+				}
+				table = true;
+				break;
+			case OPT_WATCH_REPLAY:
+				watch = true;
+				replay = optarg;
+				break;
+#ifdef __linux__
+			case OPT_DAEMON:
+				daemon = true;
+				break;
+			case OPT_CLIENT:
+				client = true;
+				break;
+			case OPT_SOCKET:
+				dopts.socket_path = optarg;
+				break;
+			case OPT_INTERVAL:
+				errno = 0;
+				dopts.interval = strtoul(optarg, &endptr, 10);
+				if ((errno != 0) || (*endptr != '\0') || (optarg[0] == '-')) {
+					fprintf(stderr, "Invalid refresh interval: %s\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+			case OPT_UDEV_DB:
+				opts.udev_path = optarg;
+				break;
+			case OPT_NO_UDEV:
+				opts.udev_path = NULL;
+				break;
+			case OPT_DEVICE:
+				lookup = LOOKUP_DEVICE;
+				lookup_value = optarg;
+				break;
+			case OPT_UUID:
+				lookup = LOOKUP_UUID;
+				lookup_value = optarg;
+				break;
+			case OPT_LABEL:
+				lookup = LOOKUP_LABEL;
+				lookup_value = optarg;
+				break;
+			case OPT_MOUNTPOINT:
+				lookup = LOOKUP_MOUNTPOINT;
+				lookup_value = optarg;
+				break;
+			case OPT_URING:
+				opts.uring = true;
+				break;
+			case OPT_TOPOLOGY:
+				topology = true;
+				break;
+			case OPT_IOSTAT:
+				errno = 0;
+				secs = strtod(optarg, &endptr);
+				if ((errno != 0) || (*endptr != '\0') || !(secs > 0) ||
+						(secs >= (double)(UINT64_MAX / 1000000000))) {
+					fprintf(stderr, "Invalid sampling interval: %s\n", optarg);
+					return EXIT_FAILURE;
+				}
+				iostat = secs * 1000000000;
+				if (iostat == 0)
+					iostat = 1;
+				break;
+#endif
+			case OPT_PUBLISH:
+				publish = optarg;
+				break;
+			case OPT_SAVE_SNAPSHOT:
+				save_path = optarg;
+				break;
+			case OPT_DIFF:
+				diff_path = optarg;
+				break;
+			case OPT_JSON:
+				format = OUTPUT_JSON;
+				break;
+			case OPT_NDJSON:
+				format = OUTPUT_NDJSON;
+				break;
+			case OPT_INCLUDE:
+				filter_include(&filter, optarg);
+				break;
+			case OPT_EXCLUDE:
+				filter_exclude(&filter, optarg);
+				break;
+			case OPT_FILTER:
+				if (!filter_parse(&filter, optarg)) {
+					filter_free(&filter);
+					return EXIT_FAILURE;
+				}
+				break;
+			case OPT_DEBUG:
+				opts.debug = true;
+				break;
+			case OPT_SYSFS_ROOT:
+				opts.roots.sysfs = optarg;
+				break;
+			case OPT_DEV_ROOT:
+				opts.roots.dev = optarg;
+				break;
+			case OPT_MOUNTINFO:
+				opts.roots.mountinfo = optarg;
+				break;
+			case OPT_MTAB:
+				opts.roots.mtab = optarg;
+				break;
+			case OPT_PROFILE:
+				profiling = true;
+				if ((optarg == NULL) || (strcmp(optarg, "table") == 0)) {
+					profile_json = false;
+				} else if (strcmp(optarg, "json") == 0) {
+					profile_json = true;
+				} else {
+					fprintf(stderr, "Invalid profile format: %s\n", optarg);
+					return EXIT_FAILURE;
+				}
 				break;
 			case 'h':
 				usage();
@@ -58,28 +357,368 @@ int main(int argc, char **argv) {
 		}
 	}
 
-	// Populate the device list.
-	if (!populate_devices(&stdevs, useblkid))
+	// Set up the output.
+	if (table && !((format == OUTPUT_JSON) || (format == OUTPUT_NDJSON)))
+		format = OUTPUT_TABLE;
+	output_init(&out, format, &columns, STDOUT_FILENO);
+	pretty = format != OUTPUT_UGLY;
+	if ((output_streams(&out) || table) && (watch || daemon)) {
+		fprintf(stderr, "JSON output and column selection can only be used to "
+				"list the devices.\n");
+		return EXIT_FAILURE;
+	}
+
+	// Snapshots replace the listing and are always keyed by device number.
+	snapshots = (save_path != NULL) || (diff_path != NULL);
+	if (snapshots && (output_streams(&out) || table || topology || watch ||
+					  daemon || client)) {
+		fprintf(stderr, "Snapshots can only be taken of a single listing.\n");
 		return EXIT_FAILURE;
+	}
 
-	// Print information for all the devices available.
-	for (uint8_t i = 0; i < stdevs.count; i++) {
-		device_print_info(stdevs.list[i], pretty);
+	// Only gather what's going to be shown or filtered on.
+	if (!opts.useblkid)
+		opts.fields &= ~DEVICE_FIELD_PROBE;
+	opts.fields = device_fields_resolve(opts.fields &
+		(columns_fields(&columns) | filter_fields(&filter) |
+		 (snapshots ? DEVICE_FIELD_DISKNUM : 0)));
+	if (iostat > 0) {
+		// Sampling only needs to know where the partitions are.
+		opts.fields = device_fields_resolve(opts.fields &
+			(DEVICE_FIELD_PARTITIONS | filter_fields(&filter)));
+	}
+	if (!(opts.fields & DEVICE_FIELD_PROBE))
+		opts.useblkid = false;
+
+	// Profiling is only meant for a single listing.
+	if (profiling && (watch || daemon || client)) {
+		fprintf(stderr, "Profiling can only be used to list the devices.\n");
+		return EXIT_FAILURE;
+	}
+
+#ifdef __linux__
+	if ((lookup_value != NULL) && (watch || daemon || client)) {
+		fprintf(stderr, "Device lookups can only be used to list the "
+				"devices.\n");
+		return EXIT_FAILURE;
 	}
-	
+	if (topology && (output_streams(&out) || table || watch || daemon ||
+					 client)) {
+		fprintf(stderr, "The topology can only be shown as a tree of the "
+				"listed devices.\n");
+		return EXIT_FAILURE;
+	}
+	if ((iostat > 0) && (output_streams(&out) || table || topology || watch ||
+						 daemon || client || snapshots)) {
+		fprintf(stderr, "Device activity can only be sampled on its own.\n");
+		return EXIT_FAILURE;
+	}
+
+	// Ask a running daemon for the devices instead of scanning them.
+	if (client) {
+		if (!daemon_query(&stdevs, dopts.socket_path))
+			return EXIT_FAILURE;
+		filter_container(&filter, &stdevs);
+
+		goto print;
+	}
+#endif
+
+	// Populate the device list, streaming each device out as soon as it's
+	// ready if the output format allows.
+	if (output_streams(&out)) {
+		opts.on_ready = output_device;
+		opts.ready_arg = &out;
+	}
+	if (profiling) {
+		opts.profile = &profile;
+		profile_start(&profile);
+	}
+	start = profile_now(opts.profile);
+#ifdef __linux__
+	if (lookup_value != NULL) {
+		lookup_target_t target;
+
+		// Go straight to the device we're looking for.
+		success = lookup_resolve(&opts.roots, lookup, lookup_value,
+								 &target) &&
+			populate_target(&stdevs, &target, &opts);
+	} else {
+		success = populate_devices(&stdevs, &opts);
+	}
+#else
+	success = populate_devices(&stdevs, &opts);
+#endif
+	profile_add(opts.profile, PROFILE_POPULATE, start);
+	if (!success) {
+		output_finish(&out);
+		return (diff_path != NULL) ? EXIT_TROUBLE : EXIT_FAILURE;
+	}
+
+	// Publish the devices once for the readers of the memory-mapped file.
+	if ((publish != NULL) && !daemon) {
+		shm_publisher_t shm;
+
+		success = shm_publisher_open(&shm, publish) &&
+			shm_publish(&shm, &stdevs);
+		shm_publisher_close(&shm);
+		if (!success) {
+			device_container_free(&stdevs);
+			filter_free(&filter);
+			return EXIT_FAILURE;
+		}
+	}
+
+#ifdef __linux__
+	// Stay around serving the devices to clients.
+	if (daemon) {
+		dopts.publish_path = publish;
+		success = daemon_run(&stdevs, &opts, &dopts);
+
+		device_container_free(&stdevs);
+		filter_free(&filter);
+		return success ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	// Keep sampling the activity of the devices.
+	if (iostat > 0) {
+		success = print_iostat(&stdevs, opts.roots.sysfs, iostat, opts.uring);
+
+		device_container_free(&stdevs);
+		filter_free(&filter);
+		return success ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	// Keep watching for changes.
+	if (watch) {
+		uevent_source_t src;
+
+		// Open the event source.
+		if (!((replay != NULL) ? uevent_open_replay(&src, replay) :
+				uevent_open_netlink(&src))) {
+			device_container_free(&stdevs);
+			filter_free(&filter);
+			return EXIT_FAILURE;
+		}
+
+		success = watch_devices(&stdevs, &opts, &src, pretty);
+
+		// Clean up.
+		uevent_close(&src);
+		device_container_free(&stdevs);
+		filter_free(&filter);
+		return success ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+print:
+#endif
+	// Output all the devices available if they weren't streamed already.
+	start = profile_now(opts.profile);
+	success = true;
+#ifdef __linux__
+	if (topology)
+		success = print_topology(&stdevs, &opts.roots);
+#endif
+	if (snapshots) {
+		status = compare_snapshot(&stdevs, diff_path, save_path);
+		success = status != EXIT_TROUBLE;
+	} else if ((opts.on_ready == NULL) && !topology) {
+		for (uint32_t i = 0; i < stdevs.count; i++)
+			output_device(&stdevs, &stdevs.list[i], &out);
+	}
+	success = output_finish(&out) && success;
+	profile_add(opts.profile, PROFILE_OUTPUT, start);
+
+	// Show where the time went.
+	if (opts.profile != NULL) {
+		profile_stop(&profile);
+		profile_print(&profile, profile_json, STDERR_FILENO);
+	}
+
 	// Clean up and exit.
 	device_container_free(&stdevs);
-	return EXIT_SUCCESS;
+	filter_free(&filter);
+	if (!success)
+		return (diff_path != NULL) ? EXIT_TROUBLE : EXIT_FAILURE;
+	return status;
+}
+
+/**
+ * Compares the devices against a snapshot and/or saves them as one. Both are
+ * sorted by device number first, so the snapshots don't depend on the order
+ * the kernel lists the devices in and an unchanged system can be told apart
+ * by comparing the raw snapshots, without decoding anything.
+ *
+ * @param  container Devices that were just listed.
+ * @param  diff_path Snapshot to print the changes from or NULL.
+ * @param  save_path Where to save the devices as a snapshot or NULL.
+ * @return           EXIT_UNCHANGED, EXIT_CHANGED or EXIT_TROUBLE.
+ */
+int compare_snapshot(stdev_container *container, const char *diff_path,
+					 const char *save_path) {
+	stdev_container prev;
+	buffer_t cur;
+	buffer_t old;
+	buffer_t buf;
+	int status = EXIT_UNCHANGED;
+
+	// Take the snapshot.
+	device_container_sort(container);
+	buffer_init(&cur);
+	snapshot_encode(container, &cur);
+
+	// Compare it against the old one.
+	buffer_init(&old);
+	if (diff_path != NULL) {
+		if (!snapshot_read(diff_path, &old)) {
+			status = EXIT_TROUBLE;
+		} else if ((old.len != cur.len) ||
+				   (memcmp(old.data, cur.data, cur.len) != 0)) {
+			if (snapshot_decode(&prev, old.data, old.len)) {
+				// Only print what actually changed.
+				device_container_sort(&prev);
+				buffer_init(&buf);
+				if (diff_containers(&prev, container, &buf) > 0)
+					status = EXIT_CHANGED;
+				if (!buffer_write(&buf, STDOUT_FILENO))
+					status = EXIT_TROUBLE;
+
+				buffer_free(&buf);
+			} else {
+				fprintf(stderr, "Invalid snapshot: %s\n", diff_path);
+				status = EXIT_TROUBLE;
+			}
+
+			// Whatever was decoded before it went wrong goes away as well.
+			device_container_free(&prev);
+		}
+	}
+	buffer_free(&old);
+
+	// Replace the old snapshot.
+	if ((save_path != NULL) && (status != EXIT_TROUBLE) &&
+			!snapshot_write(save_path, &cur)) {
+		status = EXIT_TROUBLE;
+	}
+
+	buffer_free(&cur);
+	return status;
+}
+
+#ifdef __linux__
+/**
+ * Prints how the devices are stacked on top of each other.
+ *
+ * @param  container Devices to be shown.
+ * @param  roots     Where the system exposes its devices and mount table.
+ * @return           TRUE if everything was printed.
+ */
+bool print_topology(const stdev_container *container,
+					const device_roots_t *roots) {
+	topology_t topo;
+	buffer_t buf;
+	bool success;
+
+	// Build the graph.
+	if (!topology_build(&topo, container, roots))
+		return false;
+
+	// Print it.
+	buffer_init(&buf);
+	topology_format(&topo, &buf);
+	success = buffer_write(&buf, STDOUT_FILENO);
+
+	// Clean up.
+	buffer_free(&buf);
+	topology_free(&topo);
+	return success;
 }
 
+/**
+ * Keeps printing the activity of the devices until the output goes away.
+ *
+ * @param  container   Devices to be sampled.
+ * @param  sysfs_root  Path to where sysfs is mounted.
+ * @param  interval_ns Time between samples in nanoseconds.
+ * @param  uring       Read the stat files with io_uring.
+ * @return             FALSE if the devices couldn't be sampled.
+ */
+bool print_iostat(const stdev_container *container, const char *sysfs_root,
+				  uint64_t interval_ns, bool uring) {
+	iostat_t io;
+	bool success;
+
+	if (!iostat_open(&io, container, sysfs_root, uring))
+		return false;
+	success = iostat_run(&io, interval_ns, STDOUT_FILENO);
+
+	iostat_close(&io);
+	return success;
+}
+#endif
+
 /**
  * Prints the usage text.
  */
 void usage() {
-	printf("Usage: lssd [-ukh]\n\n");
+	printf("Usage: lssd [-ukrwh] [-j jobs] [-c cache] [--watch-replay file]\n"
+		   "            [--daemon | --client] [--socket path] [--interval secs]\n"
+		   "            [--publish file] [--json | --ndjson]\n"
+		   "            [--include glob] [--exclude glob] [--filter expr]\n"
+		   "            [-o columns] [--debug] [--udev-db dir | --no-udev]\n"
+		   "            [--sysfs-root dir] [--dev-root dir] [--mountinfo file]\n"
+		   "            [--mtab file] [--profile[=table|json]] [--uring]\n"
+		   "            [--topology] [--save-snapshot file] [--diff file]\n"
+		   "            [--iostat secs]\n"
+		   "            [--device name | --uuid uuid | --label label |\n"
+		   "             --mountpoint path]\n\n");
 	printf("Flags:\n");
 	printf("    -u or --ugly    \tPrint like fdisk instead of the tree layout.\n");
 	printf("    -k or --no-blkid\tDon't use blkid to get information. (no root)\n");
+	printf("    -j or --jobs N  \tProbe devices using N threads. (0 for one per device)\n");
+	printf("    -c or --cache F \tProbe cache file. (default: " CACHE_DEF_PATH ", none to disable)\n");
+	printf("    -r or --refresh \tIgnore the probe cache and probe everything again.\n");
+	printf("    -w or --watch   \tKeep printing device changes as they happen.\n");
+	printf("    --watch-replay F\tLike --watch, but replays the events in a file.\n");
+#ifdef __linux__
+	printf("    --daemon        \tKeep the devices in memory and serve them to clients.\n");
+	printf("    --client        \tGet the devices from a running daemon.\n");
+	printf("    --socket F      \tDaemon socket. (default: " DAEMON_DEF_SOCKET ")\n");
+	printf("    --interval N    \tSeconds between full daemon rescans. (0 to disable)\n");
+#endif
+	printf("    --publish F     \tPublish the devices to a memory-mapped file.\n");
+	printf("    --json          \tPrint the devices as a JSON array.\n");
+	printf("    --ndjson        \tPrint one JSON object per device as they're ready.\n");
+	printf("    --include GLOB  \tOnly list devices with matching names.\n");
+	printf("    --exclude GLOB  \tDon't list devices with matching names.\n");
+	printf("    --filter EXPR   \tOnly list devices matching the expression.\n");
+	printf("                    \t(e.g. \"size>1T && !ro && type==xfs\")\n");
+	printf("    -o or --output C\tPrint a table with only these columns. (name,size,\n");
+	printf("                    \tsectors,start,majmin,ro,type,label,uuid,mnt)\n");
+#ifdef __linux__
+	printf("    --udev-db DIR   \tudev database to get the probed information from.\n");
+	printf("                    \t(default: " UDEVDB_DEF_PATH ")\n");
+	printf("    --no-udev       \tDon't use the udev database, always probe.\n");
+	printf("    --device NAME   \tOnly look at a device or partition. (or its file)\n");
+	printf("    --uuid UUID     \tOnly look at the partition with this UUID.\n");
+	printf("    --label LABEL   \tOnly look at the partition with this label.\n");
+	printf("    --mountpoint P  \tOnly look at the partition mounted at P.\n");
+	printf("    --uring         \tRead the sysfs attributes in batches with io_uring.\n");
+	printf("    --topology      \tShow how dm, md, LVM and multipath devices are stacked.\n");
+	printf("    --iostat SECS   \tKeep printing the throughput, latency, queue depth\n");
+	printf("                    \tand utilization of the devices every SECS seconds.\n");
+#endif
+	printf("    --save-snapshot F\tSave the devices to a snapshot file instead of\n");
+	printf("                    \tlisting them.\n");
+	printf("    --diff F        \tOnly print what changed since a snapshot. Exits with\n");
+	printf("                    \t0 if nothing did, 1 if something did and 2 on errors.\n");
+	printf("    --debug         \tReport how much each partition probe read.\n");
+	printf("    --profile[=F]   \tPrint phase timings and counters to stderr as a\n");
+	printf("                    \ttable or as json. (default: table)\n");
+	printf("    --sysfs-root DIR\tWhere sysfs is mounted. (default: " DEVICE_SYSFS_DEF_ROOT ")\n");
+	printf("    --dev-root DIR  \tWhere the device files are. (default: " DEVICE_DEV_DEF_ROOT ")\n");
+	printf("    --mountinfo F   \tMount table with device numbers. (default: " DEVICE_MOUNTINFO_DEF_PATH ")\n");
+	printf("    --mtab F        \tMount table used without mountinfo. (default: " DEVICE_MTAB_DEF_PATH ")\n");
 	printf("    -h or --help    \tShows this message.\n");
 }
 
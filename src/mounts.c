@@ -0,0 +1,473 @@
+/**
+ * mounts.c
+ * Index of the system's mount table keyed by device number.
+ *
+ * The mount table is parsed only once per run, preferably from mountinfo,
+ * which already tells us the device number of each mount, and stored in an
+ * open addressing hash table so that partitions can be matched in constant
+ * time by their major:minor instead of comparing paths.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "mounts.h"
+#include <stdio.h>
+#include <string.h>
+#include <mntent.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include "utils.h"
+
+// Constants.
+#define MOUNT_INDEX_INIT_SIZE 64
+#define MOUNTINFO_LINE_LEN    4096
+
+// Private methods.
+bool mount_index_load_mountinfo(mount_index_t *index, const char *path);
+bool mount_index_load_mtab(mount_index_t *index, const char *path);
+bool mount_find_path_mountinfo(const char *path, const char *mntpoint,
+							   uint32_t *major, uint32_t *minor);
+bool mount_find_path_mtab(const char *path, const char *mntpoint,
+						  uint32_t *major, uint32_t *minor);
+bool mount_block_source(const char *source, uint32_t *major, uint32_t *minor);
+void mount_index_grow(mount_index_t *index);
+mount_dev_t *mount_index_bucket(mount_dev_t *buckets, size_t size,
+								uint32_t major, uint32_t minor);
+char *mountinfo_field(char **cur);
+void mountinfo_unescape(char *str);
+
+/**
+ * Builds the mount table index. Uses mountinfo whenever it's available and
+ * falls back to the classic mtab file otherwise.
+ *
+ * @param  index     Mount index to be populated.
+ * @param  mountinfo Path to the mountinfo file.
+ * @param  mtab      Path to the mtab file.
+ * @return           TRUE if the mount table was read.
+ */
+bool mount_index_load(mount_index_t *index, const char *mountinfo,
+					  const char *mtab) {
+	// Initialize the index.
+	index->size = MOUNT_INDEX_INIT_SIZE;
+	index->count = 0;
+	index->buckets = calloc(index->size, sizeof(mount_dev_t));
+
+	// Read the mount table.
+	if (mount_index_load_mountinfo(index, mountinfo))
+		return true;
+	if (mount_index_load_mtab(index, mtab))
+		return true;
+
+	fprintf(stderr, "Failed to read the %s file.\n", mtab);
+	return false;
+}
+
+/**
+ * Adds a mount to the index.
+ *
+ * @param index    Mount index.
+ * @param major    Major number of the mounted device.
+ * @param minor    Minor number of the mounted device.
+ * @param mntpoint Where the device is mounted.
+ * @param fstype   Filesystem type of the mount.
+ */
+void mount_index_add(mount_index_t *index, uint32_t major, uint32_t minor,
+					 const char *mntpoint, const char *fstype) {
+	mount_dev_t *dev;
+	mount_t *mnt;
+
+	// Keep the load factor under 50%.
+	if (((index->count + 1) * 2) > index->size)
+		mount_index_grow(index);
+
+	// Get the device bucket.
+	dev = mount_index_bucket(index->buckets, index->size, major, minor);
+	if (!dev->used) {
+		dev->used = true;
+		dev->major = major;
+		dev->minor = minor;
+		dev->count = 0;
+		dev->list = NULL;
+		index->count++;
+	}
+
+	// Append the mount.
+	dev->list = realloc(dev->list, sizeof(mount_t) * (dev->count + 1));
+	mnt = &dev->list[dev->count++];
+	mnt->mntpoint = strdup(mntpoint);
+	mnt->fstype = strdup(fstype);
+}
+
+/**
+ * Looks up the mounts of a device.
+ *
+ * @param  index Mount index.
+ * @param  major Major number of the device.
+ * @param  minor Minor number of the device.
+ * @return       Mounts of the device or NULL if it isn't mounted.
+ */
+const mount_dev_t *mount_index_lookup(const mount_index_t *index,
+									  uint32_t major, uint32_t minor) {
+	mount_dev_t *dev;
+
+	dev = mount_index_bucket(index->buckets, index->size, major, minor);
+	return (dev->used) ? dev : NULL;
+}
+
+/**
+ * Finds the device mounted at a given path without indexing the whole mount
+ * table. When multiple devices are mounted on top of each other the last one,
+ * which is the one that's visible, wins.
+ *
+ * @param  mountinfo Path to the mountinfo file.
+ * @param  mtab      Path to the mtab file.
+ * @param  mntpoint  Mount point to look for.
+ * @param  major     Pointer to the major number of the mounted device.
+ * @param  minor     Pointer to the minor number of the mounted device.
+ * @return           TRUE if a block device is mounted at the path.
+ */
+bool mount_find_path(const char *mountinfo, const char *mtab,
+					 const char *mntpoint, uint32_t *major, uint32_t *minor) {
+	// Prefer mountinfo if the system has it.
+	if (access(mountinfo, R_OK) == 0)
+		return mount_find_path_mountinfo(mountinfo, mntpoint, major, minor);
+
+	return mount_find_path_mtab(mtab, mntpoint, major, minor);
+}
+
+/**
+ * Frees the mount index.
+ *
+ * @param index Mount index to be freed.
+ */
+void mount_index_free(mount_index_t *index) {
+	for (size_t i = 0; i < index->size; i++) {
+		mount_dev_t *dev = &index->buckets[i];
+		if (!dev->used)
+			continue;
+
+		for (uint32_t j = 0; j < dev->count; j++) {
+			free(dev->list[j].mntpoint);
+			free(dev->list[j].fstype);
+		}
+		free(dev->list);
+	}
+
+	free(index->buckets);
+	index->buckets = NULL;
+	index->size = 0;
+	index->count = 0;
+}
+
+/**
+ * Reads the mount table from a mountinfo file.
+ *
+ * @param  index Mount index.
+ * @param  path  Path to the mountinfo file.
+ * @return       TRUE if the file was read.
+ */
+bool mount_index_load_mountinfo(mount_index_t *index, const char *path) {
+	char line[MOUNTINFO_LINE_LEN];
+	FILE *fh;
+
+	// Open the mountinfo file.
+	fh = fopen(path, "r");
+	if (fh == NULL)
+		return false;
+
+	// Go through the mounts.
+	while (fgets(line, MOUNTINFO_LINE_LEN, fh) != NULL) {
+		char *cur = line;
+		char *devnum;
+		char *mntpoint;
+		char *fstype;
+		char *source;
+		char *field;
+		uint32_t major;
+		uint32_t minor;
+		struct stat st;
+
+		// Mount ID, parent ID, device number, root and mount point.
+		mountinfo_field(&cur);
+		mountinfo_field(&cur);
+		devnum = mountinfo_field(&cur);
+		mountinfo_field(&cur);
+		mntpoint = mountinfo_field(&cur);
+		if ((mntpoint == NULL) || (parse_dev(devnum, &major, &minor) == NULL))
+			continue;
+
+		// Skip the mount options and optional fields up to the separator.
+		do {
+			field = mountinfo_field(&cur);
+		} while ((field != NULL) && (strcmp(field, "-") != 0));
+
+		// Filesystem type and source.
+		fstype = mountinfo_field(&cur);
+		source = mountinfo_field(&cur);
+		if ((fstype == NULL) || (source == NULL))
+			continue;
+		mountinfo_unescape(mntpoint);
+		mountinfo_unescape(source);
+
+		// Add the mount.
+		mount_index_add(index, major, minor, mntpoint, fstype);
+
+		// Filesystems like btrfs report an anonymous device number, so also
+		// index them under the block device they were mounted from.
+		if ((major == 0) && (source[0] == '/') && (stat(source, &st) == 0) &&
+				S_ISBLK(st.st_mode)) {
+			mount_index_add(index, major(st.st_rdev), minor(st.st_rdev),
+							mntpoint, fstype);
+		}
+	}
+
+	// Clean up.
+	fclose(fh);
+	return true;
+}
+
+/**
+ * Reads the mount table from a mtab file. Since mtab doesn't contain device
+ * numbers, every real device gets looked up.
+ *
+ * @param  index Mount index.
+ * @param  path  Path to the mtab file.
+ * @return       TRUE if the file was read.
+ */
+bool mount_index_load_mtab(mount_index_t *index, const char *path) {
+	FILE *fp;
+	struct mntent *fs;
+	struct stat st;
+
+	// Open the mount point file.
+	fp = setmntent(path, "r");
+	if (fp == NULL)
+		return false;
+
+	// Loop through the mount points in the system.
+	while ((fs = getmntent(fp)) != NULL) {
+		// Check if it's a real device.
+		if ((fs->mnt_fsname[0] != '/') || (stat(fs->mnt_fsname, &st) != 0) ||
+				!S_ISBLK(st.st_mode)) {
+			continue;
+		}
+
+		mount_index_add(index, major(st.st_rdev), minor(st.st_rdev),
+						fs->mnt_dir, fs->mnt_type);
+	}
+
+	// Clean up.
+	endmntent(fp);
+	return true;
+}
+
+/**
+ * Finds the device mounted at a given path in a mountinfo file.
+ *
+ * @param  path     Path to the mountinfo file.
+ * @param  mntpoint Mount point to look for.
+ * @param  major    Pointer to the major number of the mounted device.
+ * @param  minor    Pointer to the minor number of the mounted device.
+ * @return          TRUE if a block device is mounted at the path.
+ */
+bool mount_find_path_mountinfo(const char *path, const char *mntpoint,
+							   uint32_t *major, uint32_t *minor) {
+	char line[MOUNTINFO_LINE_LEN];
+	bool found = false;
+	FILE *fh;
+
+	// Open the mountinfo file.
+	fh = fopen(path, "r");
+	if (fh == NULL)
+		return false;
+
+	// Go through the mounts.
+	while (fgets(line, MOUNTINFO_LINE_LEN, fh) != NULL) {
+		char *cur = line;
+		char *devnum;
+		char *mnt;
+		char *field;
+		char *source;
+		uint32_t maj;
+		uint32_t min;
+
+		// Mount ID, parent ID, device number, root and mount point.
+		mountinfo_field(&cur);
+		mountinfo_field(&cur);
+		devnum = mountinfo_field(&cur);
+		mountinfo_field(&cur);
+		mnt = mountinfo_field(&cur);
+		if ((mnt == NULL) || (parse_dev(devnum, &maj, &min) == NULL))
+			continue;
+		mountinfo_unescape(mnt);
+		if (strcmp(mnt, mntpoint) != 0)
+			continue;
+
+		// Anonymous device numbers need to be resolved through the source.
+		if (maj == 0) {
+			do {
+				field = mountinfo_field(&cur);
+			} while ((field != NULL) && (strcmp(field, "-") != 0));
+			mountinfo_field(&cur);
+			source = mountinfo_field(&cur);
+			if (source == NULL)
+				continue;
+			mountinfo_unescape(source);
+
+			found = mount_block_source(source, major, minor);
+			continue;
+		}
+
+		*major = maj;
+		*minor = min;
+		found = true;
+	}
+
+	// Clean up.
+	fclose(fh);
+	return found;
+}
+
+/**
+ * Finds the device mounted at a given path in a mtab file.
+ *
+ * @param  path     Path to the mtab file.
+ * @param  mntpoint Mount point to look for.
+ * @param  major    Pointer to the major number of the mounted device.
+ * @param  minor    Pointer to the minor number of the mounted device.
+ * @return          TRUE if a block device is mounted at the path.
+ */
+bool mount_find_path_mtab(const char *path, const char *mntpoint,
+						  uint32_t *major, uint32_t *minor) {
+	bool found = false;
+	struct mntent *fs;
+	FILE *fp;
+
+	// Open the mount point file.
+	fp = setmntent(path, "r");
+	if (fp == NULL)
+		return false;
+
+	// Loop through the mount points in the system.
+	while ((fs = getmntent(fp)) != NULL) {
+		if (strcmp(fs->mnt_dir, mntpoint) == 0)
+			found = mount_block_source(fs->mnt_fsname, major, minor);
+	}
+
+	// Clean up.
+	endmntent(fp);
+	return found;
+}
+
+/**
+ * Gets the device number of the block device a filesystem was mounted from.
+ *
+ * @param  source Mount source.
+ * @param  major  Pointer to the major number of the device.
+ * @param  minor  Pointer to the minor number of the device.
+ * @return        TRUE if the source is a block device.
+ */
+bool mount_block_source(const char *source, uint32_t *major, uint32_t *minor) {
+	struct stat st;
+
+	if ((source[0] != '/') || (stat(source, &st) != 0) || !S_ISBLK(st.st_mode))
+		return false;
+
+	*major = major(st.st_rdev);
+	*minor = minor(st.st_rdev);
+	return true;
+}
+
+/**
+ * Doubles the size of the hash table.
+ *
+ * @param index Mount index.
+ */
+void mount_index_grow(mount_index_t *index) {
+	size_t size = index->size * 2;
+	mount_dev_t *buckets = calloc(size, sizeof(mount_dev_t));
+
+	// Rehash everything.
+	for (size_t i = 0; i < index->size; i++) {
+		mount_dev_t *dev = &index->buckets[i];
+		if (dev->used)
+			*mount_index_bucket(buckets, size, dev->major, dev->minor) = *dev;
+	}
+
+	free(index->buckets);
+	index->buckets = buckets;
+	index->size = size;
+}
+
+/**
+ * Finds the bucket of a device using linear probing.
+ *
+ * @param  buckets Hash table buckets.
+ * @param  size    Number of buckets. (power of two)
+ * @param  major   Major number of the device.
+ * @param  minor   Minor number of the device.
+ * @return         Bucket of the device or the empty one where it should go.
+ */
+mount_dev_t *mount_index_bucket(mount_dev_t *buckets, size_t size,
+								uint32_t major, uint32_t minor) {
+	uint64_t key = ((uint64_t)major << 32) | minor;
+	size_t idx = (key * 0x9E3779B97F4A7C15ULL) >> 32;
+
+	for (;;) {
+		mount_dev_t *dev = &buckets[idx & (size - 1)];
+		if (!dev->used || ((dev->major == major) && (dev->minor == minor)))
+			return dev;
+
+		idx++;
+	}
+}
+
+/**
+ * Splits the next space-separated field out of a mountinfo line.
+ *
+ * @param  cur Pointer to the current position in the line.
+ * @return     The field or NULL if the line ended.
+ */
+char *mountinfo_field(char **cur) {
+	char *field;
+
+	// Skip the separators.
+	while ((**cur == ' ') || (**cur == '\n'))
+		(*cur)++;
+	if (**cur == '\0')
+		return NULL;
+
+	// Find the end of the field.
+	field = *cur;
+	while ((**cur != ' ') && (**cur != '\n') && (**cur != '\0'))
+		(*cur)++;
+	if (**cur != '\0')
+		*(*cur)++ = '\0';
+
+	return field;
+}
+
+/**
+ * Decodes the octal escapes (like \040 for spaces) used in mountinfo fields.
+ *
+ * @param str String to be decoded in place.
+ */
+void mountinfo_unescape(char *str) {
+	char *out = str;
+
+	while (*str != '\0') {
+		if ((str[0] == '\\') && (str[1] >= '0') && (str[1] <= '3') &&
+				(str[2] >= '0') && (str[2] <= '7') &&
+				(str[3] >= '0') && (str[3] <= '7')) {
+			*out++ = ((str[1] - '0') << 6) | ((str[2] - '0') << 3) |
+				(str[3] - '0');
+			str += 4;
+		} else {
+			*out++ = *str++;
+		}
+	}
+
+	*out = '\0';
+}
@@ -0,0 +1,52 @@
+/**
+ * mounts.h
+ * Index of the system's mount table keyed by device number.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _MOUNTS_H
+#define _MOUNTS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Single mount of a device.
+typedef struct {
+	char *mntpoint;
+	char *fstype;
+} mount_t;
+
+// Every mount of a single device.
+typedef struct {
+	bool      used;
+	uint32_t  major;
+	uint32_t  minor;
+	uint32_t  count;
+	mount_t  *list;
+} mount_dev_t;
+
+// Hash index of mounted devices.
+typedef struct {
+	size_t       size;
+	size_t       count;
+	mount_dev_t *buckets;
+} mount_index_t;
+
+// Building.
+bool mount_index_load(mount_index_t *index, const char *mountinfo,
+					  const char *mtab);
+void mount_index_add(mount_index_t *index, uint32_t major, uint32_t minor,
+					 const char *mntpoint, const char *fstype);
+
+// Lookup.
+const mount_dev_t *mount_index_lookup(const mount_index_t *index,
+									  uint32_t major, uint32_t minor);
+bool mount_find_path(const char *mountinfo, const char *mtab,
+					 const char *mntpoint, uint32_t *major, uint32_t *minor);
+
+// Clean up.
+void mount_index_free(mount_index_t *index);
+
+#endif  //_MOUNTS_H
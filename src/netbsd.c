@@ -14,6 +14,7 @@
 #include <sys/stat.h>
 #include <sys/param.h>
 #include <sys/sysctl.h>
+#include "filter.h"
 
 // Constants.
 #define SYSFS_BLOCKDEVS_PATH "/sys/block/"
@@ -27,14 +28,21 @@ bool sysctl_device_list(stdev_container *devlist);
  * Populates a storage device container.
  *
  * @param  container Storage device structure container.
- * @param  useblkid  Use blkid for probing? (requires root)
+ * @param  opts      Population options.
  * @return           TRUE if everything went fine.
  */
-bool populate_devices(stdev_container *container, const bool useblkid) {
+bool populate_devices(stdev_container *container, const populate_opts_t *opts) {
 	// Get a device list using sysctl.
 	if (!sysctl_device_list(container))
 		return false;
 
+	// There's no probing, so everything is ready already.
+	filter_container(opts->filter, container);
+	if (opts->on_ready != NULL) {
+		for (uint32_t i = 0; i < container->count; i++)
+			opts->on_ready(container, &container->list[i], opts->ready_arg);
+	}
+
 	return true;
 }
 
@@ -49,7 +57,7 @@ bool sysctl_device_list(stdev_container *devlist) {
 	size_t len;
 
 	// Initialize the container.
-	devlist->count = 0;
+	device_container_init(devlist);
 
 	// Get block devices.
 	mib[0] = CTL_HW;
@@ -71,7 +79,8 @@ bool sysctl_device_list(stdev_container *devlist) {
 
 			// Get device information.
 			stdev_t sd;
-			strncpy(sd.name, sd_name, PARTITION_NAME_MAX_LEN);
+			memset(&sd, 0, sizeof(stdev_t));
+			sd.name = strpool_intern(&devlist->strings, sd_name);
 			//sysfs_device_info(&sd);
 
 			/*
@@ -84,7 +93,7 @@ bool sysctl_device_list(stdev_container *devlist) {
 			*/
 
 			// Add the storage device to the list.
-			device_list_push(devlist, sd);
+			device_list_push(devlist, &sd);
 		} else {
 			// Increment the character counter for the next character.
 			ci++;
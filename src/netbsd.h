@@ -13,7 +13,7 @@
 #include <stdlib.h>
 #include "device.h"
 
-bool populate_devices(stdev_container *container, const bool useblkid);
+bool populate_devices(stdev_container *container, const populate_opts_t *opts);
 
 #endif  //_NETBSD_H
 
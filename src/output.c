@@ -0,0 +1,216 @@
+/**
+ * output.c
+ * Prints the storage devices in one of the supported formats.
+ *
+ * The human readable layouts are rendered into a single buffer that gets
+ * written out in one go at the end. The table one keeps its cells around
+ * until then, since the width of the columns depends on all of them. The JSON
+ * ones are meant for pipelines, so each device is written out as soon as it's
+ * handed to us, which lets a consumer get going while the slower devices are
+ * still being probed.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "output.h"
+#include <string.h>
+#include "json.h"
+
+// Private methods.
+void output_flush(output_t *out);
+void output_table_row(output_t *out, const stdev_container *container,
+					  const stdev_t *sd, const partition_t *part);
+void output_table_render(output_t *out);
+uint32_t output_text_width(const char *str, size_t len);
+
+/**
+ * Initializes an output stream.
+ *
+ * @param out     Output stream to be initialized.
+ * @param format  Format of the output.
+ * @param columns Columns to be shown in the table and JSON formats. (must
+ *                outlive the stream)
+ * @param fd      File descriptor to write to.
+ */
+void output_init(output_t *out, output_format_t format,
+				 const columns_t *columns, int fd) {
+	out->format = format;
+	out->columns = columns;
+	out->fd = fd;
+	out->rows = 0;
+	out->count = 0;
+	out->ok = true;
+	buffer_init(&out->buf);
+	buffer_init(&out->cells);
+
+	// Columns are at least as wide as their headers.
+	for (uint32_t i = 0; i < columns->count; i++) {
+		const char *header = columns_header(columns->list[i]);
+		out->widths[i] = output_text_width(header, strlen(header));
+	}
+}
+
+/**
+ * Checks if the devices are written out as soon as they're ready.
+ *
+ * @param  out Output stream.
+ * @return     TRUE if each device should be handed over as soon as possible.
+ */
+bool output_streams(const output_t *out) {
+	return (out->format == OUTPUT_JSON) || (out->format == OUTPUT_NDJSON);
+}
+
+/**
+ * Outputs a single device. Has the same signature as a device ready callback
+ * so that it can be handed straight to the population options.
+ *
+ * @param container Storage device container.
+ * @param sd        Storage device.
+ * @param arg       Output stream.
+ */
+void output_device(const stdev_container *container, const stdev_t *sd,
+				   void *arg) {
+	output_t *out = (output_t *)arg;
+
+	switch (out->format) {
+	case OUTPUT_TREE:
+	case OUTPUT_UGLY:
+		device_format_info(container, sd, out->format == OUTPUT_TREE,
+						   &out->buf);
+		break;
+	case OUTPUT_JSON:
+		buffer_append_str(&out->buf, (out->count == 0) ? "[\n" : ",\n");
+		json_format_device(container, sd, out->columns, &out->buf);
+		output_flush(out);
+		break;
+	case OUTPUT_NDJSON:
+		json_format_device(container, sd, out->columns, &out->buf);
+		buffer_append_char(&out->buf, '\n');
+		output_flush(out);
+		break;
+	case OUTPUT_TABLE:
+		output_table_row(out, container, sd, NULL);
+		for (uint32_t i = 0; i < sd->partitions.count; i++)
+			output_table_row(out, container, sd, &sd->partitions.list[i]);
+		break;
+	}
+
+	out->count++;
+}
+
+/**
+ * Writes out whatever is left and frees the output stream.
+ *
+ * @param  out Output stream.
+ * @return     TRUE if everything was written successfully.
+ */
+bool output_finish(output_t *out) {
+	// Close the array or lay out the table.
+	if (out->format == OUTPUT_JSON)
+		buffer_append_str(&out->buf, (out->count == 0) ? "[]\n" : "\n]\n");
+	if (out->format == OUTPUT_TABLE)
+		output_table_render(out);
+
+	output_flush(out);
+	buffer_free(&out->buf);
+	buffer_free(&out->cells);
+
+	return out->ok;
+}
+
+/**
+ * Writes out the buffered output.
+ *
+ * @param out Output stream.
+ */
+void output_flush(output_t *out) {
+	if (out->buf.len == 0)
+		return;
+
+	if (!buffer_write(&out->buf, out->fd))
+		out->ok = false;
+	buffer_clear(&out->buf);
+}
+
+/**
+ * Renders the cells of a table row, keeping track of the column widths.
+ *
+ * @param out       Output stream.
+ * @param container Storage device container.
+ * @param sd        Storage device.
+ * @param part      Partition or NULL for the device row.
+ */
+void output_table_row(output_t *out, const stdev_container *container,
+					  const stdev_t *sd, const partition_t *part) {
+	for (uint32_t i = 0; i < out->columns->count; i++) {
+		size_t start = out->cells.len;
+		uint32_t width;
+
+		// Render the cell and terminate it.
+		columns_format_cell(container, sd, part, out->columns->list[i],
+							&out->cells);
+		width = output_text_width((const char *)out->cells.data + start,
+								  out->cells.len - start);
+		buffer_append_char(&out->cells, '\0');
+
+		if (width > out->widths[i])
+			out->widths[i] = width;
+	}
+
+	out->rows++;
+}
+
+/**
+ * Lays out the header and all the rendered cells of the table.
+ *
+ * @param out Output stream.
+ */
+void output_table_render(output_t *out) {
+	const columns_t *cols = out->columns;
+	const char *cell = (const char *)out->cells.data;
+
+	for (uint32_t row = 0; row <= out->rows; row++) {
+		for (uint32_t i = 0; i < cols->count; i++) {
+			const char *text;
+			size_t len;
+
+			// Header first and then the cells in order.
+			if (row == 0) {
+				text = columns_header(cols->list[i]);
+			} else {
+				text = cell;
+				cell += strlen(cell) + 1;
+			}
+			len = strlen(text);
+			buffer_append(&out->buf, text, len);
+
+			// Pad everything but the last column.
+			if (i < (cols->count - 1)) {
+				for (uint32_t w = output_text_width(text, len);
+						w <= out->widths[i]; w++) {
+					buffer_append_char(&out->buf, ' ');
+				}
+			}
+		}
+
+		buffer_append_char(&out->buf, '\n');
+	}
+}
+
+/**
+ * Gets the width of a text in characters, assuming it's UTF-8.
+ *
+ * @param  str Text.
+ * @param  len Length of the text in bytes.
+ * @return     Number of characters in the text.
+ */
+uint32_t output_text_width(const char *str, size_t len) {
+	uint32_t width = 0;
+
+	for (size_t i = 0; i < len; i++) {
+		if ((str[i] & 0xC0) != 0x80)
+			width++;
+	}
+
+	return width;
+}
@@ -0,0 +1,48 @@
+/**
+ * output.h
+ * Prints the storage devices in one of the supported formats.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _OUTPUT_H
+#define _OUTPUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "device.h"
+#include "buffer.h"
+#include "columns.h"
+
+// Output formats.
+typedef enum {
+	OUTPUT_TREE,
+	OUTPUT_UGLY,
+	OUTPUT_JSON,
+	OUTPUT_NDJSON,
+	OUTPUT_TABLE
+} output_format_t;
+
+// Output stream.
+typedef struct {
+	output_format_t  format;
+	const columns_t *columns;
+	int              fd;
+	buffer_t         buf;
+	buffer_t         cells;
+	uint32_t         widths[COLUMNS_MAX];
+	uint32_t         rows;
+	uint32_t         count;
+	bool             ok;
+} output_t;
+
+// Streaming.
+void output_init(output_t *out, output_format_t format,
+				 const columns_t *columns, int fd);
+bool output_streams(const output_t *out);
+void output_device(const stdev_container *container, const stdev_t *sd,
+				   void *arg);
+bool output_finish(output_t *out);
+
+#endif  //_OUTPUT_H
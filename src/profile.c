@@ -0,0 +1,404 @@
+/**
+ * profile.c
+ * Timing and resource counters for the phases of gathering the devices.
+ *
+ * Phases are timed by whoever runs them, which only costs a pointer check
+ * when profiling is off. Bytes and read calls come from the kernel's I/O
+ * accounting of the process, so they include everything blkid reads, and
+ * heap allocations are counted by wrapping the C library allocator, which
+ * only starts counting once a profile is started.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "profile.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include "buffer.h"
+#include "utils.h"
+
+// Constants.
+#define PROC_SELF_IO_PATH "/proc/self/io"
+#define PROC_IO_BUF_LEN   512
+
+// Sanitizers replace the allocator with their own. GCC tells us about it
+// directly, clang has to be asked.
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define PROFILE_SANITIZED
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer) || \
+	__has_feature(memory_sanitizer)
+#define PROFILE_SANITIZED
+#endif
+#endif
+
+// Only wrap the allocator where we know how to reach the real one, not when a
+// sanitizer already replaced it with its own and never inside the library,
+// where it would replace the allocator of whatever program links against it.
+#if defined(__GLIBC__) && !defined(PROFILE_SANITIZED) && \
+	!defined(LSSD_LIBRARY)
+#define PROFILE_WRAP_ALLOC
+#endif
+
+// Names of the phases in the reports.
+static const char *phase_names[PROFILE_PHASE_COUNT][2] = {
+	{ "populate",   "populate (total)" },
+	{ "mounts",     "  mount table" },
+	{ "readdir",    "  block readdir" },
+	{ "device",     "  device attributes" },
+	{ "partitions", "  partition listing" },
+	{ "partinfo",   "  partition attributes" },
+	{ "mountmatch", "  mount matching" },
+	{ "blkid",      "  blkid (total)" },
+	{ "lookup",     "    cache and udev" },
+	{ "probe",      "    probes" },
+	{ "output",     "output" }
+};
+
+#ifdef PROFILE_WRAP_ALLOC
+// Heap allocation counting.
+static atomic_bool profile_counting = false;
+static atomic_uint_fast64_t profile_allocs = 0;
+#endif
+
+// Private methods.
+bool profile_proc_io(int64_t *rchar, int64_t *syscr, size_t *len);
+void profile_append_int(buffer_t *buf, int64_t num);
+void profile_append_ms(buffer_t *buf, uint64_t ns, int width);
+
+/**
+ * Starts profiling, clearing any previous statistics.
+ *
+ * @param prof Profile to be started.
+ */
+void profile_start(profile_t *prof) {
+	size_t len;
+
+	memset(prof, 0, sizeof(profile_t));
+
+	// Take the starting point of the process-wide counters, which doesn't
+	// include the read we've just done to get it.
+	if (profile_proc_io(&prof->rchar, &prof->syscr, &len)) {
+		prof->rchar += len;
+		prof->syscr++;
+	} else {
+		prof->rchar = -1;
+		prof->syscr = -1;
+	}
+#ifdef PROFILE_WRAP_ALLOC
+	prof->allocs = atomic_load(&profile_allocs);
+	atomic_store(&profile_counting, true);
+#else
+	prof->allocs = -1;
+#endif
+}
+
+/**
+ * Stops profiling, turning the process-wide counters into how much they
+ * changed since the profile was started.
+ *
+ * @param prof Profile to be stopped.
+ */
+void profile_stop(profile_t *prof) {
+	int64_t rchar;
+	int64_t syscr;
+
+#ifdef PROFILE_WRAP_ALLOC
+	atomic_store(&profile_counting, false);
+	prof->allocs = atomic_load(&profile_allocs) - prof->allocs;
+#endif
+
+	// Bytes read by the process in the meantime.
+	if ((prof->rchar >= 0) && profile_proc_io(&rchar, &syscr, NULL)) {
+		prof->rchar = rchar - prof->rchar;
+		prof->syscr = syscr - prof->syscr;
+	} else {
+		prof->rchar = -1;
+		prof->syscr = -1;
+	}
+}
+
+/**
+ * Gets the time a phase is starting at.
+ *
+ * @param  prof Profile or NULL if profiling is off.
+ * @return      Current monotonic time in nanoseconds or 0 if profiling is off.
+ */
+uint64_t profile_now(const profile_t *prof) {
+	struct timespec ts;
+
+	if (prof == NULL)
+		return 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+/**
+ * Records a run of a phase that has just finished. Safe to call from
+ * multiple threads.
+ *
+ * @param prof  Profile or NULL if profiling is off.
+ * @param phase Phase that has finished.
+ * @param start Time the phase started at. (from profile_now)
+ */
+void profile_add(profile_t *prof, profile_phase_t phase, uint64_t start) {
+	profile_stat_t *stat;
+	uint64_t elapsed;
+	uint64_t max;
+
+	if (prof == NULL)
+		return;
+
+	// Accumulate.
+	stat = &prof->phases[phase];
+	elapsed = profile_now(prof) - start;
+	atomic_fetch_add_explicit(&stat->calls, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&stat->ns, elapsed, memory_order_relaxed);
+
+	// Keep the slowest run.
+	max = atomic_load_explicit(&stat->max, memory_order_relaxed);
+	while ((elapsed > max) &&
+			!atomic_compare_exchange_weak_explicit(&stat->max, &max, elapsed,
+												   memory_order_relaxed,
+												   memory_order_relaxed)) {
+	}
+}
+
+/**
+ * Records files that were opened.
+ *
+ * @param prof  Profile or NULL if profiling is off.
+ * @param count Number of files that were opened.
+ */
+void profile_count_opens(profile_t *prof, uint64_t count) {
+	if (prof == NULL)
+		return;
+
+	atomic_fetch_add_explicit(&prof->opens, count, memory_order_relaxed);
+}
+
+/**
+ * Prints a profile as a table or as a JSON object.
+ *
+ * @param  prof Profile that was stopped.
+ * @param  json Print it as JSON?
+ * @param  fd   File descriptor to write to.
+ * @return      TRUE if everything was written.
+ */
+bool profile_print(const profile_t *prof, bool json, int fd) {
+	buffer_t buf;
+	bool success;
+
+	buffer_init(&buf);
+	if (json) {
+		buffer_append_str(&buf, "{\"phases\":{");
+		for (int i = 0; i < PROFILE_PHASE_COUNT; i++) {
+			const profile_stat_t *stat = &prof->phases[i];
+
+			if (i > 0)
+				buffer_append_char(&buf, ',');
+			buffer_append_char(&buf, '"');
+			buffer_append_str(&buf, phase_names[i][0]);
+			buffer_append_str(&buf, "\":{\"calls\":");
+			buffer_append_uint(&buf, atomic_load(&stat->calls));
+			buffer_append_str(&buf, ",\"ns\":");
+			buffer_append_uint(&buf, atomic_load(&stat->ns));
+			buffer_append_str(&buf, ",\"max_ns\":");
+			buffer_append_uint(&buf, atomic_load(&stat->max));
+			buffer_append_char(&buf, '}');
+		}
+		buffer_append_str(&buf, "},\"files_opened\":");
+		buffer_append_uint(&buf, atomic_load(&prof->opens));
+		buffer_append_str(&buf, ",\"bytes_read\":");
+		profile_append_int(&buf, prof->rchar);
+		buffer_append_str(&buf, ",\"read_calls\":");
+		profile_append_int(&buf, prof->syscr);
+		buffer_append_str(&buf, ",\"allocations\":");
+		profile_append_int(&buf, prof->allocs);
+		buffer_append_str(&buf, "}\n");
+	} else {
+		char line[128];
+
+		buffer_append_str(&buf, "PHASE                     CALLS   TOTAL (ms)"
+						  "     AVG (ms)     MAX (ms)\n");
+		for (int i = 0; i < PROFILE_PHASE_COUNT; i++) {
+			const profile_stat_t *stat = &prof->phases[i];
+			uint64_t calls = atomic_load(&stat->calls);
+
+			snprintf(line, sizeof(line), "%-22s %8" PRIu64, phase_names[i][1],
+					 calls);
+			buffer_append_str(&buf, line);
+			profile_append_ms(&buf, atomic_load(&stat->ns), 13);
+			profile_append_ms(&buf, (calls > 0) ?
+							  (atomic_load(&stat->ns) / calls) : 0, 13);
+			profile_append_ms(&buf, atomic_load(&stat->max), 13);
+			buffer_append_char(&buf, '\n');
+		}
+
+		buffer_append_str(&buf, "\nFiles opened:     ");
+		buffer_append_uint(&buf, atomic_load(&prof->opens));
+		buffer_append_str(&buf, "\nBytes read:       ");
+		profile_append_int(&buf, prof->rchar);
+		buffer_append_str(&buf, "\nRead calls:       ");
+		profile_append_int(&buf, prof->syscr);
+		buffer_append_str(&buf, "\nHeap allocations: ");
+		profile_append_int(&buf, prof->allocs);
+		buffer_append_char(&buf, '\n');
+	}
+
+	success = buffer_write(&buf, fd);
+	buffer_free(&buf);
+	return success;
+}
+
+/**
+ * Reads the I/O accounting of the process. The numbers are from before the
+ * read that got them.
+ *
+ * @param  rchar Pointer to the number of bytes read by the process.
+ * @param  syscr Pointer to the number of read calls made by the process.
+ * @param  len   Optional pointer to store how many bytes reading this took.
+ * @return       TRUE if the kernel told us.
+ */
+bool profile_proc_io(int64_t *rchar, int64_t *syscr, size_t *len) {
+	char buf[PROC_IO_BUF_LEN];
+	const char *field;
+	size_t num;
+	ssize_t bytes;
+	int fd;
+
+	// Read the I/O statistics of the process.
+	fd = open(PROC_SELF_IO_PATH, O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return false;
+	bytes = read(fd, buf, PROC_IO_BUF_LEN - 1);
+	close(fd);
+	if (bytes < 0)
+		return false;
+	buf[bytes] = '\0';
+	if (len != NULL)
+		*len = bytes;
+
+	// Get the number of characters read.
+	field = strstr(buf, "rchar: ");
+	if ((field == NULL) || (parse_num(field + 7, &num) == NULL))
+		return false;
+	*rchar = num;
+
+	// Get the number of read calls.
+	field = strstr(buf, "syscr: ");
+	if ((field == NULL) || (parse_num(field + 7, &num) == NULL))
+		return false;
+	*syscr = num;
+
+	return true;
+}
+
+/**
+ * Appends a counter that might not be available to a buffer.
+ *
+ * @param buf Buffer to append to.
+ * @param num Counter value or a negative number if it's not available.
+ */
+void profile_append_int(buffer_t *buf, int64_t num) {
+	if (num < 0) {
+		buffer_append_str(buf, "null");
+		return;
+	}
+
+	buffer_append_uint(buf, num);
+}
+
+/**
+ * Appends a right-aligned time in milliseconds to a buffer.
+ *
+ * @param buf   Buffer to append to.
+ * @param ns    Time in nanoseconds.
+ * @param width Width of the field.
+ */
+void profile_append_ms(buffer_t *buf, uint64_t ns, int width) {
+	char str[32];
+
+	snprintf(str, sizeof(str), "%*.3f", width, ns / 1000000.0);
+	buffer_append_str(buf, str);
+}
+
+#ifdef PROFILE_WRAP_ALLOC
+// The C library's own allocator.
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+// Counts an allocation if we are profiling. The wrappers below replace the
+// allocator for the whole process, including the libraries we use.
+#define PROFILE_COUNT_ALLOC() \
+	if (atomic_load_explicit(&profile_counting, memory_order_relaxed)) \
+		atomic_fetch_add_explicit(&profile_allocs, 1, memory_order_relaxed)
+
+void *malloc(size_t size) {
+	PROFILE_COUNT_ALLOC();
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+	PROFILE_COUNT_ALLOC();
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+	PROFILE_COUNT_ALLOC();
+	return __libc_realloc(ptr, size);
+}
+
+void *reallocarray(void *ptr, size_t nmemb, size_t size) {
+	if ((nmemb > 0) && (size > (SIZE_MAX / nmemb))) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	PROFILE_COUNT_ALLOC();
+	return __libc_realloc(ptr, nmemb * size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+	PROFILE_COUNT_ALLOC();
+	return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+	if ((alignment == 0) || (alignment & (alignment - 1))) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	PROFILE_COUNT_ALLOC();
+	return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size) {
+	void *ptr;
+
+	if ((alignment < sizeof(void *)) || (alignment & (alignment - 1)))
+		return EINVAL;
+
+	PROFILE_COUNT_ALLOC();
+	ptr = __libc_memalign(alignment, size);
+	if (ptr == NULL)
+		return ENOMEM;
+
+	*memptr = ptr;
+	return 0;
+}
+
+void free(void *ptr) {
+	__libc_free(ptr);
+}
+#endif
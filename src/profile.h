@@ -0,0 +1,61 @@
+/**
+ * profile.h
+ * Timing and resource counters for the phases of gathering the devices.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _PROFILE_H
+#define _PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+// Phases that are timed.
+typedef enum {
+	PROFILE_POPULATE,    // Everything it took to gather the devices.
+	PROFILE_MOUNTS,      // Indexing the mount table.
+	PROFILE_READDIR,     // Listing the block devices.
+	PROFILE_DEVICE,      // Reading the attributes of a device.
+	PROFILE_PARTITIONS,  // Listing the partitions of a device.
+	PROFILE_PARTINFO,    // Reading the attributes of a device's partitions.
+	PROFILE_MOUNTMATCH,  // Matching the partitions of a device to mounts.
+	PROFILE_BLKID,       // Getting the probed information of every partition.
+	PROFILE_LOOKUP,      // Looking a partition up in the cache and udev.
+	PROFILE_PROBE,       // Probing a single partition.
+	PROFILE_OUTPUT,      // Printing the devices that weren't streamed.
+	PROFILE_PHASE_COUNT
+} profile_phase_t;
+
+// Statistics of a single phase. Updated from the probing threads as well.
+typedef struct {
+	_Atomic uint64_t calls;
+	_Atomic uint64_t ns;
+	_Atomic uint64_t max;
+} profile_stat_t;
+
+// Profile of a run.
+struct profile_s {
+	profile_stat_t   phases[PROFILE_PHASE_COUNT];
+	_Atomic uint64_t opens;
+
+	// Process-wide counters. (negative if not available)
+	int64_t allocs;
+	int64_t rchar;
+	int64_t syscr;
+};
+typedef struct profile_s profile_t;
+
+// Recording.
+void profile_start(profile_t *prof);
+void profile_stop(profile_t *prof);
+uint64_t profile_now(const profile_t *prof);
+void profile_add(profile_t *prof, profile_phase_t phase, uint64_t start);
+void profile_count_opens(profile_t *prof, uint64_t count);
+
+// Reporting.
+bool profile_print(const profile_t *prof, bool json, int fd);
+
+#endif  //_PROFILE_H
@@ -0,0 +1,418 @@
+/**
+ * shm.c
+ * Publishes device snapshots in a memory-mapped file that any number of
+ * reader processes can read from without syscalls or locks.
+ *
+ * The file starts with a fixed size header which is followed by two slots of
+ * the same size, each with its own sequence counter and a snapshot in the
+ * same format the daemon sends over its socket. The publisher always writes
+ * to the slot readers aren't pointed at, bumping the slot's counter to an odd
+ * number while it's at it, and then flips the active slot. Readers copy the
+ * active slot and only accept the copy if its counter was even and didn't
+ * change while they were at it, which only happens if the publisher lapped
+ * them twice.
+ *
+ * Whenever a snapshot outgrows the slots a bigger file is put in place of the
+ * old one, which gets flagged as stale so that readers know to map the new
+ * one.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "shm.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+
+// Memory-mapped file header.
+struct shm_header_s {
+	char             magic[8];
+	uint32_t         version;
+	uint32_t         header_size;
+	uint64_t         slot_size;
+	_Atomic uint32_t stale;
+	_Atomic uint32_t active;
+	_Atomic uint64_t generation;
+	uint8_t          reserved[24];
+};
+
+// Slot header. Followed by the snapshot itself.
+typedef struct {
+	_Atomic uint64_t seq;
+	uint64_t         len;
+} shm_slot_t;
+
+// Private methods.
+bool shm_create(shm_publisher_t *pub, size_t slot_size);
+shm_slot_t *shm_slot(const shm_header_t *header, uint32_t idx);
+bool shm_map(shm_reader_t *reader);
+void shm_unmap(shm_reader_t *reader);
+
+/**
+ * Starts publishing snapshots to a file.
+ *
+ * @param  pub  Publisher to be initialized.
+ * @param  path Path to the memory-mapped file.
+ * @return      TRUE if the file is ready to be published to.
+ */
+bool shm_publisher_open(shm_publisher_t *pub, const char *path) {
+	int fd;
+
+	// Initialize the publisher.
+	pub->fd = -1;
+	pub->header = NULL;
+	pub->size = 0;
+	buffer_init(&pub->buf);
+	if (strlen(path) >= PATH_MAX) {
+		fprintf(stderr, "Publish path is too long: %s\n", path);
+		return false;
+	}
+	strcpy(pub->path, path);
+
+	// Make sure no one else is publishing to this file.
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd != -1) {
+		bool busy = flock(fd, LOCK_SH | LOCK_NB) == -1;
+
+		close(fd);
+		if (busy) {
+			fprintf(stderr, "Someone else is already publishing to %s.\n",
+					path);
+			return false;
+		}
+	}
+
+	return shm_create(pub, SHM_SLOT_MIN);
+}
+
+/**
+ * Publishes the current state of a container.
+ *
+ * @param  pub       Publisher.
+ * @param  container Storage device container.
+ * @return           TRUE if the snapshot was published.
+ */
+bool shm_publish(shm_publisher_t *pub, const stdev_container *container) {
+	shm_slot_t *slot;
+	uint64_t seq;
+	uint32_t idx;
+
+	// Encode the snapshot.
+	buffer_clear(&pub->buf);
+	snapshot_encode(container, &pub->buf);
+
+	// Move to a bigger file if it doesn't fit anymore.
+	if ((pub->buf.len + sizeof(shm_slot_t)) > pub->header->slot_size) {
+		size_t slot_size = pub->header->slot_size;
+		while ((pub->buf.len + sizeof(shm_slot_t)) > slot_size)
+			slot_size *= 2;
+
+		// The new file already starts out with this snapshot.
+		return shm_create(pub, slot_size);
+	}
+
+	// Write to the slot readers aren't looking at.
+	idx = atomic_load_explicit(&pub->header->active, memory_order_relaxed) ^ 1;
+	slot = shm_slot(pub->header, idx);
+	seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+	atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	slot->len = pub->buf.len;
+	if (pub->buf.len > 0)
+		memcpy(slot + 1, pub->buf.data, pub->buf.len);
+	atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+
+	// Point the readers at it.
+	atomic_store_explicit(&pub->header->active, idx, memory_order_release);
+	atomic_fetch_add_explicit(&pub->header->generation, 1,
+							  memory_order_release);
+
+	return true;
+}
+
+/**
+ * Stops publishing. The file is left behind with the last snapshot in it.
+ *
+ * @param pub Publisher.
+ */
+void shm_publisher_close(shm_publisher_t *pub) {
+	if (pub->header != NULL)
+		munmap(pub->header, pub->size);
+	if (pub->fd != -1)
+		close(pub->fd);
+	buffer_free(&pub->buf);
+
+	pub->header = NULL;
+	pub->fd = -1;
+}
+
+/**
+ * Maps a published file for reading.
+ *
+ * @param  reader Reader to be initialized.
+ * @param  path   Path to the memory-mapped file.
+ * @return        TRUE if the file was mapped.
+ */
+bool shm_reader_open(shm_reader_t *reader, const char *path) {
+	if (strlen(path) >= PATH_MAX)
+		return false;
+	strcpy(reader->path, path);
+	reader->header = NULL;
+	reader->size = 0;
+	buffer_init(&reader->buf);
+
+	if (!shm_map(reader)) {
+		buffer_free(&reader->buf);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Reads a consistent copy of the current snapshot. This doesn't make any
+ * syscalls unless the publisher has moved to a new file.
+ *
+ * @param  reader     Reader.
+ * @param  generation Optional pointer that will hold the number of snapshots
+ *                    published before this one.
+ * @return            Buffer with the snapshot, valid until the next read, or
+ *                    NULL if the file couldn't be remapped, is corrupt or the
+ *                    publisher never finished writing to it.
+ */
+const buffer_t *shm_read_raw(shm_reader_t *reader, uint64_t *generation) {
+	const shm_slot_t *slot;
+	uint64_t before;
+	uint64_t after;
+	uint64_t gen;
+	uint64_t len;
+	uint32_t tries;
+
+	for (tries = 0; ; tries++) {
+		// Give up on a publisher that died halfway through a write.
+		if (tries >= SHM_READ_RETRIES)
+			return NULL;
+
+		// Follow the publisher to its new file.
+		if (atomic_load_explicit(&reader->header->stale,
+								 memory_order_acquire)) {
+			shm_unmap(reader);
+			if (!shm_map(reader))
+				return NULL;
+		}
+
+		// Grab the active slot.
+		gen = atomic_load_explicit(&reader->header->generation,
+								   memory_order_acquire);
+		slot = shm_slot(reader->header,
+						atomic_load_explicit(&reader->header->active,
+											 memory_order_acquire));
+		before = atomic_load_explicit(&slot->seq, memory_order_acquire);
+		if (before & 1)
+			continue;
+
+		// Copy it, making sure not to trust a length that's being written.
+		len = slot->len;
+		if ((len + sizeof(shm_slot_t)) > reader->header->slot_size) {
+			// A length that's still there once the write is done is garbage.
+			atomic_thread_fence(memory_order_acquire);
+			if (atomic_load_explicit(&slot->seq, memory_order_relaxed) ==
+					before) {
+				return NULL;
+			}
+
+			continue;
+		}
+		buffer_clear(&reader->buf);
+		buffer_append(&reader->buf, slot + 1, len);
+
+		// Only accept it if the publisher didn't touch it in the meantime.
+		atomic_thread_fence(memory_order_acquire);
+		after = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+		if (before == after)
+			break;
+	}
+
+	if (generation != NULL)
+		*generation = gen;
+
+	return &reader->buf;
+}
+
+/**
+ * Reads the current snapshot into an empty container.
+ *
+ * @param  reader    Reader.
+ * @param  container Storage device container to be populated.
+ * @return           TRUE if the snapshot was read and is valid.
+ */
+bool shm_read(shm_reader_t *reader, stdev_container *container) {
+	const buffer_t *buf;
+
+	buf = shm_read_raw(reader, NULL);
+	if (buf == NULL)
+		return false;
+
+	return snapshot_decode(container, buf->data, buf->len);
+}
+
+/**
+ * Unmaps the published file.
+ *
+ * @param reader Reader.
+ */
+void shm_reader_close(shm_reader_t *reader) {
+	shm_unmap(reader);
+	buffer_free(&reader->buf);
+}
+
+/**
+ * Creates a new file with an empty snapshot in it and puts it in place of the
+ * one we were publishing to.
+ *
+ * @param  pub       Publisher.
+ * @param  slot_size Size of each one of the slots.
+ * @return           TRUE if the new file is in place.
+ */
+bool shm_create(shm_publisher_t *pub, size_t slot_size) {
+	char tmppath[PATH_MAX];
+	shm_header_t *header;
+	shm_slot_t *slot;
+	size_t size;
+	int fd;
+
+	// Create the new file right next to the old one.
+	if (snprintf(tmppath, PATH_MAX, "%s.%d", pub->path, (int)getpid()) >=
+			PATH_MAX) {
+		return false;
+	}
+	fd = open(tmppath, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd == -1) {
+		fprintf(stderr, "Couldn't create %s: %s\n", tmppath, strerror(errno));
+		return false;
+	}
+
+	// Map it.
+	size = SHM_HEADER_SIZE + (slot_size * 2);
+	if ((flock(fd, LOCK_EX | LOCK_NB) == -1) || (ftruncate(fd, size) == -1))
+		goto fail;
+	header = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (header == MAP_FAILED)
+		goto fail;
+
+	// Set up the header with whatever we were about to publish in the active
+	// slot, so that readers coming over from the old file have it right away.
+	memcpy(header->magic, SHM_MAGIC, sizeof(header->magic));
+	header->version = SHM_VERSION;
+	header->header_size = SHM_HEADER_SIZE;
+	header->slot_size = slot_size;
+	if (pub->header != NULL) {
+		atomic_store_explicit(&header->generation,
+			atomic_load_explicit(&pub->header->generation,
+								 memory_order_relaxed) + 1,
+			memory_order_relaxed);
+	}
+	slot = shm_slot(header, 0);
+	slot->len = pub->buf.len;
+	if (pub->buf.len > 0)
+		memcpy(slot + 1, pub->buf.data, pub->buf.len);
+
+	// Replace the old file.
+	if (rename(tmppath, pub->path) == -1) {
+		munmap(header, size);
+		goto fail;
+	}
+	if (pub->header != NULL) {
+		atomic_store_explicit(&pub->header->stale, 1, memory_order_release);
+		munmap(pub->header, pub->size);
+		close(pub->fd);
+	}
+
+	pub->fd = fd;
+	pub->header = header;
+	pub->size = size;
+
+	return true;
+
+fail:
+	fprintf(stderr, "Couldn't set up %s: %s\n", tmppath, strerror(errno));
+	close(fd);
+	unlink(tmppath);
+	return false;
+}
+
+/**
+ * Gets one of the slots of a file.
+ *
+ * @param  header Header of the memory-mapped file.
+ * @param  idx    Index of the slot.
+ * @return        Slot.
+ */
+shm_slot_t *shm_slot(const shm_header_t *header, uint32_t idx) {
+	return (shm_slot_t *)((uint8_t *)header + header->header_size +
+						  (header->slot_size * (idx & 1)));
+}
+
+/**
+ * Maps the current file of a reader and checks if it's something we know how
+ * to read.
+ *
+ * @param  reader Reader.
+ * @return        TRUE if the file was mapped.
+ */
+bool shm_map(shm_reader_t *reader) {
+	const shm_header_t *header;
+	struct stat st;
+	int fd;
+
+	fd = open(reader->path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return false;
+
+	// Check if it's big enough for the header.
+	if ((fstat(fd, &st) == -1) || (st.st_size < SHM_HEADER_SIZE)) {
+		close(fd);
+		return false;
+	}
+
+	// Map it. The mapping outlives the file descriptor.
+	header = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (header == MAP_FAILED)
+		return false;
+
+	// Check the layout.
+	if ((memcmp(header->magic, SHM_MAGIC, sizeof(header->magic)) != 0) ||
+			(header->version != SHM_VERSION) ||
+			(header->header_size != SHM_HEADER_SIZE) ||
+			((uint64_t)st.st_size <
+			 (header->header_size + (header->slot_size * 2)))) {
+		munmap((void *)header, st.st_size);
+		return false;
+	}
+
+	reader->header = header;
+	reader->size = st.st_size;
+
+	return true;
+}
+
+/**
+ * Unmaps the current file of a reader.
+ *
+ * @param reader Reader.
+ */
+void shm_unmap(shm_reader_t *reader) {
+	if (reader->header != NULL)
+		munmap((void *)reader->header, reader->size);
+
+	reader->header = NULL;
+	reader->size = 0;
+}
@@ -0,0 +1,59 @@
+/**
+ * shm.h
+ * Publishes device snapshots in a memory-mapped file that any number of
+ * reader processes can read from without syscalls or locks.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _SHM_H
+#define _SHM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "device.h"
+#include "buffer.h"
+
+// Layout constants.
+#define SHM_MAGIC       "LSSDSHM"
+#define SHM_VERSION     1
+#define SHM_HEADER_SIZE 64
+#define SHM_SLOT_MIN    65536
+
+// Times a reader tries to get a consistent copy before giving up.
+#define SHM_READ_RETRIES 1000000
+
+// Memory-mapped file header, always at offset zero.
+typedef struct shm_header_s shm_header_t;
+
+// Snapshot publisher. Only one may exist per file at any given time.
+typedef struct {
+	char          path[PATH_MAX];
+	int           fd;
+	shm_header_t *header;
+	size_t        size;
+	buffer_t      buf;
+} shm_publisher_t;
+
+// Snapshot reader.
+typedef struct {
+	char                path[PATH_MAX];
+	const shm_header_t *header;
+	size_t              size;
+	buffer_t            buf;
+} shm_reader_t;
+
+// Publishing.
+bool shm_publisher_open(shm_publisher_t *pub, const char *path);
+bool shm_publish(shm_publisher_t *pub, const stdev_container *container);
+void shm_publisher_close(shm_publisher_t *pub);
+
+// Reading.
+bool shm_reader_open(shm_reader_t *reader, const char *path);
+bool shm_read(shm_reader_t *reader, stdev_container *container);
+const buffer_t *shm_read_raw(shm_reader_t *reader, uint64_t *generation);
+void shm_reader_close(shm_reader_t *reader);
+
+#endif  //_SHM_H
@@ -0,0 +1,329 @@
+/**
+ * snapshot.c
+ * Compact binary serialization of a storage device container.
+ *
+ * A snapshot is made out of a header followed by fixed size device records,
+ * fixed size partition records, the mount point references and finally a
+ * blob with every distinct string, which all the records point into by
+ * offset. Everything is stored in host byte order since snapshots never leave
+ * the machine they were taken on.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "snapshot.h"
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Mode of snapshot files.
+#define SNAPSHOT_FILE_MODE 0644
+
+// Snapshot header.
+typedef struct {
+	char     magic[8];
+	uint32_t version;
+	uint32_t ndevs;
+	uint32_t nparts;
+	uint32_t nmounts;
+	uint32_t strlen;
+	uint32_t reserved;
+} snapshot_header_t;
+
+// Device record.
+typedef struct {
+	uint64_t sectors;
+	uint64_t sector_size;
+	uint32_t major;
+	uint32_t minor;
+	strref_t name;
+	uint32_t nparts;
+	uint8_t  ro;
+	uint8_t  reserved[7];
+} snapshot_device_t;
+
+// Partition record.
+typedef struct {
+	uint64_t sectors;
+	uint64_t start;
+	uint32_t major;
+	uint32_t minor;
+	strref_t name;
+	strref_t uuid;
+	strref_t label;
+	strref_t type;
+	uint32_t nmounts;
+	uint8_t  ro;
+	uint8_t  reserved[3];
+} snapshot_partition_t;
+
+/**
+ * Serializes a storage device container into a buffer.
+ *
+ * @param container Storage device container.
+ * @param buf       Buffer where the snapshot will be appended.
+ */
+void snapshot_encode(const stdev_container *container, buffer_t *buf) {
+	snapshot_header_t header;
+	snapshot_device_t *devs;
+	snapshot_partition_t *parts;
+	strref_t *mounts;
+	strpool_t strings;
+	size_t hdroff;
+	uint32_t pi = 0;
+	uint32_t mi = 0;
+
+	// Count everything.
+	memset(&header, 0, sizeof(snapshot_header_t));
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version = SNAPSHOT_VERSION;
+	header.ndevs = container->count;
+	for (uint32_t i = 0; i < container->count; i++) {
+		const partition_container *plist = &container->list[i].partitions;
+
+		header.nparts += plist->count;
+		for (uint32_t j = 0; j < plist->count; j++)
+			header.nmounts += plist->list[j].mntcount;
+	}
+
+	// Reserve the fixed size sections.
+	hdroff = buf->len;
+	buffer_reserve(buf, sizeof(snapshot_header_t) +
+				   (sizeof(snapshot_device_t) * header.ndevs) +
+				   (sizeof(snapshot_partition_t) * header.nparts) +
+				   (sizeof(strref_t) * header.nmounts));
+	devs = (snapshot_device_t *)(buf->data + hdroff + sizeof(snapshot_header_t));
+	parts = (snapshot_partition_t *)(devs + header.ndevs);
+	mounts = (strref_t *)(parts + header.nparts);
+
+	// Fill in the records, interning the strings into a fresh pool so that the
+	// blob only has the strings that are actually in use.
+	strpool_init(&strings);
+	for (uint32_t i = 0; i < container->count; i++) {
+		const stdev_t *sd = &container->list[i];
+
+		memset(&devs[i], 0, sizeof(snapshot_device_t));
+		devs[i].sectors = sd->sectors;
+		devs[i].sector_size = sd->sector_size;
+		devs[i].major = sd->major;
+		devs[i].minor = sd->minor;
+		devs[i].name = strpool_intern(&strings, device_str(container, sd->name));
+		devs[i].nparts = sd->partitions.count;
+		devs[i].ro = sd->ro;
+
+		for (uint32_t j = 0; j < sd->partitions.count; j++) {
+			const partition_t *part = &sd->partitions.list[j];
+			snapshot_partition_t *rec = &parts[pi++];
+
+			memset(rec, 0, sizeof(snapshot_partition_t));
+			rec->sectors = part->sectors;
+			rec->start = part->start;
+			rec->major = part->major;
+			rec->minor = part->minor;
+			rec->name = strpool_intern(&strings,
+									   device_str(container, part->name));
+			rec->uuid = strpool_intern(&strings,
+									   device_str(container, part->uuid));
+			rec->label = strpool_intern(&strings,
+										device_str(container, part->label));
+			rec->type = strpool_intern(&strings,
+									   device_str(container, part->type));
+			rec->nmounts = part->mntcount;
+			rec->ro = part->ro;
+
+			for (uint32_t k = 0; k < part->mntcount; k++) {
+				mounts[mi++] = strpool_intern(&strings,
+					device_str(container, part->mntpoints[k]));
+			}
+		}
+	}
+
+	// Append the strings and finish the header.
+	header.strlen = strings.len;
+	if (strings.len > 0)
+		buffer_append(buf, strings.buf, strings.len);
+	memcpy(buf->data + hdroff, &header, sizeof(snapshot_header_t));
+
+	// Clean up.
+	strpool_free(&strings);
+}
+
+/**
+ * Deserializes a snapshot into an empty storage device container.
+ *
+ * @param  container Storage device container to be populated.
+ * @param  data      Snapshot data.
+ * @param  len       Length of the snapshot data.
+ * @return           TRUE if the snapshot was valid.
+ */
+bool snapshot_decode(stdev_container *container, const uint8_t *data,
+					 size_t len) {
+	snapshot_header_t header;
+	const snapshot_device_t *devs;
+	const snapshot_partition_t *parts;
+	const strref_t *mounts;
+	const char *strings;
+	size_t fixed;
+	uint32_t pi = 0;
+	uint32_t mi = 0;
+
+	device_container_init(container);
+
+	// Check the header.
+	if (len < sizeof(snapshot_header_t))
+		return false;
+	memcpy(&header, data, sizeof(snapshot_header_t));
+	if ((memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) ||
+			(header.version != SNAPSHOT_VERSION)) {
+		return false;
+	}
+
+	// Check the sections.
+	fixed = sizeof(snapshot_header_t) +
+		((size_t)header.ndevs * sizeof(snapshot_device_t)) +
+		((size_t)header.nparts * sizeof(snapshot_partition_t)) +
+		((size_t)header.nmounts * sizeof(strref_t));
+	if ((fixed + header.strlen) != len)
+		return false;
+	if ((header.strlen > 0) && (data[len - 1] != '\0'))
+		return false;
+	devs = (const snapshot_device_t *)(data + sizeof(snapshot_header_t));
+	parts = (const snapshot_partition_t *)(devs + header.ndevs);
+	mounts = (const strref_t *)(parts + header.nparts);
+	strings = (const char *)(data + fixed);
+
+// Gets a string from the blob making sure it's inside it.
+#define SNAP_STR(ref) (((ref) < header.strlen) ? (strings + (ref)) : "")
+
+	// Rebuild the devices.
+	for (uint32_t i = 0; i < header.ndevs; i++) {
+		stdev_t sd;
+
+		memset(&sd, 0, sizeof(stdev_t));
+		sd.sectors = devs[i].sectors;
+		sd.sector_size = devs[i].sector_size;
+		sd.size = sd.sectors * sd.sector_size;
+		sd.major = devs[i].major;
+		sd.minor = devs[i].minor;
+		sd.ro = devs[i].ro;
+		sd.name = strpool_intern(&container->strings, SNAP_STR(devs[i].name));
+
+		for (uint32_t j = 0; j < devs[i].nparts; j++) {
+			const snapshot_partition_t *rec;
+			partition_t *part;
+
+			if (pi >= header.nparts)
+				goto corrupt;
+			rec = &parts[pi++];
+
+			part = device_partition_push(container, &sd.partitions,
+										 SNAP_STR(rec->name));
+			part->sectors = rec->sectors;
+			part->size = rec->sectors * sd.sector_size;
+			part->start = rec->start;
+			part->major = rec->major;
+			part->minor = rec->minor;
+			part->ro = rec->ro;
+			part->uuid = strpool_intern(&container->strings,
+										SNAP_STR(rec->uuid));
+			part->label = strpool_intern(&container->strings,
+										 SNAP_STR(rec->label));
+			part->type = strpool_intern(&container->strings,
+										SNAP_STR(rec->type));
+
+			for (uint32_t k = 0; k < rec->nmounts; k++) {
+				if (mi >= header.nmounts)
+					goto corrupt;
+				device_partition_mount_push(container, part,
+											SNAP_STR(mounts[mi]));
+				mi++;
+			}
+		}
+
+		device_list_push(container, &sd);
+	}
+
+#undef SNAP_STR
+
+	return true;
+
+corrupt:
+	device_container_free(container);
+	return false;
+}
+
+/**
+ * Reads a whole snapshot file. Its contents are only checked when decoded.
+ *
+ * @param  path Path to the snapshot file.
+ * @param  buf  Buffer where the snapshot will be appended.
+ * @return      TRUE if the file was read.
+ */
+bool snapshot_read(const char *path, buffer_t *buf) {
+	FILE *fh;
+	long fsize;
+	bool success;
+
+	// Open the snapshot file.
+	fh = fopen(path, "rb");
+	if (fh == NULL) {
+		perror(path);
+		return false;
+	}
+
+	// Slurp it.
+	fseek(fh, 0, SEEK_END);
+	fsize = ftell(fh);
+	fseek(fh, 0, SEEK_SET);
+	success = fsize >= 0;
+	if (success && (fsize > 0)) {
+		success = fread(buffer_reserve(buf, fsize), 1, fsize, fh) ==
+			(size_t)fsize;
+	}
+	if (!success)
+		fprintf(stderr, "Failed to read the snapshot %s.\n", path);
+
+	fclose(fh);
+	return success;
+}
+
+/**
+ * Writes a snapshot to a file. The file is replaced atomically so a snapshot
+ * that's being compared against is never half written.
+ *
+ * @param  path Path to the snapshot file.
+ * @param  buf  Encoded snapshot.
+ * @return      TRUE if the file was written.
+ */
+bool snapshot_write(const char *path, const buffer_t *buf) {
+	char tmppath[PATH_MAX];
+	bool success;
+	int fd;
+
+	// Open a temporary file right next to the snapshot.
+	if (snprintf(tmppath, PATH_MAX, "%s.XXXXXX", path) >= PATH_MAX) {
+		fprintf(stderr, "Snapshot path is too long: %s\n", path);
+		return false;
+	}
+	fd = mkstemp(tmppath);
+	if (fd == -1) {
+		perror(tmppath);
+		return false;
+	}
+	fchmod(fd, SNAPSHOT_FILE_MODE);
+
+	// Write it and put it in place.
+	success = buffer_write(buf, fd);
+	if (close(fd) != 0)
+		success = false;
+	if (success)
+		success = rename(tmppath, path) == 0;
+	if (!success) {
+		perror(path);
+		unlink(tmppath);
+	}
+
+	return success;
+}
@@ -0,0 +1,30 @@
+/**
+ * snapshot.h
+ * Compact binary serialization of a storage device container.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "device.h"
+#include "buffer.h"
+
+// Constants.
+#define SNAPSHOT_MAGIC   "LSSDSNAP"
+#define SNAPSHOT_VERSION 2
+
+// Serialization.
+void snapshot_encode(const stdev_container *container, buffer_t *buf);
+bool snapshot_decode(stdev_container *container, const uint8_t *data,
+					 size_t len);
+
+// Files.
+bool snapshot_read(const char *path, buffer_t *buf);
+bool snapshot_write(const char *path, const buffer_t *buf);
+
+#endif  //_SNAPSHOT_H
@@ -0,0 +1,201 @@
+/**
+ * strpool.c
+ * Pool of interned strings referenced by their offset.
+ *
+ * Every distinct string is stored only once in a single growable buffer and
+ * referenced by its offset, which stays valid even when the buffer gets
+ * reallocated. A small open addressing hash table of offsets is used to find
+ * strings that are already in the pool.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "strpool.h"
+#include <string.h>
+
+// Constants.
+#define STRPOOL_INIT_CAP   1024
+#define STRPOOL_INIT_TSIZE 64
+
+// Private methods.
+uint32_t strpool_hash(const char *str, size_t len);
+strref_t *strpool_slot(strref_t *table, uint32_t tsize, const char *buf,
+					   const char *str, size_t len, uint32_t hash);
+void strpool_grow_table(strpool_t *pool);
+
+/**
+ * Initializes an empty string pool.
+ *
+ * @param pool String pool to be initialized.
+ */
+void strpool_init(strpool_t *pool) {
+	pool->buf = NULL;
+	pool->len = 0;
+	pool->cap = 0;
+	pool->table = NULL;
+	pool->tsize = 0;
+	pool->tcount = 0;
+}
+
+/**
+ * Interns a NULL-terminated string.
+ *
+ * @param  pool String pool.
+ * @param  str  String to be interned.
+ * @return      Reference to the string in the pool.
+ */
+strref_t strpool_intern(strpool_t *pool, const char *str) {
+	return strpool_intern_len(pool, str, strlen(str));
+}
+
+/**
+ * Interns a string with a known length. The string doesn't have to be
+ * NULL-terminated.
+ *
+ * @param  pool String pool.
+ * @param  str  String to be interned.
+ * @param  len  Length of the string.
+ * @return      Reference to the string in the pool.
+ */
+strref_t strpool_intern_len(strpool_t *pool, const char *str, size_t len) {
+	strref_t *slot;
+	strref_t ref;
+	uint32_t hash;
+
+	// Empty strings are free.
+	if (len == 0)
+		return STRREF_EMPTY;
+
+	// Set up the pool the first time around. Offset zero is the empty string.
+	if (pool->buf == NULL) {
+		pool->cap = STRPOOL_INIT_CAP;
+		pool->buf = malloc(pool->cap);
+		pool->buf[0] = '\0';
+		pool->len = 1;
+	}
+
+	// Keep the hash table load factor under 50%.
+	if (((pool->tcount + 1) * 2) > pool->tsize)
+		strpool_grow_table(pool);
+
+	// Check if we already have it.
+	hash = strpool_hash(str, len);
+	slot = strpool_slot(pool->table, pool->tsize, pool->buf, str, len, hash);
+	if (*slot != STRREF_EMPTY)
+		return *slot;
+
+	// Make room for the string.
+	while ((pool->len + len + 1) > pool->cap) {
+		pool->cap *= 2;
+		pool->buf = realloc(pool->buf, pool->cap);
+	}
+
+	// Append it.
+	ref = pool->len;
+	memcpy(pool->buf + ref, str, len);
+	pool->buf[ref + len] = '\0';
+	pool->len += len + 1;
+
+	*slot = ref;
+	pool->tcount++;
+
+	return ref;
+}
+
+/**
+ * Gets a string from the pool.
+ *
+ * @param  pool String pool.
+ * @param  ref  Reference to the string.
+ * @return      The string.
+ */
+const char *strpool_get(const strpool_t *pool, strref_t ref) {
+	if (ref == STRREF_EMPTY)
+		return "";
+
+	return pool->buf + ref;
+}
+
+/**
+ * Frees the string pool.
+ *
+ * @param pool String pool to be freed.
+ */
+void strpool_free(strpool_t *pool) {
+	free(pool->buf);
+	free(pool->table);
+	strpool_init(pool);
+}
+
+/**
+ * FNV-1a hash of a string.
+ *
+ * @param  str String to be hashed.
+ * @param  len Length of the string.
+ * @return     Hash of the string.
+ */
+uint32_t strpool_hash(const char *str, size_t len) {
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < len; i++) {
+		hash ^= (uint8_t)str[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+/**
+ * Finds the hash table slot of a string using linear probing.
+ *
+ * @param  table Hash table.
+ * @param  tsize Size of the hash table. (power of two)
+ * @param  buf   String pool buffer.
+ * @param  str   String to look for.
+ * @param  len   Length of the string.
+ * @param  hash  Hash of the string.
+ * @return       Slot with the string or the empty one where it should go.
+ */
+strref_t *strpool_slot(strref_t *table, uint32_t tsize, const char *buf,
+					   const char *str, size_t len, uint32_t hash) {
+	for (uint32_t i = hash; ; i++) {
+		strref_t *slot = &table[i & (tsize - 1)];
+		const char *cur;
+
+		if (*slot == STRREF_EMPTY)
+			return slot;
+
+		cur = buf + *slot;
+		if ((strncmp(cur, str, len) == 0) && (cur[len] == '\0'))
+			return slot;
+	}
+}
+
+/**
+ * Doubles the size of the hash table.
+ *
+ * @param pool String pool.
+ */
+void strpool_grow_table(strpool_t *pool) {
+	uint32_t tsize = (pool->tsize == 0) ? STRPOOL_INIT_TSIZE : pool->tsize * 2;
+	strref_t *table = calloc(tsize, sizeof(strref_t));
+
+	// Rehash everything.
+	for (uint32_t i = 0; i < pool->tsize; i++) {
+		strref_t ref = pool->table[i];
+		const char *str;
+		size_t len;
+
+		if (ref == STRREF_EMPTY)
+			continue;
+
+		str = pool->buf + ref;
+		len = strlen(str);
+		*strpool_slot(table, tsize, pool->buf, str, len,
+					  strpool_hash(str, len)) = ref;
+	}
+
+	free(pool->table);
+	pool->table = table;
+	pool->tsize = tsize;
+}
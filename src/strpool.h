@@ -0,0 +1,42 @@
+/**
+ * strpool.h
+ * Pool of interned strings referenced by their offset.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _STRPOOL_H
+#define _STRPOOL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Reference to a string in the pool. Zero is always the empty string.
+typedef uint32_t strref_t;
+#define STRREF_EMPTY 0
+
+// String pool.
+typedef struct {
+	char     *buf;
+	uint32_t  len;
+	uint32_t  cap;
+	strref_t *table;
+	uint32_t  tsize;
+	uint32_t  tcount;
+} strpool_t;
+
+// Initialization.
+void strpool_init(strpool_t *pool);
+
+// Interning.
+strref_t strpool_intern(strpool_t *pool, const char *str);
+strref_t strpool_intern_len(strpool_t *pool, const char *str, size_t len);
+
+// Lookup.
+const char *strpool_get(const strpool_t *pool, strref_t ref);
+
+// Clean up.
+void strpool_free(strpool_t *pool);
+
+#endif  //_STRPOOL_H
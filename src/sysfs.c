@@ -0,0 +1,419 @@
+/**
+ * sysfs.c
+ * Lightweight reader for sysfs attribute files.
+ *
+ * Every device directory is opened only once and its attributes are read
+ * relative to it with a single openat/pread/close sequence into a buffer that
+ * is reused for every attribute, which is a lot cheaper than going through
+ * stdio with absolute paths.
+ *
+ * Attributes can also be read in batches, which lets io_uring open, read and
+ * close all of them with a few submissions instead of three system calls per
+ * attribute. Batches fall back to the same openat/pread/close sequence when
+ * io_uring isn't available.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "sysfs.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "utils.h"
+
+// Constants.
+#define SYSFS_BATCH_INIT_CAPACITY 16
+
+// Private methods.
+void sysfs_req_read(int dirfd, sysfs_req_t *req);
+bool sysfs_batch_uring(sysfs_batch_t *batch, int dirfd, size_t first,
+					   size_t count);
+void sysfs_batch_reap(sysfs_batch_t *batch, uint8_t opcode);
+
+/**
+ * Opens a sysfs directory.
+ *
+ * @param  dir  Directory handle to be initialized.
+ * @param  path Path to the directory. (must outlive the handle)
+ * @return      TRUE if the directory was opened.
+ */
+bool sysfs_dir_open(sysfs_dir_t *dir, const char *path) {
+	dir->path = path;
+	dir->opens = 1;
+	dir->fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	return dir->fd != -1;
+}
+
+/**
+ * Opens a sysfs directory relative to another one.
+ *
+ * @param  dir    Directory handle to be initialized.
+ * @param  parent Parent directory handle.
+ * @param  name   Name of the directory inside the parent. (must outlive the
+ *                handle)
+ * @return        TRUE if the directory was opened.
+ */
+bool sysfs_dir_openat(sysfs_dir_t *dir, const sysfs_dir_t *parent,
+					  const char *name) {
+	dir->path = name;
+	dir->opens = 1;
+	dir->fd = openat(parent->fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	return dir->fd != -1;
+}
+
+/**
+ * Closes a sysfs directory.
+ *
+ * @param dir Directory handle to be closed.
+ */
+void sysfs_dir_close(sysfs_dir_t *dir) {
+	if (dir->fd != -1)
+		close(dir->fd);
+	dir->fd = -1;
+}
+
+/**
+ * Reads the contents of an attribute into the directory buffer. Contents that
+ * don't fit in the buffer are truncated.
+ *
+ * @param  dir  Directory handle.
+ * @param  attr Name of the attribute relative to the directory.
+ * @param  len  Optional pointer to store the length of the contents.
+ * @return      Contents of the attribute or NULL if it couldn't be read.
+ */
+const char *sysfs_read_attr(sysfs_dir_t *dir, const char *attr, size_t *len) {
+	ssize_t bytes;
+	int fd;
+
+	// Open the attribute.
+	dir->opens++;
+	fd = openat(dir->fd, attr, O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return NULL;
+
+	// Read it.
+	bytes = pread(fd, dir->buf, SYSFS_ATTR_BUF_LEN - 1, 0);
+	close(fd);
+	if (bytes < 0)
+		return NULL;
+
+	// Terminate the string.
+	dir->buf[bytes] = '\0';
+	if (len != NULL)
+		*len = bytes;
+
+	return dir->buf;
+}
+
+/**
+ * Reads an attribute that only contains a number.
+ *
+ * @param  dir  Directory handle.
+ * @param  attr Name of the attribute relative to the directory.
+ * @param  num  Pointer to the number found in the attribute.
+ * @return      TRUE if the parsing was successful.
+ */
+bool sysfs_read_num(sysfs_dir_t *dir, const char *attr, uint64_t *num) {
+	const char *str;
+	size_t val;
+
+	str = sysfs_read_attr(dir, attr, NULL);
+	if ((str == NULL) || (parse_num(str, &val) == NULL))
+		return false;
+
+	*num = val;
+	return true;
+}
+
+/**
+ * Reads an attribute that contains a device number in the "major:minor"
+ * format.
+ *
+ * @param  dir   Directory handle.
+ * @param  attr  Name of the attribute relative to the directory.
+ * @param  major Pointer to the major number found in the attribute.
+ * @param  minor Pointer to the minor number found in the attribute.
+ * @return       TRUE if the parsing was successful.
+ */
+bool sysfs_read_dev(sysfs_dir_t *dir, const char *attr, uint32_t *major,
+					uint32_t *minor) {
+	const char *str;
+
+	str = sysfs_read_attr(dir, attr, NULL);
+	if (str == NULL)
+		return false;
+
+	return parse_dev(str, major, minor) != NULL;
+}
+
+/**
+ * Initializes an attribute batch.
+ *
+ * @param batch Batch to be initialized.
+ * @param uring Read the attributes through io_uring if the kernel has it?
+ */
+void sysfs_batch_init(sysfs_batch_t *batch, bool uring) {
+	static const uint8_t ops[] = {
+		IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE
+	};
+
+	batch->count = 0;
+	batch->capacity = SYSFS_BATCH_INIT_CAPACITY;
+	batch->reqs = malloc(sizeof(sysfs_req_t) * batch->capacity);
+	batch->uring = uring && uring_init(&batch->ring, URING_DEF_ENTRIES, ops,
+										sizeof(ops));
+}
+
+/**
+ * Adds an attribute to be read to a batch.
+ *
+ * @param  batch Batch to add the attribute to.
+ * @param  sub   Subdirectory the attribute is in or NULL if it's directly in
+ *               the directory that will be read.
+ * @param  attr  Name of the attribute.
+ * @return       Index of the attribute in the batch.
+ */
+size_t sysfs_batch_add(sysfs_batch_t *batch, const char *sub,
+					   const char *attr) {
+	sysfs_req_t *req;
+
+	// Make sure we have space for it.
+	if (batch->count == batch->capacity) {
+		batch->capacity *= 2;
+		batch->reqs = realloc(batch->reqs,
+							  sizeof(sysfs_req_t) * batch->capacity);
+	}
+
+	// Build the path relative to the directory.
+	req = &batch->reqs[batch->count];
+	if (sub != NULL) {
+		snprintf(req->path, SYSFS_REQ_PATH_LEN, "%s/%s", sub, attr);
+	} else {
+		snprintf(req->path, SYSFS_REQ_PATH_LEN, "%s", attr);
+	}
+	req->len = -1;
+	req->fd = -1;
+
+	return batch->count++;
+}
+
+/**
+ * Reads every attribute in a batch. Attributes that couldn't be read are
+ * simply left without any contents.
+ *
+ * @param batch Batch of attributes to read.
+ * @param dir   Directory the attributes are relative to.
+ */
+void sysfs_batch_read(sysfs_batch_t *batch, sysfs_dir_t *dir) {
+	size_t i = 0;
+
+	dir->opens += batch->count;
+
+	// Go through the ring as much as we can.
+	while (batch->uring && (i < batch->count)) {
+		size_t count = batch->count - i;
+		if (count > batch->ring.entries)
+			count = batch->ring.entries;
+
+		// Give up on the ring for good if it fails on us.
+		if (!sysfs_batch_uring(batch, dir->fd, i, count)) {
+			uring_free(&batch->ring);
+			batch->uring = false;
+			break;
+		}
+
+		i += count;
+	}
+
+	// Read whatever is left the usual way.
+	for (; i < batch->count; i++)
+		sysfs_req_read(dir->fd, &batch->reqs[i]);
+}
+
+/**
+ * Gets an attribute that only contains a number from a batch that was read.
+ *
+ * @param  batch Batch of attributes that was read.
+ * @param  idx   Index of the attribute in the batch.
+ * @param  num   Pointer to the number found in the attribute.
+ * @return       TRUE if the parsing was successful.
+ */
+bool sysfs_batch_num(const sysfs_batch_t *batch, size_t idx, uint64_t *num) {
+	size_t val;
+
+	if ((batch->reqs[idx].len < 0) ||
+			(parse_num(batch->reqs[idx].buf, &val) == NULL)) {
+		return false;
+	}
+
+	*num = val;
+	return true;
+}
+
+/**
+ * Gets an attribute that contains a device number in the "major:minor" format
+ * from a batch that was read.
+ *
+ * @param  batch Batch of attributes that was read.
+ * @param  idx   Index of the attribute in the batch.
+ * @param  major Pointer to the major number found in the attribute.
+ * @param  minor Pointer to the minor number found in the attribute.
+ * @return       TRUE if the parsing was successful.
+ */
+bool sysfs_batch_dev(const sysfs_batch_t *batch, size_t idx, uint32_t *major,
+					 uint32_t *minor) {
+	if (batch->reqs[idx].len < 0)
+		return false;
+
+	return parse_dev(batch->reqs[idx].buf, major, minor) != NULL;
+}
+
+/**
+ * Empties a batch so that it can be reused.
+ *
+ * @param batch Batch to be emptied.
+ */
+void sysfs_batch_clear(sysfs_batch_t *batch) {
+	batch->count = 0;
+}
+
+/**
+ * Frees up everything allocated by a batch.
+ *
+ * @param batch Batch to be freed.
+ */
+void sysfs_batch_free(sysfs_batch_t *batch) {
+	if (batch->uring)
+		uring_free(&batch->ring);
+	batch->uring = false;
+
+	free(batch->reqs);
+	batch->reqs = NULL;
+	batch->count = 0;
+	batch->capacity = 0;
+}
+
+/**
+ * Reads a single attribute of a batch with the usual system calls.
+ *
+ * @param dirfd Directory the attribute is relative to.
+ * @param req   Attribute to be read.
+ */
+void sysfs_req_read(int dirfd, sysfs_req_t *req) {
+	int fd;
+
+	req->len = -1;
+	fd = openat(dirfd, req->path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return;
+
+	req->len = pread(fd, req->buf, SYSFS_ATTR_BUF_LEN - 1, 0);
+	if (req->len >= 0)
+		req->buf[req->len] = '\0';
+	close(fd);
+}
+
+/**
+ * Reads a range of attributes of a batch through the ring. Every attribute is
+ * opened in a single submission, then read in another, and closed in a last
+ * one. If the ring fails on us the files it opened are closed and the range
+ * has to be read the usual way.
+ *
+ * @param  batch Batch of attributes to read.
+ * @param  dirfd Directory the attributes are relative to.
+ * @param  first Index of the first attribute in the range.
+ * @param  count Number of attributes in the range. (at most the ring size)
+ * @return       TRUE if the attributes were read through the ring.
+ */
+bool sysfs_batch_uring(sysfs_batch_t *batch, int dirfd, size_t first,
+					   size_t count) {
+	struct io_uring_sqe *sqe;
+	bool success;
+
+	// Open every attribute.
+	for (size_t i = first; i < (first + count); i++) {
+		sqe = uring_get_sqe(&batch->ring);
+		sqe->opcode = IORING_OP_OPENAT;
+		sqe->fd = dirfd;
+		sqe->addr = (uintptr_t)batch->reqs[i].path;
+		sqe->open_flags = O_RDONLY | O_CLOEXEC;
+		sqe->user_data = i;
+	}
+	success = uring_submit_wait(&batch->ring);
+	sysfs_batch_reap(batch, IORING_OP_OPENAT);
+
+	// Read the ones that were opened.
+	if (success) {
+		for (size_t i = first; i < (first + count); i++) {
+			if (batch->reqs[i].fd == -1)
+				continue;
+
+			sqe = uring_get_sqe(&batch->ring);
+			sqe->opcode = IORING_OP_READ;
+			sqe->fd = batch->reqs[i].fd;
+			sqe->addr = (uintptr_t)batch->reqs[i].buf;
+			sqe->len = SYSFS_ATTR_BUF_LEN - 1;
+			sqe->off = 0;
+			sqe->user_data = i;
+		}
+		success = uring_submit_wait(&batch->ring);
+		sysfs_batch_reap(batch, IORING_OP_READ);
+	}
+
+	// Close them.
+	if (success) {
+		for (size_t i = first; i < (first + count); i++) {
+			if (batch->reqs[i].fd == -1)
+				continue;
+
+			sqe = uring_get_sqe(&batch->ring);
+			sqe->opcode = IORING_OP_CLOSE;
+			sqe->fd = batch->reqs[i].fd;
+			sqe->user_data = i;
+		}
+		success = uring_submit_wait(&batch->ring);
+		sysfs_batch_reap(batch, IORING_OP_CLOSE);
+	}
+
+	// Don't leave anything open behind if the ring failed.
+	if (!success) {
+		for (size_t i = first; i < (first + count); i++) {
+			if (batch->reqs[i].fd != -1)
+				close(batch->reqs[i].fd);
+			batch->reqs[i].fd = -1;
+			batch->reqs[i].len = -1;
+		}
+	}
+
+	return success;
+}
+
+/**
+ * Goes through the completions of a submission to a batch's ring.
+ *
+ * @param batch  Batch of attributes being read.
+ * @param opcode Operation that was submitted for every attribute.
+ */
+void sysfs_batch_reap(sysfs_batch_t *batch, uint8_t opcode) {
+	uint64_t idx;
+	int32_t res;
+
+	while (uring_next_cqe(&batch->ring, &idx, &res)) {
+		sysfs_req_t *req = &batch->reqs[idx];
+
+		switch (opcode) {
+			case IORING_OP_OPENAT:
+				req->fd = (res >= 0) ? res : -1;
+				break;
+			case IORING_OP_READ:
+				req->len = (res >= 0) ? res : -1;
+				if (req->len >= 0)
+					req->buf[req->len] = '\0';
+				break;
+			case IORING_OP_CLOSE:
+				req->fd = -1;
+				break;
+		}
+	}
+}
@@ -0,0 +1,72 @@
+/**
+ * sysfs.h
+ * Lightweight reader for sysfs attribute files.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _SYSFS_H
+#define _SYSFS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <sys/types.h>
+#include "uring.h"
+
+// Constants.
+#define SYSFS_ATTR_BUF_LEN 64
+#define SYSFS_REQ_PATH_LEN (NAME_MAX + 32)
+
+// An open sysfs directory, the buffer used to read its attributes and how
+// many files were opened through it.
+typedef struct {
+	int         fd;
+	const char *path;
+	uint32_t    opens;
+	char        buf[SYSFS_ATTR_BUF_LEN];
+} sysfs_dir_t;
+
+// Attribute to be read as part of a batch.
+typedef struct {
+	char    path[SYSFS_REQ_PATH_LEN];
+	char    buf[SYSFS_ATTR_BUF_LEN];
+	ssize_t len;
+	int     fd;
+} sysfs_req_t;
+
+// Attributes of a directory that are read all at once, with io_uring if it
+// was asked for and the kernel has it.
+typedef struct {
+	sysfs_req_t *reqs;
+	size_t       count;
+	size_t       capacity;
+	bool         uring;
+	uring_t      ring;
+} sysfs_batch_t;
+
+// Directory handling.
+bool sysfs_dir_open(sysfs_dir_t *dir, const char *path);
+bool sysfs_dir_openat(sysfs_dir_t *dir, const sysfs_dir_t *parent,
+					  const char *name);
+void sysfs_dir_close(sysfs_dir_t *dir);
+
+// Attribute reading.
+const char *sysfs_read_attr(sysfs_dir_t *dir, const char *attr, size_t *len);
+bool sysfs_read_num(sysfs_dir_t *dir, const char *attr, uint64_t *num);
+bool sysfs_read_dev(sysfs_dir_t *dir, const char *attr, uint32_t *major,
+					uint32_t *minor);
+
+// Batch reading.
+void sysfs_batch_init(sysfs_batch_t *batch, bool uring);
+size_t sysfs_batch_add(sysfs_batch_t *batch, const char *sub,
+					   const char *attr);
+void sysfs_batch_read(sysfs_batch_t *batch, sysfs_dir_t *dir);
+bool sysfs_batch_num(const sysfs_batch_t *batch, size_t idx, uint64_t *num);
+bool sysfs_batch_dev(const sysfs_batch_t *batch, size_t idx, uint32_t *major,
+					 uint32_t *minor);
+void sysfs_batch_clear(sysfs_batch_t *batch);
+void sysfs_batch_free(sysfs_batch_t *batch);
+
+#endif  //_SYSFS_H
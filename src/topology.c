@@ -0,0 +1,577 @@
+/**
+ * topology.c
+ * Graph of how block devices are stacked on top of each other.
+ *
+ * Device-mapper targets, md arrays, LVM volumes and multipath maps are all
+ * whole devices that list the devices they're built on top of in their
+ * slaves directory, which is the exact mirror of the holders directory of
+ * the devices underneath. Reading only the slaves side gets every link once,
+ * with a single directory listing per device. The links are then turned into
+ * a flat adjacency list with a counting pass, so building the whole graph is
+ * linear in the number of devices and links.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "topology.h"
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include "sysfs.h"
+
+// Constants.
+#define TOPOLOGY_BLOCK_DIR  "/block/"
+#define TOPOLOGY_MAX_DEPTH  64
+#define TOPOLOGY_PREFIX_LEN ((TOPOLOGY_MAX_DEPTH * 4) + 2)
+
+// Link between a device and something stacked on top of it.
+typedef struct {
+	uint32_t parent;
+	uint32_t child;
+} topology_link_t;
+
+// Dynamic array of links.
+typedef struct {
+	topology_link_t *list;
+	uint32_t         count;
+	uint32_t         capacity;
+} topology_links_t;
+
+// Private methods.
+uint32_t topology_hash(const char *str);
+const char *topology_name(const topology_t *topo, uint32_t idx);
+void topology_insert(topology_t *topo, uint32_t idx);
+void topology_link(topology_links_t *links, uint32_t parent, uint32_t child);
+bool topology_read_device(topology_t *topo, const char *sysfs, uint32_t idx,
+						  topology_links_t *links);
+void topology_index(topology_t *topo, const topology_links_t *links);
+uint64_t topology_size(const topology_t *topo, uint32_t idx);
+uint32_t topology_mntcount(const topology_t *topo, uint32_t idx);
+const char *topology_mntpoint(const topology_t *topo, uint32_t idx,
+							  uint32_t i);
+const char *topology_type(const topology_t *topo, uint32_t idx);
+void topology_format_mounts(const topology_t *topo, uint32_t idx,
+							bool *first, buffer_t *buf);
+void topology_format_rollup(topology_t *topo, uint32_t idx, uint32_t *stack,
+							buffer_t *buf);
+void topology_format_node(topology_t *topo, uint32_t idx, char *prefix,
+						  size_t plen, bool last, uint32_t depth,
+						  uint32_t *stack, buffer_t *buf);
+
+/**
+ * Builds the stacking graph of the devices in a container.
+ *
+ * @param  topo      Graph to be built.
+ * @param  container Populated devices with their partitions.
+ * @param  roots     Where the system exposes its devices and mount table.
+ * @return           TRUE if the operation was successful.
+ */
+bool topology_build(topology_t *topo, const stdev_container *container,
+					const device_roots_t *roots) {
+	topology_links_t links;
+	uint32_t idx;
+
+	memset(topo, 0, sizeof(topology_t));
+	topo->container = container;
+
+	// Index the mount table for the whole devices.
+	if (!mount_index_load(&topo->mounts, roots->mountinfo, roots->mtab)) {
+		mount_index_free(&topo->mounts);
+		return false;
+	}
+
+	// Every device and partition is a node.
+	for (uint32_t i = 0; i < container->count; i++)
+		topo->count += 1 + container->list[i].partitions.count;
+	topo->nodes = calloc((topo->count > 0) ? topo->count : 1,
+						 sizeof(topology_node_t));
+	topo->table_size = 16;
+	while (topo->table_size < (topo->count * 2))
+		topo->table_size *= 2;
+	topo->table = malloc(sizeof(uint32_t) * topo->table_size);
+	memset(topo->table, 0xFF, sizeof(uint32_t) * topo->table_size);
+
+	// Partitions are stacked on top of their devices.
+	links.count = 0;
+	links.capacity = (topo->count > 0) ? topo->count : 1;
+	links.list = malloc(sizeof(topology_link_t) * links.capacity);
+	idx = 0;
+	for (uint32_t i = 0; i < container->count; i++) {
+		const stdev_t *sd = &container->list[i];
+		uint32_t dev = idx;
+
+		topo->nodes[idx].sd = sd;
+		topology_insert(topo, idx++);
+		for (uint32_t j = 0; j < sd->partitions.count; j++) {
+			topo->nodes[idx].sd = sd;
+			topo->nodes[idx].part = &sd->partitions.list[j];
+			topology_link(&links, dev, idx);
+			topology_insert(topo, idx++);
+		}
+	}
+
+	// Whole devices are stacked on top of their slaves.
+	for (idx = 0; idx < topo->count; idx++) {
+		if (topo->nodes[idx].part != NULL)
+			continue;
+
+		if (!topology_read_device(topo, roots->sysfs, idx, &links)) {
+			free(links.list);
+			topology_free(topo);
+			return false;
+		}
+	}
+
+	// Turn the links into an adjacency list.
+	topology_index(topo, &links);
+	free(links.list);
+
+	return true;
+}
+
+/**
+ * Finds a node by its device or partition name.
+ *
+ * @param  topo Stacking graph.
+ * @param  name Name of the device or partition.
+ * @return      Index of the node or TOPOLOGY_NONE if it isn't in the graph.
+ */
+uint32_t topology_find(const topology_t *topo, const char *name) {
+	uint32_t mask = topo->table_size - 1;
+	uint32_t slot = topology_hash(name) & mask;
+
+	while (topo->table[slot] != TOPOLOGY_NONE) {
+		if (strcmp(topology_name(topo, topo->table[slot]), name) == 0)
+			return topo->table[slot];
+
+		slot = (slot + 1) & mask;
+	}
+
+	return TOPOLOGY_NONE;
+}
+
+/**
+ * Formats every stack in the graph as a tree, starting from the devices that
+ * aren't built on top of anything else.
+ *
+ * @param topo Stacking graph.
+ * @param buf  Buffer to append the trees to.
+ */
+void topology_format(topology_t *topo, buffer_t *buf) {
+	char prefix[TOPOLOGY_PREFIX_LEN];
+	uint32_t *stack;
+
+	stack = malloc(sizeof(uint32_t) * ((topo->count > 0) ? topo->count : 1));
+	for (uint32_t i = 0; i < topo->count; i++) {
+		const topology_node_t *node = &topo->nodes[i];
+
+		if ((node->part != NULL) || (node->nslaves > 0))
+			continue;
+
+		prefix[0] = '\0';
+		topology_format_node(topo, i, prefix, 0, true, 0, stack, buf);
+		buffer_append_char(buf, '\n');
+	}
+	free(stack);
+}
+
+/**
+ * Frees a stacking graph.
+ *
+ * @param topo Graph to be freed.
+ */
+void topology_free(topology_t *topo) {
+	for (uint32_t i = 0; i < topo->count; i++)
+		free(topo->nodes[i].alias);
+	free(topo->nodes);
+	free(topo->children);
+	free(topo->table);
+	mount_index_free(&topo->mounts);
+
+	topo->nodes = NULL;
+	topo->children = NULL;
+	topo->table = NULL;
+	topo->count = 0;
+	topo->links = 0;
+}
+
+/**
+ * FNV-1a hash of a device name.
+ *
+ * @param  str Name to be hashed.
+ * @return     Hash of the name.
+ */
+uint32_t topology_hash(const char *str) {
+	uint32_t hash = 2166136261u;
+
+	while (*str != '\0') {
+		hash ^= (uint8_t)*str++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+/**
+ * Gets the name of a node.
+ *
+ * @param  topo Stacking graph.
+ * @param  idx  Index of the node.
+ * @return      Device or partition name.
+ */
+const char *topology_name(const topology_t *topo, uint32_t idx) {
+	const topology_node_t *node = &topo->nodes[idx];
+
+	return device_str(topo->container, (node->part != NULL) ?
+					  node->part->name : node->sd->name);
+}
+
+/**
+ * Adds a node to the name hash table.
+ *
+ * @param topo Stacking graph.
+ * @param idx  Index of the node.
+ */
+void topology_insert(topology_t *topo, uint32_t idx) {
+	uint32_t mask = topo->table_size - 1;
+	uint32_t slot = topology_hash(topology_name(topo, idx)) & mask;
+
+	while (topo->table[slot] != TOPOLOGY_NONE)
+		slot = (slot + 1) & mask;
+	topo->table[slot] = idx;
+}
+
+/**
+ * Appends a link to the list.
+ *
+ * @param links  List of links.
+ * @param parent Node underneath.
+ * @param child  Node stacked on top of it.
+ */
+void topology_link(topology_links_t *links, uint32_t parent, uint32_t child) {
+	if (links->count == links->capacity) {
+		links->capacity *= 2;
+		links->list = realloc(links->list,
+							  sizeof(topology_link_t) * links->capacity);
+	}
+
+	links->list[links->count].parent = parent;
+	links->list[links->count].child = child;
+	links->count++;
+}
+
+/**
+ * Reads what a whole device is built on top of, what it's called and where
+ * it's mounted.
+ *
+ * @param  topo  Stacking graph.
+ * @param  sysfs Where sysfs is mounted.
+ * @param  idx   Index of the device node.
+ * @param  links List of links to append to.
+ * @return       FALSE if the device's sysfs directory couldn't be read.
+ */
+bool topology_read_device(topology_t *topo, const char *sysfs, uint32_t idx,
+						  topology_links_t *links) {
+	topology_node_t *node = &topo->nodes[idx];
+	char path[PATH_MAX];
+	sysfs_dir_t devdir;
+	struct dirent *dir;
+	const char *str;
+	uint32_t major;
+	uint32_t minor;
+	size_t len;
+	DIR *dh;
+	int fd;
+
+	// Open the device folder.
+	snprintf(path, PATH_MAX, "%s%s%s", sysfs, TOPOLOGY_BLOCK_DIR,
+			 topology_name(topo, idx));
+	if (!sysfs_dir_open(&devdir, path)) {
+		fprintf(stderr, "Couldn't open %s to get its slaves.\n", path);
+		return false;
+	}
+
+	// Where it's mounted.
+	if (sysfs_read_dev(&devdir, "dev", &major, &minor))
+		node->mounts = mount_index_lookup(&topo->mounts, major, minor);
+
+	// What device-mapper calls it or what kind of array it is.
+	str = sysfs_read_attr(&devdir, "dm/name", &len);
+	if (str == NULL)
+		str = sysfs_read_attr(&devdir, "md/level", &len);
+	if (str != NULL) {
+		while ((len > 0) && (str[len - 1] == '\n'))
+			len--;
+		if (len > 0)
+			node->alias = strndup(str, len);
+	}
+
+	// Link it to everything it's built on top of.
+	fd = openat(devdir.fd, "slaves", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	sysfs_dir_close(&devdir);
+	if (fd == -1)
+		return true;
+	dh = fdopendir(fd);
+	if (dh == NULL) {
+		close(fd);
+		return true;
+	}
+	while ((dir = readdir(dh)) != NULL) {
+		uint32_t slave;
+
+		if (dir->d_name[0] == '.')
+			continue;
+
+		// Ignore the devices we weren't asked about.
+		slave = topology_find(topo, dir->d_name);
+		if ((slave == TOPOLOGY_NONE) || (slave == idx))
+			continue;
+
+		topology_link(links, slave, idx);
+		node->nslaves++;
+	}
+	closedir(dh);
+
+	return true;
+}
+
+/**
+ * Turns a list of links into the adjacency list of the graph, keeping the
+ * order the links were found in.
+ *
+ * @param topo  Stacking graph.
+ * @param links List of links.
+ */
+void topology_index(topology_t *topo, const topology_links_t *links) {
+	uint32_t *next;
+	uint32_t first;
+
+	// Count the children of each node and where their slices start.
+	for (uint32_t i = 0; i < links->count; i++)
+		topo->nodes[links->list[i].parent].nchildren++;
+	first = 0;
+	for (uint32_t i = 0; i < topo->count; i++) {
+		topo->nodes[i].first = first;
+		first += topo->nodes[i].nchildren;
+	}
+
+	// Fill the slices in.
+	topo->links = links->count;
+	topo->children = malloc(sizeof(uint32_t) *
+							((links->count > 0) ? links->count : 1));
+	next = malloc(sizeof(uint32_t) * ((topo->count > 0) ? topo->count : 1));
+	for (uint32_t i = 0; i < topo->count; i++)
+		next[i] = topo->nodes[i].first;
+	for (uint32_t i = 0; i < links->count; i++)
+		topo->children[next[links->list[i].parent]++] = links->list[i].child;
+	free(next);
+}
+
+/**
+ * Gets the size of a node.
+ *
+ * @param  topo Stacking graph.
+ * @param  idx  Index of the node.
+ * @return      Size in bytes.
+ */
+uint64_t topology_size(const topology_t *topo, uint32_t idx) {
+	const topology_node_t *node = &topo->nodes[idx];
+
+	return (node->part != NULL) ? node->part->size : node->sd->size;
+}
+
+/**
+ * Gets the number of places a node is mounted at.
+ *
+ * @param  topo Stacking graph.
+ * @param  idx  Index of the node.
+ * @return      Number of mount points.
+ */
+uint32_t topology_mntcount(const topology_t *topo, uint32_t idx) {
+	const topology_node_t *node = &topo->nodes[idx];
+
+	if (node->part != NULL)
+		return node->part->mntcount;
+
+	return (node->mounts != NULL) ? node->mounts->count : 0;
+}
+
+/**
+ * Gets one of the places a node is mounted at.
+ *
+ * @param  topo Stacking graph.
+ * @param  idx  Index of the node.
+ * @param  i    Index of the mount point.
+ * @return      Mount point.
+ */
+const char *topology_mntpoint(const topology_t *topo, uint32_t idx,
+							  uint32_t i) {
+	const topology_node_t *node = &topo->nodes[idx];
+
+	if (node->part != NULL)
+		return device_str(topo->container, node->part->mntpoints[i]);
+
+	return node->mounts->list[i].mntpoint;
+}
+
+/**
+ * Gets the filesystem type of a node.
+ *
+ * @param  topo Stacking graph.
+ * @param  idx  Index of the node.
+ * @return      Filesystem type or an empty string if it isn't known.
+ */
+const char *topology_type(const topology_t *topo, uint32_t idx) {
+	const topology_node_t *node = &topo->nodes[idx];
+
+	if (node->part != NULL)
+		return device_str(topo->container, node->part->type);
+	if ((node->mounts != NULL) && (node->mounts->count > 0))
+		return node->mounts->list[0].fstype;
+
+	return "";
+}
+
+/**
+ * Appends the mount points of a node as a comma-separated list.
+ *
+ * @param topo  Stacking graph.
+ * @param idx   Index of the node.
+ * @param first Is the next mount point the first one in the list?
+ * @param buf   Buffer to append to.
+ */
+void topology_format_mounts(const topology_t *topo, uint32_t idx,
+							bool *first, buffer_t *buf) {
+	for (uint32_t i = 0; i < topology_mntcount(topo, idx); i++) {
+		if (!*first)
+			buffer_append_str(buf, ", ");
+		buffer_append_str(buf, topology_mntpoint(topo, idx, i));
+		*first = false;
+	}
+}
+
+/**
+ * Appends everything that's mounted anywhere in the stack on top of a node
+ * and how much space those mounts take. Nodes that can be reached through
+ * more than one path are only counted once.
+ *
+ * @param topo  Stacking graph.
+ * @param idx   Index of the node at the bottom of the stack.
+ * @param stack Scratch space with room for every node in the graph.
+ * @param buf   Buffer to append to.
+ */
+void topology_format_rollup(topology_t *topo, uint32_t idx, uint32_t *stack,
+							buffer_t *buf) {
+	uint64_t size = 0;
+	uint32_t top = 0;
+	bool first = true;
+
+	// Walk the stack depth-first, starting from the node's children.
+	topo->stamp++;
+	topo->nodes[idx].stamp = topo->stamp;
+	stack[top++] = idx;
+	while (top > 0) {
+		const topology_node_t *node = &topo->nodes[stack[--top]];
+
+		for (uint32_t i = 0; i < node->nchildren; i++) {
+			uint32_t child = topo->children[node->first + i];
+
+			if (topo->nodes[child].stamp == topo->stamp)
+				continue;
+			topo->nodes[child].stamp = topo->stamp;
+			stack[top++] = child;
+
+			// Gather what's mounted.
+			if (topology_mntcount(topo, child) > 0) {
+				buffer_append_str(buf, first ? " \u2192 " : "");
+				topology_format_mounts(topo, child, &first, buf);
+				size += topology_size(topo, child);
+			}
+		}
+	}
+
+	// How much of the node the mounts are using.
+	if (!first) {
+		buffer_append_str(buf, " (");
+		device_format_size(buf, size);
+		buffer_append_str(buf, " mounted)");
+	}
+}
+
+/**
+ * Formats a node and everything stacked on top of it.
+ *
+ * @param topo   Stacking graph.
+ * @param idx    Index of the node.
+ * @param prefix Tree branches that come before the node.
+ * @param plen   Length of the prefix.
+ * @param last   Is it the last child of its parent?
+ * @param depth  How deep in the tree the node is.
+ * @param stack  Scratch space with room for every node in the graph.
+ * @param buf    Buffer to append to.
+ */
+void topology_format_node(topology_t *topo, uint32_t idx, char *prefix,
+						  size_t plen, bool last, uint32_t depth,
+						  uint32_t *stack, buffer_t *buf) {
+	const topology_node_t *node = &topo->nodes[idx];
+	const char *type;
+	bool first = true;
+	size_t len;
+
+	// Information with its "tree" thingy.
+	if (depth > 0) {
+		buffer_append_str(buf, prefix);
+		buffer_append_str(buf, last ? "\u2514 " : "\u251C ");
+	}
+	buffer_append_str(buf, topology_name(topo, idx));
+	if (node->alias != NULL) {
+		buffer_append_str(buf, " \"");
+		buffer_append_str(buf, node->alias);
+		buffer_append_char(buf, '"');
+	}
+	buffer_append_str(buf, ((node->part != NULL) ? node->part->ro :
+							node->sd->ro) ? " (R) " : " (R/W) ");
+	type = topology_type(topo, idx);
+	if (*type != '\0') {
+		buffer_append_char(buf, '[');
+		buffer_append_str(buf, type);
+		buffer_append_str(buf, "] ");
+	}
+	device_format_size(buf, topology_size(topo, idx));
+
+	// Where it's mounted and what's mounted on top of it.
+	if (topology_mntcount(topo, idx) > 0) {
+		buffer_append_str(buf, " on ");
+		topology_format_mounts(topo, idx, &first, buf);
+	}
+	if (node->nchildren > 0)
+		topology_format_rollup(topo, idx, stack, buf);
+	buffer_append_char(buf, '\n');
+
+	// Don't go on forever if the links somehow make a loop.
+	if ((node->nchildren == 0) || (depth == TOPOLOGY_MAX_DEPTH))
+		return;
+
+	// Continue the parent's branch for the children.
+	len = plen;
+	if (depth == 0) {
+		prefix[len++] = '\t';
+	} else if (last) {
+		prefix[len++] = '\t';
+	} else {
+		memcpy(prefix + len, "\u2502\t", 4);
+		len += 4;
+	}
+	prefix[len] = '\0';
+
+	// Everything stacked on top of it.
+	for (uint32_t i = 0; i < node->nchildren; i++) {
+		topology_format_node(topo, topo->children[node->first + i], prefix,
+							 len, i == (node->nchildren - 1), depth + 1, stack,
+							 buf);
+	}
+	prefix[plen] = '\0';
+}
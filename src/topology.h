@@ -0,0 +1,60 @@
+/**
+ * topology.h
+ * Graph of how block devices are stacked on top of each other.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _TOPOLOGY_H
+#define _TOPOLOGY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "device.h"
+#include "buffer.h"
+#include "mounts.h"
+
+// Constants.
+#define TOPOLOGY_NONE UINT32_MAX
+
+// A whole device or one of its partitions.
+typedef struct {
+	const stdev_t     *sd;
+	const partition_t *part;     // NULL for whole devices.
+	const mount_dev_t *mounts;   // Mounts of whole devices.
+	char              *alias;    // Device-mapper name or md RAID level.
+	uint32_t           nslaves;  // Devices it's built on top of.
+	uint32_t           first;    // First child in the adjacency list.
+	uint32_t           nchildren;
+	uint32_t           stamp;
+} topology_node_t;
+
+// Stacking graph of every device in a container. The children of a node are
+// its partitions followed by every device that holds it.
+typedef struct {
+	const stdev_container *container;
+	topology_node_t       *nodes;
+	uint32_t               count;
+	uint32_t              *children;
+	uint32_t               links;
+	uint32_t              *table;
+	uint32_t               table_size;
+	uint32_t               stamp;
+	mount_index_t          mounts;
+} topology_t;
+
+// Building.
+bool topology_build(topology_t *topo, const stdev_container *container,
+					const device_roots_t *roots);
+
+// Lookup.
+uint32_t topology_find(const topology_t *topo, const char *name);
+
+// Showing off.
+void topology_format(topology_t *topo, buffer_t *buf);
+
+// Clean up.
+void topology_free(topology_t *topo);
+
+#endif  //_TOPOLOGY_H
@@ -0,0 +1,161 @@
+/**
+ * udevdb.c
+ * Reads the filesystem information udev already probed for each device.
+ *
+ * Every time a block device shows up udev runs its own blkid on it and keeps
+ * the results in a small file named after the device number (b8:1 for
+ * instance) on a tmpfs. Reading that file requires no privileges and doesn't
+ * touch the device at all. Only the entries udev actually probed are used,
+ * which we can tell by the presence of either filesystem or partition entry
+ * properties, everything else is left for blkid.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "udevdb.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+
+// Constants.
+#define UDEVDB_BUF_LEN 16384
+
+// Private methods.
+void udevdb_copy_value(char *dst, const char *value, size_t len,
+					   size_t maxlen, bool encoded);
+int udevdb_hex(char c);
+
+/**
+ * Looks up the probed information of a device in the udev database.
+ *
+ * @param  dir   Path to the udev database directory.
+ * @param  major Major number of the device.
+ * @param  minor Minor number of the device.
+ * @param  info  Probed information to be populated.
+ * @return       TRUE if udev has probed the device.
+ */
+bool udevdb_lookup(const char *dir, uint32_t major, uint32_t minor,
+				   probe_info_t *info) {
+	char path[PATH_MAX];
+	char buf[UDEVDB_BUF_LEN];
+	bool probed = false;
+	bool label_enc = false;
+	bool uuid_enc = false;
+	size_t len = 0;
+	ssize_t bytes;
+	char *line;
+	char *next;
+	int fd;
+
+	// Read the database entry.
+	snprintf(path, PATH_MAX, "%s/b%u:%u", dir, major, minor);
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return false;
+	while ((len < (UDEVDB_BUF_LEN - 1)) &&
+			((bytes = read(fd, buf + len, UDEVDB_BUF_LEN - 1 - len)) > 0)) {
+		len += bytes;
+	}
+	close(fd);
+	buf[len] = '\0';
+
+	// Go through the properties.
+	memset(info, 0, sizeof(probe_info_t));
+	for (line = buf; line != NULL; line = next) {
+		char *end = strchr(line, '\n');
+		const char *key;
+		const char *value;
+		size_t vlen;
+
+		// Find the end of the line.
+		next = (end != NULL) ? end + 1 : NULL;
+		if (end == NULL)
+			end = line + strlen(line);
+
+		// Only properties (E:KEY=value) are interesting.
+		if (strncmp(line, "E:", 2) != 0)
+			continue;
+		key = line + 2;
+		value = memchr(key, '=', end - key);
+		if (value == NULL)
+			continue;
+		vlen = end - ++value;
+
+		// Probing leaves these behind even when there's no filesystem.
+		if ((strncmp(key, "ID_FS_", 6) == 0) ||
+				(strncmp(key, "ID_PART_ENTRY_", 14) == 0)) {
+			probed = true;
+		}
+
+		// Get the values we care about, preferring the encoded versions since
+		// the plain ones have their whitespace replaced.
+		if (strncmp(key, "ID_FS_TYPE=", 11) == 0) {
+			udevdb_copy_value(info->type, value, vlen, PARTITION_TYPE_MAX_LEN,
+							  false);
+		} else if (strncmp(key, "ID_FS_UUID_ENC=", 15) == 0) {
+			udevdb_copy_value(info->uuid, value, vlen, PARTITION_NAME_MAX_LEN,
+							  true);
+			uuid_enc = true;
+		} else if (!uuid_enc && (strncmp(key, "ID_FS_UUID=", 11) == 0)) {
+			udevdb_copy_value(info->uuid, value, vlen, PARTITION_NAME_MAX_LEN,
+							  false);
+		} else if (strncmp(key, "ID_FS_LABEL_ENC=", 16) == 0) {
+			udevdb_copy_value(info->label, value, vlen, PARTITION_NAME_MAX_LEN,
+							  true);
+			label_enc = true;
+		} else if (!label_enc && (strncmp(key, "ID_FS_LABEL=", 12) == 0)) {
+			udevdb_copy_value(info->label, value, vlen, PARTITION_NAME_MAX_LEN,
+							  false);
+		}
+	}
+
+	return probed;
+}
+
+/**
+ * Copies a property value, decoding the \xNN escapes of the encoded ones.
+ *
+ * @param dst     Buffer where the value will be stored.
+ * @param value   Value of the property.
+ * @param len     Length of the value.
+ * @param maxlen  Size of the buffer.
+ * @param encoded Is the value escaped?
+ */
+void udevdb_copy_value(char *dst, const char *value, size_t len,
+					   size_t maxlen, bool encoded) {
+	size_t out = 0;
+
+	for (size_t i = 0; (i < len) && (out < (maxlen - 1)); i++) {
+		if (encoded && (value[i] == '\\') && ((i + 3) < len) &&
+				(value[i + 1] == 'x') && (udevdb_hex(value[i + 2]) != -1) &&
+				(udevdb_hex(value[i + 3]) != -1)) {
+			dst[out++] = (udevdb_hex(value[i + 2]) << 4) |
+				udevdb_hex(value[i + 3]);
+			i += 3;
+			continue;
+		}
+
+		dst[out++] = value[i];
+	}
+
+	dst[out] = '\0';
+}
+
+/**
+ * Gets the value of a hexadecimal digit.
+ *
+ * @param  c Hexadecimal digit.
+ * @return   Value of the digit or -1 if it isn't one.
+ */
+int udevdb_hex(char c) {
+	if ((c >= '0') && (c <= '9'))
+		return c - '0';
+	if ((c >= 'a') && (c <= 'f'))
+		return c - 'a' + 10;
+	if ((c >= 'A') && (c <= 'F'))
+		return c - 'A' + 10;
+
+	return -1;
+}
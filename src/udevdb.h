@@ -0,0 +1,23 @@
+/**
+ * udevdb.h
+ * Reads the filesystem information udev already probed for each device.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _UDEVDB_H
+#define _UDEVDB_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "device.h"
+
+// Constants.
+#define UDEVDB_DEF_PATH "/run/udev/data"
+
+// Lookup.
+bool udevdb_lookup(const char *dir, uint32_t major, uint32_t minor,
+				   probe_info_t *info);
+
+#endif  //_UDEVDB_H
@@ -0,0 +1,255 @@
+/**
+ * uevent.c
+ * Source of kernel device events, either live from netlink or from a replay
+ * file.
+ *
+ * Replay files are plain text with one KEY=VALUE property per line and events
+ * separated by blank lines, which is what "udevadm monitor --kernel
+ * --property" prints. Lines without an equal sign (like udevadm's headers)
+ * are ignored.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "uevent.h"
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include "utils.h"
+
+// Private methods.
+int uevent_next_netlink(uevent_source_t *src, uevent_t *ev, int timeout);
+int uevent_next_replay(uevent_source_t *src, uevent_t *ev);
+void uevent_init(uevent_t *ev);
+
+/**
+ * Opens a netlink socket that receives the kernel's device events.
+ *
+ * @param  src Event source to be initialized.
+ * @return     TRUE if the socket was opened.
+ */
+bool uevent_open_netlink(uevent_source_t *src) {
+	struct sockaddr_nl addr;
+
+	src->replay = NULL;
+	src->fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC,
+					 NETLINK_KOBJECT_UEVENT);
+	if (src->fd == -1) {
+		fprintf(stderr, "Couldn't create the uevent netlink socket.\n");
+		return false;
+	}
+
+	// Subscribe to the kernel's event group.
+	memset(&addr, 0, sizeof(struct sockaddr_nl));
+	addr.nl_family = AF_NETLINK;
+	addr.nl_pid = 0;
+	addr.nl_groups = 1;
+	if (bind(src->fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+		fprintf(stderr, "Couldn't bind the uevent netlink socket.\n");
+		close(src->fd);
+		src->fd = -1;
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Opens a file with recorded device events to be replayed.
+ *
+ * @param  src  Event source to be initialized.
+ * @param  path Path to the replay file.
+ * @return      TRUE if the file was opened.
+ */
+bool uevent_open_replay(uevent_source_t *src, const char *path) {
+	src->fd = -1;
+	src->replay = fopen(path, "r");
+	if (src->replay == NULL) {
+		fprintf(stderr, "Couldn't open the uevent replay file %s.\n", path);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Closes an event source.
+ *
+ * @param src Event source to be closed.
+ */
+void uevent_close(uevent_source_t *src) {
+	if (src->fd != -1)
+		close(src->fd);
+	if (src->replay != NULL)
+		fclose(src->replay);
+
+	src->fd = -1;
+	src->replay = NULL;
+}
+
+/**
+ * Waits for the next device event.
+ *
+ * @param  src     Event source.
+ * @param  ev      Event structure to be populated.
+ * @param  timeout How long to wait in milliseconds. (-1 to wait forever)
+ * @return         1 if an event was read, 0 on timeout, -1 if the source has
+ *                 ended or failed.
+ */
+int uevent_next(uevent_source_t *src, uevent_t *ev, int timeout) {
+	if (src->replay != NULL)
+		return uevent_next_replay(src, ev);
+
+	return uevent_next_netlink(src, ev, timeout);
+}
+
+/**
+ * Parses a single KEY=VALUE property into an event.
+ *
+ * @param ev   Event structure to be populated.
+ * @param prop Property string.
+ */
+void uevent_parse_property(uevent_t *ev, const char *prop) {
+	if (strncmp(prop, "ACTION=", 7) == 0) {
+		prop += 7;
+		if (strcmp(prop, "add") == 0) {
+			ev->action = UEVENT_ADD;
+		} else if (strcmp(prop, "remove") == 0) {
+			ev->action = UEVENT_REMOVE;
+		} else if (strcmp(prop, "change") == 0) {
+			ev->action = UEVENT_CHANGE;
+		} else {
+			ev->action = UEVENT_OTHER;
+		}
+	} else if (strncmp(prop, "DEVPATH=", 8) == 0) {
+		strncpy(ev->devpath, prop + 8, DEVICE_PATH_MAX_LEN - 1);
+	} else if (strncmp(prop, "DEVNAME=", 8) == 0) {
+		// Strip the /dev/ prefix if there's one.
+		prop += 8;
+		if (strncmp(prop, "/dev/", 5) == 0)
+			prop += 5;
+		strncpy(ev->devname, prop, PARTITION_NAME_MAX_LEN - 1);
+	} else if (strncmp(prop, "DEVTYPE=", 8) == 0) {
+		strncpy(ev->devtype, prop + 8, PARTITION_TYPE_MAX_LEN - 1);
+	} else if (strncmp(prop, "SUBSYSTEM=", 10) == 0) {
+		strncpy(ev->subsystem, prop + 10, PARTITION_TYPE_MAX_LEN - 1);
+	} else if (strncmp(prop, "MAJOR=", 6) == 0) {
+		size_t num;
+		if (parse_num(prop + 6, &num) != NULL)
+			ev->major = num;
+	} else if (strncmp(prop, "MINOR=", 6) == 0) {
+		size_t num;
+		if (parse_num(prop + 6, &num) != NULL)
+			ev->minor = num;
+	}
+}
+
+/**
+ * Gets the name of the parent device of a partition event from its device
+ * path. (/devices/.../block/sda/sda1 has sda as its parent)
+ *
+ * @param  ev   Partition event.
+ * @param  name Buffer with at least PARTITION_NAME_MAX_LEN bytes.
+ * @return      The parent name or NULL if the path didn't have one.
+ */
+const char *uevent_parent_name(const uevent_t *ev, char *name) {
+	const char *end;
+	const char *start;
+
+	// Find the last two components of the path.
+	end = strrchr(ev->devpath, '/');
+	if ((end == NULL) || (end == ev->devpath))
+		return NULL;
+	start = end - 1;
+	while ((start > ev->devpath) && (*start != '/'))
+		start--;
+	if (*start == '/')
+		start++;
+
+	// Copy the parent.
+	if ((size_t)(end - start) >= PARTITION_NAME_MAX_LEN)
+		return NULL;
+	memcpy(name, start, end - start);
+	name[end - start] = '\0';
+
+	return name;
+}
+
+/**
+ * Reads the next event from the netlink socket.
+ *
+ * @param  src     Event source.
+ * @param  ev      Event structure to be populated.
+ * @param  timeout How long to wait in milliseconds. (-1 to wait forever)
+ * @return         1 if an event was read, 0 on timeout, -1 on failure.
+ */
+int uevent_next_netlink(uevent_source_t *src, uevent_t *ev, int timeout) {
+	struct pollfd pfd;
+	ssize_t len;
+	int ret;
+
+	// Wait for something to happen.
+	pfd.fd = src->fd;
+	pfd.events = POLLIN;
+	ret = poll(&pfd, 1, timeout);
+	if (ret <= 0)
+		return (ret == 0) ? 0 : -1;
+
+	// Grab the message.
+	len = recv(src->fd, src->buf, UEVENT_BUF_LEN - 1, 0);
+	if (len <= 0)
+		return -1;
+	src->buf[len] = '\0';
+
+	// Parse the NULL-separated properties, skipping the "action@path" header.
+	uevent_init(ev);
+	for (ssize_t i = 0; i < len; i += strlen(src->buf + i) + 1)
+		uevent_parse_property(ev, src->buf + i);
+
+	return 1;
+}
+
+/**
+ * Reads the next event from a replay file.
+ *
+ * @param  src Event source.
+ * @param  ev  Event structure to be populated.
+ * @return     1 if an event was read, -1 if the file has ended.
+ */
+int uevent_next_replay(uevent_source_t *src, uevent_t *ev) {
+	bool found = false;
+
+	uevent_init(ev);
+	while (fgets(src->buf, UEVENT_BUF_LEN, src->replay) != NULL) {
+		// Strip the line ending.
+		src->buf[strcspn(src->buf, "\r\n")] = '\0';
+
+		// Blank lines end an event.
+		if (src->buf[0] == '\0') {
+			if (found)
+				return 1;
+			continue;
+		}
+
+		// Ignore anything that isn't a property.
+		if (strchr(src->buf, '=') == NULL)
+			continue;
+
+		uevent_parse_property(ev, src->buf);
+		found = true;
+	}
+
+	return found ? 1 : -1;
+}
+
+/**
+ * Initializes an empty event.
+ *
+ * @param ev Event structure to be initialized.
+ */
+void uevent_init(uevent_t *ev) {
+	memset(ev, 0, sizeof(uevent_t));
+	ev->action = UEVENT_OTHER;
+}
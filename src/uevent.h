@@ -0,0 +1,57 @@
+/**
+ * uevent.h
+ * Source of kernel device events, either live from netlink or from a replay
+ * file.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _UEVENT_H
+#define _UEVENT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "device.h"
+
+// Constants.
+#define UEVENT_BUF_LEN 8192
+
+// Device event actions we care about.
+typedef enum {
+	UEVENT_ADD,
+	UEVENT_REMOVE,
+	UEVENT_CHANGE,
+	UEVENT_OTHER
+} uevent_action_t;
+
+// Single device event.
+typedef struct {
+	uevent_action_t action;
+	char     devpath[DEVICE_PATH_MAX_LEN];
+	char     devname[PARTITION_NAME_MAX_LEN];
+	char     devtype[PARTITION_TYPE_MAX_LEN];
+	char     subsystem[PARTITION_TYPE_MAX_LEN];
+	uint32_t major;
+	uint32_t minor;
+} uevent_t;
+
+// Event source.
+typedef struct {
+	int   fd;
+	FILE *replay;
+	char  buf[UEVENT_BUF_LEN];
+} uevent_source_t;
+
+// Opening and closing.
+bool uevent_open_netlink(uevent_source_t *src);
+bool uevent_open_replay(uevent_source_t *src, const char *path);
+void uevent_close(uevent_source_t *src);
+
+// Reading.
+int uevent_next(uevent_source_t *src, uevent_t *ev, int timeout);
+void uevent_parse_property(uevent_t *ev, const char *prop);
+const char *uevent_parent_name(const uevent_t *ev, char *name);
+
+#endif  //_UEVENT_H
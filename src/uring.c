@@ -0,0 +1,285 @@
+/**
+ * uring.c
+ * Bare bones io_uring ring for submitting batches of file operations.
+ *
+ * Talks to the kernel directly through the system calls instead of pulling
+ * liburing in, since all we ever do is fill the submission queue, submit it
+ * and wait for every completion to come back.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "uring.h"
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// Private methods.
+int uring_setup(unsigned entries, struct io_uring_params *params);
+int uring_enter(int fd, unsigned submit, unsigned wait);
+unsigned uring_ready(const uring_t *ring);
+bool uring_supports(int fd, const uint8_t *ops, size_t nops);
+
+/**
+ * Sets up a ring. Fails when the kernel doesn't have io_uring, it was
+ * disabled or it doesn't know every operation we need, in which case the ring
+ * must not be used.
+ *
+ * @param  ring    Ring to be initialized.
+ * @param  entries Maximum number of operations in a single submission.
+ * @param  ops     Operations that will be submitted. (IORING_OP_*)
+ * @param  nops    Number of operations.
+ * @return         TRUE if the ring is ready to be used.
+ */
+bool uring_init(uring_t *ring, unsigned entries, const uint8_t *ops,
+				size_t nops) {
+	struct io_uring_params params;
+	uint8_t *sq;
+	uint8_t *cq;
+
+	memset(ring, 0, sizeof(uring_t));
+	memset(&params, 0, sizeof(struct io_uring_params));
+
+	// Create the ring.
+	ring->fd = uring_setup(entries, &params);
+	if (ring->fd == -1)
+		return false;
+	ring->entries = params.sq_entries;
+
+	// Early kernels have the ring but none of the file operations, which
+	// would make every single one of them fail.
+	if (!uring_supports(ring->fd, ops, nops)) {
+		uring_free(ring);
+		return false;
+	}
+
+	// Map the queues, which might share a single mapping.
+	ring->sq_len = params.sq_off.array +
+		(params.sq_entries * sizeof(unsigned));
+	ring->cq_len = params.cq_off.cqes +
+		(params.cq_entries * sizeof(struct io_uring_cqe));
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		if (ring->cq_len > ring->sq_len)
+			ring->sq_len = ring->cq_len;
+		ring->cq_len = 0;
+	}
+	ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE,
+						MAP_SHARED | MAP_POPULATE, ring->fd,
+						IORING_OFF_SQ_RING);
+	if (ring->sq_ptr == MAP_FAILED) {
+		ring->sq_ptr = NULL;
+		uring_free(ring);
+		return false;
+	}
+	if (ring->cq_len == 0) {
+		ring->cq_ptr = ring->sq_ptr;
+	} else {
+		ring->cq_ptr = mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE,
+							MAP_SHARED | MAP_POPULATE, ring->fd,
+							IORING_OFF_CQ_RING);
+		if (ring->cq_ptr == MAP_FAILED) {
+			ring->cq_ptr = NULL;
+			uring_free(ring);
+			return false;
+		}
+	}
+	ring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE,
+					  MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED) {
+		ring->sqes = NULL;
+		uring_free(ring);
+		return false;
+	}
+
+	// Get the pointers to the queue fields.
+	sq = (uint8_t *)ring->sq_ptr;
+	ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+	ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+	ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+	ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+	cq = (uint8_t *)ring->cq_ptr;
+	ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+	ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+	ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+	return true;
+}
+
+/**
+ * Gets the next free submission queue entry.
+ *
+ * @param  ring Ring to submit to.
+ * @return      Cleared entry to be filled or NULL if the queue is full and has
+ *              to be submitted first.
+ */
+struct io_uring_sqe *uring_get_sqe(uring_t *ring) {
+	struct io_uring_sqe *sqe;
+	unsigned tail;
+	unsigned idx;
+
+	// Check if there's still space for it.
+	if (ring->queued >= ring->entries)
+		return NULL;
+
+	// Get the entry and put it in the queue.
+	tail = *ring->sq_tail + ring->queued;
+	idx = tail & *ring->sq_mask;
+	sqe = &ring->sqes[idx];
+	memset(sqe, 0, sizeof(struct io_uring_sqe));
+	ring->sq_array[idx] = idx;
+	ring->queued++;
+
+	return sqe;
+}
+
+/**
+ * Submits every queued entry and waits for all of them to complete.
+ *
+ * @param  ring Ring to submit.
+ * @return      TRUE if everything was submitted and completed.
+ */
+bool uring_submit_wait(uring_t *ring) {
+	unsigned count = ring->queued;
+	unsigned submitted = 0;
+	int ret;
+
+	if (count == 0)
+		return true;
+
+	// Let the kernel see the new entries.
+	__atomic_store_n(ring->sq_tail, *ring->sq_tail + count, __ATOMIC_RELEASE);
+	ring->queued = 0;
+
+	// Submit and wait until all of them have completed.
+	while (true) {
+		ret = uring_enter(ring->fd, count - submitted, count);
+		if (ret == -1) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+
+		submitted += ret;
+		if ((submitted == count) && (uring_ready(ring) >= count))
+			return true;
+	}
+}
+
+/**
+ * Pops the next completion off the queue.
+ *
+ * @param  ring Ring to get the completion from.
+ * @param  data Pointer to the user data of the completed entry.
+ * @param  res  Pointer to the result of the operation.
+ * @return      TRUE if there was a completion in the queue.
+ */
+bool uring_next_cqe(uring_t *ring, uint64_t *data, int32_t *res) {
+	const struct io_uring_cqe *cqe;
+	unsigned head;
+
+	// Check if there's anything in the queue.
+	head = *ring->cq_head;
+	if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+		return false;
+
+	// Get it and let the kernel reuse the slot.
+	cqe = &ring->cqes[head & *ring->cq_mask];
+	*data = cqe->user_data;
+	*res = cqe->res;
+	__atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+/**
+ * Gets the number of completions waiting in the queue.
+ *
+ * @param  ring Ring to check.
+ * @return      Number of completions that can be popped.
+ */
+unsigned uring_ready(const uring_t *ring) {
+	return __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE) - *ring->cq_head;
+}
+
+/**
+ * Tears a ring down.
+ *
+ * @param ring Ring to be freed.
+ */
+void uring_free(uring_t *ring) {
+	if (ring->sqes != NULL)
+		munmap(ring->sqes, ring->sqes_len);
+	if ((ring->cq_ptr != NULL) && (ring->cq_ptr != ring->sq_ptr))
+		munmap(ring->cq_ptr, ring->cq_len);
+	if (ring->sq_ptr != NULL)
+		munmap(ring->sq_ptr, ring->sq_len);
+	if (ring->fd != -1)
+		close(ring->fd);
+
+	memset(ring, 0, sizeof(uring_t));
+	ring->fd = -1;
+}
+
+/**
+ * Wrapper around the io_uring_setup system call.
+ *
+ * @param  entries Number of submission queue entries.
+ * @param  params  Ring parameters.
+ * @return         Ring file descriptor or -1 on error.
+ */
+int uring_setup(unsigned entries, struct io_uring_params *params) {
+	return syscall(__NR_io_uring_setup, entries, params);
+}
+
+/**
+ * Wrapper around the io_uring_enter system call.
+ *
+ * @param  fd     Ring file descriptor.
+ * @param  submit Number of entries to submit.
+ * @param  wait   Number of completions to wait for.
+ * @return        Number of entries submitted or -1 on error.
+ */
+int uring_enter(int fd, unsigned submit, unsigned wait) {
+	return syscall(__NR_io_uring_enter, fd, submit, wait,
+				   (wait > 0) ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+}
+
+/**
+ * Checks if the kernel supports a set of operations. Kernels that can't even
+ * be asked don't have any of the file operations either.
+ *
+ * @param  fd   File descriptor of the ring.
+ * @param  ops  Operations to check. (IORING_OP_*)
+ * @param  nops Number of operations.
+ * @return      TRUE if every operation is supported.
+ */
+bool uring_supports(int fd, const uint8_t *ops, size_t nops) {
+	struct io_uring_probe *probe;
+	size_t len;
+	bool supported = true;
+
+	// Ask the kernel about every operation it could possibly know.
+	len = sizeof(struct io_uring_probe) +
+		(URING_PROBE_OPS * sizeof(struct io_uring_probe_op));
+	probe = calloc(1, len);
+	if (probe == NULL)
+		return false;
+	if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe,
+				URING_PROBE_OPS) == -1) {
+		free(probe);
+		return false;
+	}
+
+	// Check the ones we need. An 8-bit opcode always fits in the probe.
+	for (size_t i = 0; supported && (i < nops); i++) {
+		supported = (ops[i] <= probe->last_op) &&
+			(probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED);
+	}
+
+	free(probe);
+	return supported;
+}
@@ -0,0 +1,61 @@
+/**
+ * uring.h
+ * Bare bones io_uring ring for submitting batches of file operations.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _URING_H
+#define _URING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <linux/io_uring.h>
+
+// Constants.
+#define URING_DEF_ENTRIES 128
+#define URING_PROBE_OPS   256
+
+// Submission and completion rings shared with the kernel.
+typedef struct {
+	int       fd;
+	unsigned  entries;
+	unsigned  queued;
+
+	// Submission queue.
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	struct io_uring_sqe *sqes;
+
+	// Completion queue.
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+
+	// Mappings.
+	void     *sq_ptr;
+	size_t    sq_len;
+	void     *cq_ptr;
+	size_t    cq_len;
+	size_t    sqes_len;
+} uring_t;
+
+// Initialization.
+bool uring_init(uring_t *ring, unsigned entries, const uint8_t *ops,
+				size_t nops);
+
+// Submission.
+struct io_uring_sqe *uring_get_sqe(uring_t *ring);
+bool uring_submit_wait(uring_t *ring);
+
+// Completion.
+bool uring_next_cqe(uring_t *ring, uint64_t *data, int32_t *res);
+
+// Clean up.
+void uring_free(uring_t *ring);
+
+#endif  //_URING_H
@@ -8,53 +8,268 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "utils.h"
 
 #define MAX_BYTE_UNIT_SIZE 1000000000000
+#define FREAD_BUF_LEN      64
+
+// Single precision float emulation constants.
+#define SOFTFLOAT_MANT_BITS 24
+#define SOFTFLOAT_DIV_SHIFT 40
+
+// Single precision float emulated with integers. (mant * 2^exp)
+typedef struct {
+	uint64_t mant;
+	int      exp;
+} softfloat_t;
+
+// Private methods.
+softfloat_t softfloat_round(uint64_t num, int exp, bool sticky);
+softfloat_t softfloat_from_uint(uint64_t num);
+softfloat_t softfloat_div(softfloat_t a, softfloat_t b);
+bool softfloat_less(softfloat_t a, softfloat_t b);
+uint64_t softfloat_hundredths(softfloat_t f);
 
 /**
- * Grabs a size in bytes and converts it into a smaller float and a unit
- * character. The function determines the best unit for the given size.
+ * Grabs a size in bytes and converts it into a smaller number with two
+ * decimal places and a unit character. The function determines the best unit
+ * for the given size.
  *
- * @param size Size in bytes.
- * @param num  Smaller number as a float.
- * @param unit Unit character.
+ * This used to be done with floats and printf, so to keep the output exactly
+ * the same the single precision division and printf's rounding are emulated
+ * with integers, which is still a lot cheaper than the real thing.
+ *
+ * @param size       Size in bytes.
+ * @param hundredths Smaller number multiplied by 100.
+ * @param unit       Unit character.
  */
-void pretty_bytes(const size_t size, float *num, char *unit) {
-	float simp = 0.0f;
+void pretty_bytes(const uint64_t size, uint64_t *hundredths, char *unit) {
+	const char units[] = "BKMGT";
+	softfloat_t thousand = softfloat_from_uint(1000);
+	softfloat_t bytes = softfloat_from_uint(size);
+	softfloat_t simp;
+	uint64_t i = 1;
 
-	for (size_t i = 1; i <= MAX_BYTE_UNIT_SIZE; i *= 1000) {
-		simp = (float)size / (float)i;
+	for (int u = 0; ; u++, i *= 1000) {
+		simp = softfloat_div(bytes, softfloat_from_uint(i));
 
 		// Found the appropriate magnitude.
-		if ((simp < 1000.0f) || (i == MAX_BYTE_UNIT_SIZE)) {
-			// Put the simplified number into the pointer.
-			*num = simp;
-
-			// Set the unit character.
-			switch (i) {
-			case 1:
-				*unit = 'B';
-				break;
-			case 1000:
-				*unit = 'K';
-				break;
-			case 1000000:
-				*unit = 'M';
-				break;
-			case 1000000000:
-				*unit = 'G';
-				break;
-			case 1000000000000:
-				*unit = 'T';
-				break;
-			}
-
+		if (softfloat_less(simp, thousand) || (i == MAX_BYTE_UNIT_SIZE)) {
+			*hundredths = softfloat_hundredths(simp);
+			*unit = units[u];
 			break;
 		}
 	}
 }
 
+/**
+ * Rounds a number to the nearest single precision float, ties to even.
+ *
+ * @param  num    Number to be rounded. (num * 2^exp)
+ * @param  exp    Binary exponent of the number.
+ * @param  sticky Are there any bits below the number that got lost?
+ * @return        Emulated float with a normalized mantissa.
+ */
+softfloat_t softfloat_round(uint64_t num, int exp, bool sticky) {
+	softfloat_t f = { 0, 0 };
+	uint64_t rem;
+	uint64_t half;
+	int shift;
+	int bits;
+
+	if (num == 0)
+		return f;
+
+	// Normalize small numbers.
+	bits = 64 - __builtin_clzll(num);
+	if (bits <= SOFTFLOAT_MANT_BITS) {
+		f.mant = num << (SOFTFLOAT_MANT_BITS - bits);
+		f.exp = exp - (SOFTFLOAT_MANT_BITS - bits);
+		return f;
+	}
+
+	// Drop the extra bits rounding to the nearest, ties to even.
+	shift = bits - SOFTFLOAT_MANT_BITS;
+	rem = num & ((1ULL << shift) - 1);
+	half = 1ULL << (shift - 1);
+	f.mant = num >> shift;
+	f.exp = exp + shift;
+	if ((rem > half) || ((rem == half) && (sticky || (f.mant & 1))))
+		f.mant++;
+
+	// Rounding might have carried over into a new bit.
+	if (f.mant == (1ULL << SOFTFLOAT_MANT_BITS)) {
+		f.mant >>= 1;
+		f.exp++;
+	}
+
+	return f;
+}
+
+/**
+ * Converts an integer into an emulated single precision float.
+ *
+ * @param  num Integer to be converted.
+ * @return     Emulated float.
+ */
+softfloat_t softfloat_from_uint(uint64_t num) {
+	return softfloat_round(num, 0, false);
+}
+
+/**
+ * Divides two emulated single precision floats.
+ *
+ * @param  a Dividend.
+ * @param  b Divisor, which must not be zero.
+ * @return   Correctly rounded quotient.
+ */
+softfloat_t softfloat_div(softfloat_t a, softfloat_t b) {
+	uint64_t num = a.mant << SOFTFLOAT_DIV_SHIFT;
+
+	return softfloat_round(num / b.mant, a.exp - b.exp - SOFTFLOAT_DIV_SHIFT,
+						   (num % b.mant) != 0);
+}
+
+/**
+ * Checks if an emulated float is smaller than another.
+ *
+ * @param  a Emulated float.
+ * @param  b Emulated float to compare against.
+ * @return   TRUE if a < b.
+ */
+bool softfloat_less(softfloat_t a, softfloat_t b) {
+	if ((a.mant == 0) || (b.mant == 0))
+		return a.mant < b.mant;
+
+	return (a.exp < b.exp) || ((a.exp == b.exp) && (a.mant < b.mant));
+}
+
+/**
+ * Gets the value of an emulated float multiplied by 100 and rounded to the
+ * nearest integer, ties to even, just like printf's "%.2f" would.
+ *
+ * @param  f Emulated float.
+ * @return   Value in hundredths.
+ */
+uint64_t softfloat_hundredths(softfloat_t f) {
+	uint64_t num = f.mant * 100;
+	uint64_t hundredths;
+	uint64_t rem;
+	uint64_t half;
+	int shift;
+
+	if (f.exp >= 0)
+		return num << f.exp;
+
+	shift = -f.exp;
+	if (shift >= 64)
+		return 0;
+
+	hundredths = num >> shift;
+	rem = num & ((1ULL << shift) - 1);
+	half = 1ULL << (shift - 1);
+	if ((rem > half) || ((rem == half) && (hundredths & 1)))
+		hundredths++;
+
+	return hundredths;
+}
+
+/**
+ * Parses an unsigned decimal number at the beginning of a string. Leading
+ * whitespace is skipped.
+ *
+ * @param  str String to be parsed.
+ * @param  num Pointer to the number found in the string.
+ * @return     Pointer to the character right after the number or NULL if there
+ *             wasn't a valid number.
+ */
+const char *parse_num(const char *str, size_t *num) {
+	const char *cur = str;
+	size_t val = 0;
+
+	// Skip any leading whitespace.
+	while ((*cur == ' ') || (*cur == '\t') || (*cur == '\n'))
+		cur++;
+
+	// We need at least a digit.
+	if ((*cur < '0') || (*cur > '9'))
+		return NULL;
+
+	// Accumulate the digits.
+	while ((*cur >= '0') && (*cur <= '9')) {
+		size_t digit = *cur - '0';
+
+		// Check for overflows.
+		if (val > ((SIZE_MAX - digit) / 10))
+			return NULL;
+
+		val = (val * 10) + digit;
+		cur++;
+	}
+
+	*num = val;
+	return cur;
+}
+
+/**
+ * Parses a device number in the "major:minor" format.
+ *
+ * @param  str   String to be parsed.
+ * @param  major Pointer to the major number found in the string.
+ * @param  minor Pointer to the minor number found in the string.
+ * @return       Pointer to the character right after the device number or NULL
+ *               if there wasn't a valid one.
+ */
+const char *parse_dev(const char *str, uint32_t *major, uint32_t *minor) {
+	size_t maj;
+	size_t min;
+
+	// Major number.
+	str = parse_num(str, &maj);
+	if ((str == NULL) || (*str != ':') || (maj > UINT32_MAX))
+		return NULL;
+
+	// Minor number.
+	str = parse_num(str + 1, &min);
+	if ((str == NULL) || (min > UINT32_MAX))
+		return NULL;
+
+	*major = maj;
+	*minor = min;
+	return str;
+}
+
+/**
+ * Reads the beginning of a small file into a buffer.
+ *
+ * @param  fpath File path.
+ * @param  buf   Buffer to hold the contents of the file.
+ * @param  len   Size of the buffer.
+ * @return       TRUE if the file was read.
+ */
+bool freadbuf(const char *fpath, char *buf, size_t len) {
+	ssize_t bytes;
+	int fd;
+
+	// Open the file.
+	fd = open(fpath, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		fprintf(stderr, "Couldn't open %s.\n", fpath);
+		return false;
+	}
+
+	// Read and terminate the string.
+	bytes = read(fd, buf, len - 1);
+	close(fd);
+	if (bytes < 0)
+		return false;
+	buf[bytes] = '\0';
+
+	return true;
+}
+
 /**
  * Reads a number from a file that only contains it.
  *
@@ -63,21 +278,28 @@ void pretty_bytes(const size_t size, float *num, char *unit) {
  * @return       TRUE if the parsing was successful.
  */
 bool freadnum(const char *fpath, size_t *num) {
-	FILE *fh;
-	bool success = false;
+	char buf[FREAD_BUF_LEN];
 
-	// Open the file.
-	fh = fopen(fpath, "r");
-	if (fh == NULL) {
-		fprintf(stderr, "Couldn't open %s.\n", fpath);
+	if (!freadbuf(fpath, buf, FREAD_BUF_LEN))
 		return false;
-	}
 
-	// Read the number from the file.
-	success = (fscanf(fh, "%zu[^\n]", num) == 1);
+	return parse_num(buf, num) != NULL;
+}
+
+/**
+ * Reads a device number in the "major:minor" format from a file that only
+ * contains it.
+ *
+ * @param  fpath File path.
+ * @param  major Pointer to the major number found in the file.
+ * @param  minor Pointer to the minor number found in the file.
+ * @return       TRUE if the parsing was successful.
+ */
+bool freaddev(const char *fpath, uint32_t *major, uint32_t *minor) {
+	char buf[FREAD_BUF_LEN];
+
+	if (!freadbuf(fpath, buf, FREAD_BUF_LEN))
+		return false;
 
-	// Clean up.
-	fclose(fh);
-	fh = NULL;
-	return success;
+	return parse_dev(buf, major, minor) != NULL;
 }
@@ -9,8 +9,14 @@
 #define _UTILS_H_
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
 
-void pretty_bytes(const size_t size, float *num, char *unit);
+void pretty_bytes(const uint64_t size, uint64_t *hundredths, char *unit);
+const char *parse_num(const char *str, size_t *num);
+const char *parse_dev(const char *str, uint32_t *major, uint32_t *minor);
+bool freadbuf(const char *fpath, char *buf, size_t len);
 bool freadnum(const char *fpath, size_t *num);
+bool freaddev(const char *fpath, uint32_t *major, uint32_t *minor);
 
 #endif /* _UTILS_H_ */
@@ -0,0 +1,164 @@
+/**
+ * watch.c
+ * Keeps a device container up to date using kernel device events.
+ *
+ * Instead of rescanning everything whenever something happens, only the
+ * device that an event refers to (or the parent of a partition) gets reloaded
+ * and replaced in the container.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "watch.h"
+#include <stdio.h>
+#include <string.h>
+#include "linux.h"
+
+// Compact the container after this many devices were dropped from it.
+#define WATCH_COMPACT_THRESHOLD 64
+
+// Private methods.
+void watch_print_change(const stdev_container *container, watch_change_t change,
+						const char *name, const bool pretty);
+
+/**
+ * Prints the current devices and then keeps printing the changes to them as
+ * device events come in, until the event source ends.
+ *
+ * @param  container Storage device container with the current devices.
+ * @param  opts      Population options.
+ * @param  src       Device event source.
+ * @param  pretty    FALSE will print everything we have on the devices.
+ * @return           TRUE if the event source ended cleanly.
+ */
+bool watch_devices(stdev_container *container, const populate_opts_t *opts,
+				   uevent_source_t *src, const bool pretty) {
+	char name[PARTITION_NAME_MAX_LEN];
+	unsigned int garbage = 0;
+	watch_change_t change;
+	uevent_t ev;
+	int ret;
+
+	// Print the initial state.
+	for (uint32_t i = 0; i < container->count; i++)
+		device_print_info(container, &container->list[i], pretty);
+	fflush(stdout);
+
+	// Process the events.
+	while ((ret = uevent_next(src, &ev, -1)) >= 0) {
+		if (ret == 0)
+			continue;
+
+		// Apply the event and let everyone know what changed.
+		change = watch_apply(container, opts, &ev, name);
+		if (change != WATCH_NONE) {
+			watch_print_change(container, change, name, pretty);
+			fflush(stdout);
+		}
+
+		// Reclaim the memory of the devices that were dropped or reloaded.
+		if (change != WATCH_ADDED)
+			garbage++;
+		if (garbage >= WATCH_COMPACT_THRESHOLD) {
+			device_container_compact(container);
+			garbage = 0;
+		}
+	}
+
+	return src->replay != NULL;
+}
+
+/**
+ * Applies a device event to the container.
+ *
+ * @param  container Storage device container.
+ * @param  opts      Population options.
+ * @param  ev        Device event.
+ * @param  name      Buffer with at least PARTITION_NAME_MAX_LEN bytes that
+ *                   will hold the name of the affected device.
+ * @return           What happened to the container.
+ */
+watch_change_t watch_apply(stdev_container *container,
+						   const populate_opts_t *opts, const uevent_t *ev,
+						   char *name) {
+	stdev_t *existing;
+	stdev_t sd;
+
+	// We only care about block devices.
+	if ((strcmp(ev->subsystem, "block") != 0) || (ev->action == UEVENT_OTHER))
+		return WATCH_NONE;
+
+	// Partition events are changes to their parent device.
+	if (strcmp(ev->devtype, "partition") == 0) {
+		if (uevent_parent_name(ev, name) == NULL)
+			return WATCH_NONE;
+	} else {
+		strncpy(name, ev->devname, PARTITION_NAME_MAX_LEN - 1);
+		name[PARTITION_NAME_MAX_LEN - 1] = '\0';
+	}
+	existing = device_list_find(container, name);
+
+	// Disk is gone.
+	if ((ev->action == UEVENT_REMOVE) && (strcmp(ev->devtype, "disk") == 0)) {
+		if (existing == NULL)
+			return WATCH_NONE;
+
+		device_list_remove(container, existing);
+		return WATCH_REMOVED;
+	}
+
+	// Reload the device.
+	if (!populate_device(container, name, opts, &sd)) {
+		// It's not a valid device anymore.
+		if (existing != NULL) {
+			device_list_remove(container, existing);
+			return WATCH_REMOVED;
+		}
+
+		return WATCH_NONE;
+	}
+
+	// New device.
+	if (existing == NULL) {
+		device_list_push(container, &sd);
+		return WATCH_ADDED;
+	}
+
+	// Nothing really changed.
+	if (device_equal(container, existing, container, &sd))
+		return WATCH_NONE;
+
+	*existing = sd;
+	return WATCH_CHANGED;
+}
+
+/**
+ * Prints a change that was applied to the container.
+ *
+ * @param container Storage device container.
+ * @param change    What happened to the device.
+ * @param name      Name of the affected device.
+ * @param pretty    FALSE will print everything we have on the device.
+ */
+void watch_print_change(const stdev_container *container, watch_change_t change,
+						const char *name, const bool pretty) {
+	const stdev_t *sd;
+
+	switch (change) {
+	case WATCH_ADDED:
+		printf("+ %s\n", name);
+		break;
+	case WATCH_REMOVED:
+		printf("- %s\n\n", name);
+		return;
+	case WATCH_CHANGED:
+		printf("~ %s\n", name);
+		break;
+	default:
+		return;
+	}
+
+	sd = device_list_find(container, name);
+	if (sd != NULL)
+		device_print_info(container, sd, pretty);
+}
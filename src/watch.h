@@ -0,0 +1,30 @@
+/**
+ * watch.h
+ * Keeps a device container up to date using kernel device events.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _WATCH_H
+#define _WATCH_H
+
+#include <stdbool.h>
+#include "device.h"
+#include "uevent.h"
+
+// Kind of change applied to the container.
+typedef enum {
+	WATCH_NONE,
+	WATCH_ADDED,
+	WATCH_REMOVED,
+	WATCH_CHANGED
+} watch_change_t;
+
+// Watching.
+bool watch_devices(stdev_container *container, const populate_opts_t *opts,
+				   uevent_source_t *src, const bool pretty);
+watch_change_t watch_apply(stdev_container *container,
+						   const populate_opts_t *opts, const uevent_t *ev,
+						   char *name);
+
+#endif  //_WATCH_H
@@ -0,0 +1,111 @@
+/**
+ * workers.c
+ * Tiny fixed-size pool of worker threads for running independent tasks.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include "workers.h"
+#include <stdio.h>
+#include <pthread.h>
+
+// Shared state of a pool run.
+typedef struct {
+	pthread_mutex_t lock;
+	size_t next;
+	size_t ntasks;
+	worker_func_t func;
+	void *arg;
+} workers_queue_t;
+
+// Private methods.
+void *worker_loop(void *data);
+
+/**
+ * Runs a set of tasks on a fixed pool of worker threads and waits for all of
+ * them to finish. Tasks are handed out in index order, so each one should only
+ * touch its own slot of the data to keep the results in a fixed order.
+ *
+ * @param  ntasks   Number of tasks to run.
+ * @param  nworkers Number of worker threads to use.
+ * @param  func     Function that will be called for every task.
+ * @param  arg      User data that is passed along to the task function.
+ * @return          TRUE if every task was executed.
+ */
+bool workers_run(size_t ntasks, unsigned int nworkers, worker_func_t func,
+				 void *arg) {
+	workers_queue_t queue;
+	pthread_t *threads;
+	unsigned int started;
+
+	// Don't spawn more threads than we have work for.
+	if (nworkers > ntasks)
+		nworkers = ntasks;
+	if (nworkers > WORKERS_MAX_THREADS)
+		nworkers = WORKERS_MAX_THREADS;
+
+	// Nothing to parallelize.
+	if (nworkers <= 1) {
+		for (size_t i = 0; i < ntasks; i++)
+			func(i, arg);
+
+		return true;
+	}
+
+	// Set up the shared queue.
+	queue.next = 0;
+	queue.ntasks = ntasks;
+	queue.func = func;
+	queue.arg = arg;
+	pthread_mutex_init(&queue.lock, NULL);
+
+	// Spawn the workers.
+	threads = malloc(sizeof(pthread_t) * nworkers);
+	for (started = 0; started < nworkers; started++) {
+		if (pthread_create(&threads[started], NULL, worker_loop, &queue) != 0) {
+			fprintf(stderr, "Failed to spawn a worker thread.\n");
+			break;
+		}
+	}
+
+	// Make sure the work gets done even if we couldn't spawn a single thread.
+	if (started == 0)
+		worker_loop(&queue);
+
+	// Wait for everyone to finish.
+	for (unsigned int i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	// Clean up.
+	pthread_mutex_destroy(&queue.lock);
+	free(threads);
+	return true;
+}
+
+/**
+ * Worker thread main loop. Keeps grabbing tasks until the queue is empty.
+ *
+ * @param  data Pointer to the shared queue.
+ * @return      Always NULL.
+ */
+void *worker_loop(void *data) {
+	workers_queue_t *queue = (workers_queue_t *)data;
+	size_t idx;
+
+	for (;;) {
+		// Grab the next task in line.
+		pthread_mutex_lock(&queue->lock);
+		idx = queue->next;
+		if (idx < queue->ntasks)
+			queue->next++;
+		pthread_mutex_unlock(&queue->lock);
+
+		// Nothing left to do.
+		if (idx >= queue->ntasks)
+			break;
+
+		queue->func(idx, queue->arg);
+	}
+
+	return NULL;
+}
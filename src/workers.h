@@ -0,0 +1,23 @@
+/**
+ * workers.h
+ * Tiny fixed-size pool of worker threads for running independent tasks.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#ifndef _WORKERS_H
+#define _WORKERS_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+// Constants.
+#define WORKERS_MAX_THREADS 1024
+
+// Task function prototype. Receives the index of the task and the user data.
+typedef void (*worker_func_t)(size_t idx, void *arg);
+
+bool workers_run(size_t ntasks, unsigned int nworkers, worker_func_t func,
+				 void *arg);
+
+#endif  //_WORKERS_H
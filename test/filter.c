@@ -0,0 +1,117 @@
+/**
+ * filter.c
+ * Checks that containers handed over by someone else, like the daemon, go
+ * through the same name globs and predicates as the devices we populate
+ * ourselves.
+ *
+ * @author Nathan Campos <hi@nathancampos.me>
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "device.h"
+#include "filter.h"
+
+// Private methods.
+void build_container(stdev_container *container);
+bool check(const char *desc, const char *include, const char *exclude,
+		   const char *expr, const char *expected);
+
+/**
+ * Test entry point.
+ *
+ * @return Exit code.
+ */
+int main(void) {
+	bool success = true;
+
+	success &= check("no filter", NULL, NULL, NULL, "sda sdb loop0 loop1");
+	success &= check("include", "sd*", NULL, NULL, "sda sdb");
+	success &= check("exclude", NULL, "loop*", NULL, "sda sdb");
+	success &= check("include and exclude", "sd*", "sdb", NULL, "sda");
+	success &= check("exclude and predicate", NULL, "loop0", "size>1G",
+					 "sda loop1");
+	success &= check("predicate", NULL, NULL, "name!=loop*", "sda sdb");
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Runs a filter over a fresh container and compares what's left.
+ *
+ * @param  desc     Description of the check.
+ * @param  include  Include glob or NULL.
+ * @param  exclude  Exclude glob or NULL.
+ * @param  expr     Predicate expression or NULL.
+ * @param  expected Names of the devices that should be left, space separated.
+ * @return          TRUE if the check passed.
+ */
+bool check(const char *desc, const char *include, const char *exclude,
+		   const char *expr, const char *expected) {
+	stdev_container container;
+	filter_t filter;
+	char names[256];
+	size_t len = 0;
+	bool passed;
+
+	// Set everything up.
+	filter_init(&filter);
+	if (include != NULL)
+		filter_include(&filter, include);
+	if (exclude != NULL)
+		filter_exclude(&filter, exclude);
+	if ((expr != NULL) && !filter_parse(&filter, expr)) {
+		printf("FAIL %s: couldn't parse %s\n", desc, expr);
+		filter_free(&filter);
+		return false;
+	}
+	build_container(&container);
+
+	// Filter and list what's left.
+	filter_container(&filter, &container);
+	names[0] = '\0';
+	for (uint32_t i = 0; i < container.count; i++) {
+		len += snprintf(names + len, sizeof(names) - len, "%s%s",
+						(i > 0) ? " " : "",
+						device_str(&container, container.list[i].name));
+	}
+
+	passed = strcmp(names, expected) == 0;
+	if (passed) {
+		printf("ok   %s\n", desc);
+	} else {
+		printf("FAIL %s: expected \"%s\", got \"%s\"\n", desc, expected,
+			   names);
+	}
+
+	device_container_free(&container);
+	filter_free(&filter);
+	return passed;
+}
+
+/**
+ * Builds a container with a couple of disks and loop devices, each with a
+ * single partition. Only the second disk is small.
+ *
+ * @param container Container to be initialized and populated.
+ */
+void build_container(stdev_container *container) {
+	const char *names[] = { "sda", "sdb", "loop0", "loop1" };
+	char name[PARTITION_NAME_MAX_LEN];
+
+	device_container_init(container);
+	for (uint32_t i = 0; i < (sizeof(names) / sizeof(names[0])); i++) {
+		stdev_t sd;
+
+		memset(&sd, 0, sizeof(stdev_t));
+		sd.name = strpool_intern(&container->strings, names[i]);
+		sd.sectors = (i != 1) ? 4194304 : 2048;
+		sd.sector_size = 512;
+		sd.size = sd.sectors * sd.sector_size;
+
+		snprintf(name, PARTITION_NAME_MAX_LEN, "%sp1", names[i]);
+		device_partition_push(container, &sd.partitions, name);
+
+		device_list_push(container, &sd);
+	}
+}